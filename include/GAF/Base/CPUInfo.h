@@ -78,6 +78,19 @@ namespace gaf
 		CPUFeatures Features;
 		ECPUVendor::Type Vendor;
 	};
+
+	/* Where a logical core is placed inside the CPU */
+	struct LogicalCoreInfo
+	{
+		/* Index given by the OS to the logical core */
+		uint32 Index;
+		/* Physical core it belongs to, SMT siblings share it */
+		uint32 Core;
+		/* Position among the SMT siblings of its physical core */
+		uint32 Sibling;
+		/* NUMA node the core belongs to */
+		uint32 NUMANode;
+	};
 }
 
 #endif /* GAF_CPUINFO_H */
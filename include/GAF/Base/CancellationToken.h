@@ -0,0 +1,83 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_CANCELLATIONTOKEN_H
+#define GAF_CANCELLATIONTOKEN_H 1
+
+#include "GAF/Base/TaskPool.h"
+
+namespace gaf
+{
+	namespace Impl
+	{
+		/* Reference counted state shared by the copies of a CancellationToken, allocated from the TaskPool */
+		struct CancellationState
+		{
+			std::atomic<uint32> RefCount;
+			std::atomic_bool Cancelled;
+			/* Cancelling the parent cancels this one too, the child keeps a reference to it */
+			CancellationState* Parent;
+
+			void AddRef();
+			void Release();
+			bool IsCancelled()const;
+		};
+	}
+
+	/*
+		Lets a group of tasks be cancelled at once, every task that has the
+		token attached is destroyed without running if it's picked after
+		Cancel. Copies share the same state.
+		Tokens can be created as children of another one, so cancelling a
+		TaskDispatcher token also cancels the tokens its users created from
+		it. A default constructed token can't be cancelled.
+		A task that is already running isn't interrupted, long tasks should
+		check IsCancelled on their own.
+	*/
+	class CancellationToken
+	{
+		Impl::CancellationState* m_State;
+
+	public:
+		CancellationToken();
+		CancellationToken(const CancellationToken& other);
+		CancellationToken(CancellationToken&& other)noexcept;
+		CancellationToken& operator=(const CancellationToken& other);
+		CancellationToken& operator=(CancellationToken&& other)noexcept;
+		~CancellationToken();
+
+		static CancellationToken Create();
+		/* The new token is cancelled when the parent is */
+		static CancellationToken Create(const CancellationToken& parent);
+
+		void Cancel();
+
+		/* True if this token or any of its parents was cancelled */
+		bool IsCancelled()const;
+
+		/* False for default constructed tokens */
+		explicit operator bool()const
+		{
+			return m_State != nullptr;
+		}
+
+		friend struct Task_t;
+	};
+}
+
+#endif /* GAF_CANCELLATIONTOKEN_H */
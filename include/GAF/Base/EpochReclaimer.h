@@ -0,0 +1,94 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#pragma once
+
+#ifndef GAF_EPOCHRECLAIMER_H
+#define GAF_EPOCHRECLAIMER_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+namespace gaf
+{
+	/*
+		Epoch based reclamation for read-mostly structures published through
+		an atomic pointer. Readers wrap their accesses like this:
+			const auto token = reclaimer.EnterRead();
+			const auto data = published.load(std::memory_order_seq_cst);
+			... use data ...
+			reclaimer.ExitRead(token);
+		Which is wait-free, just an increment of a reader counter that lives
+		on a cache line shared by few threads, so readers scale with the
+		cores. Writers store the new version and Retire the old one, which
+		is deleted once no reader can be using it, so they never wait for
+		the readers either. The writers must be serialized by the caller.
+		There are two epochs in flight, a retired object is freed after the
+		epoch advanced twice, and the epoch only advances when the readers
+		of the previous one are gone, so objects may linger until a later
+		Retire or Reclaim.
+	*/
+	class EpochReclaimer
+	{
+	public:
+		using ReadToken = uint32;
+		static constexpr uint32 NumStripes = 32;
+	private:
+		struct alignas(CACHE_LINE_SIZE) Stripe
+		{
+			/* Readers inside a read section, by the parity of the epoch they entered in */
+			std::atomic<uint32> Readers[2];
+		};
+		struct Retired
+		{
+			uint64 Epoch;
+			void* Object;
+			void(*Deleter)(void*);
+		};
+
+		Stripe m_Stripes[NumStripes];
+		std::atomic<uint64> m_Epoch;
+		std::vector<Retired> m_Retired;
+
+		bool HasReaders(uint64 parity)const;
+		void RetireObject(void* object, void(*deleter)(void*));
+	public:
+		EpochReclaimer();
+		/* There can't be readers left, every retired object is deleted */
+		~EpochReclaimer();
+		EpochReclaimer(const EpochReclaimer&) = delete;
+		EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+		ReadToken EnterRead();
+		void ExitRead(ReadToken token);
+
+		/* The object must be already unreachable for new readers */
+		template<typename T>
+		void Retire(const T* object)
+		{
+			if (object != nullptr)
+				RetireObject(const_cast<T*>(object), [](void* ptr) { delete static_cast<T*>(ptr); });
+		}
+
+		/* Advances the epoch if possible and deletes the retired objects that can't be read anymore */
+		void Reclaim();
+
+		/* Objects waiting to be deleted */
+		SIZET GetNumRetired()const;
+	};
+}
+
+#endif /* GAF_EPOCHRECLAIMER_H */
@@ -0,0 +1,79 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_EVENTCOUNT_H
+#define GAF_EVENTCOUNT_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+namespace gaf
+{
+	/*
+		Lets threads park until a condition changes without losing wake-ups,
+		the waiting side must follow this protocol:
+			const auto key = ec.PrepareWait();
+			if (condition is true)
+				ec.CancelWait();
+			else
+				ec.Wait(key);
+		And the notifying side just makes the condition true and calls
+		NotifyOne or NotifyAll, which don't touch the kernel when there are
+		no waiters.
+		On Linux it parks on a futex, elsewhere on a condition variable.
+	*/
+	class EventCount
+	{
+	public:
+		using Key = uint32;
+	private:
+		/* Upper 32 bits are the epoch, lower 32 bits are the number of waiters */
+		std::atomic<uint64> m_State;
+		static constexpr uint64 WaiterMask = 0xFFFFFFFFULL;
+		static constexpr uint32 EpochShift = 32;
+		static constexpr uint64 AddEpoch = 1ULL << EpochShift;
+#if !PLATFORM_LINUX
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+#endif
+		void Notify(uint32 count);
+	public:
+		EventCount();
+		~EventCount() = default;
+		EventCount(const EventCount&) = delete;
+		EventCount& operator=(const EventCount&) = delete;
+
+		/* Registers the calling thread as a waiter, the condition must be checked after this */
+		Key PrepareWait();
+		/* The condition was true after PrepareWait, so the thread won't wait */
+		void CancelWait();
+		/* Parks the thread until a Notify happens after its PrepareWait */
+		void Wait(Key key);
+
+		/* Wakes one parked thread, if any */
+		void NotifyOne();
+		/* Wakes up to count parked threads */
+		void NotifyMany(uint32 count);
+		/* Wakes every parked thread */
+		void NotifyAll();
+
+		/* Number of threads between PrepareWait and CancelWait or the end of Wait */
+		uint32 GetNumWaiters()const;
+	};
+}
+
+#endif /* GAF_EVENTCOUNT_H */
\ No newline at end of file
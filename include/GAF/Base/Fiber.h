@@ -0,0 +1,66 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#pragma once
+
+#ifndef GAF_FIBER_H
+#define GAF_FIBER_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+#if GREAPER_TASKMAN_FIBERS
+extern "C"
+{
+#include <ucontext.h>
+}
+
+namespace gaf
+{
+	/*
+		Internal, an execution context with its own stack, the pool
+		TaskHandlers run their tasks on them when GREAPER_TASKMAN_FIBERS is
+		enabled. A fiber can be suspended in the middle of a task and
+		resumed later on any thread.
+		A default constructed Fiber has no stack, it only keeps the context
+		of the thread that switched away from it.
+	*/
+	class Fiber
+	{
+		ucontext_t m_Context;
+		/* Mapped region, the lowest page is the guard one */
+		void* m_Stack;
+		SIZET m_StackSize;
+	public:
+		using EntryFn = void(*)();
+
+		Fiber();
+		/* The fiber starts at entry the first time it's switched to, entry must never return */
+		Fiber(EntryFn entry, SIZET stackSize);
+		~Fiber();
+		Fiber(const Fiber&) = delete;
+		Fiber& operator=(const Fiber&) = delete;
+
+		/*
+			Saves the calling context into from and continues the one of to,
+			returns when something switches back to from.
+		*/
+		static void Switch(Fiber& from, Fiber& to);
+	};
+}
+#endif
+
+#endif /* GAF_FIBER_H */
@@ -19,33 +19,304 @@
 #ifndef GAF_TASK_H
 #define GAF_TASK_H 1
 
+#include "GAF/Base/CancellationToken.h"
+
 namespace gaf
 {
+	namespace ETaskPriority
+	{
+		enum Type
+		{
+			REALTIME,
+			HIGH,
+			NORMAL,
+			BACKGROUND,
+
+			COUNT
+		};
+	}
+	const ANSICHAR* GetTaskPriorityStr(ETaskPriority::Type priority);
+
+	/* What happens to a task which is picked after its deadline */
+	namespace ETaskDeadline
+	{
+		enum Type
+		{
+			/* The task is destroyed without running */
+			DROP,
+			/* The task is destroyed without running if a newer task with the same name was created */
+			COALESCE
+		};
+	}
+
+	/*
+		Move-only task, callables up to InlineSize bytes are stored inside the
+		task itself and bigger ones are allocated from the TaskPool, so sending
+		a task doesn't touch the heap.
+		The name is the string created by CreateTaskName, its address can be
+		used as the task ID.
+		Tasks are NORMAL priority and have no deadline nor CancellationToken
+		by default, only the TaskManager pool honours the priority,
+		TaskDispatcher handlers run their tasks in order.
+	*/
 	struct Task_t
 	{
 		using TaskFn = std::function<void()>;
+		/* Big enough for a std::function or a std::bind with a few arguments */
+		static constexpr SIZET InlineSize = 64;
 
-		std::string Name;
-		TaskFn Function;
+		const ANSICHAR* Name;
 #if GREAPER_DEBUG
 		const ANSICHAR* CallerFn;
 		const ANSICHAR* FileName;
 		int32 FileLine;
 #endif
 
-		void operator()()
+	private:
+		struct Ops
+		{
+			void(*Invoke)(void* storage);
+			void(*Move)(void* dst, void* src);
+			void(*Destroy)(void* storage);
+		};
+
+		template<typename F>
+		struct InlineOps
+		{
+			static void Invoke(void* storage)
+			{
+				(*static_cast<F*>(storage))();
+			}
+			static void Move(void* dst, void* src)
+			{
+				new(dst) F(std::move(*static_cast<F*>(src)));
+				static_cast<F*>(src)->~F();
+			}
+			static void Destroy(void* storage)
+			{
+				static_cast<F*>(storage)->~F();
+			}
+			static constexpr Ops Table = { &Invoke, &Move, &Destroy };
+		};
+
+		template<typename F>
+		struct PooledOps
+		{
+			static void Invoke(void* storage)
+			{
+				(**static_cast<F**>(storage))();
+			}
+			static void Move(void* dst, void* src)
+			{
+				*static_cast<F**>(dst) = *static_cast<F**>(src);
+			}
+			static void Destroy(void* storage)
+			{
+				TaskPool::Delete(*static_cast<F**>(storage));
+			}
+			static constexpr Ops Table = { &Invoke, &Move, &Destroy };
+		};
+
+		template<typename F>
+		static constexpr bool FitsInline = sizeof(F) <= InlineSize
+			&& alignof(F) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible<F>::value;
+
+		const Ops* m_Ops;
+		alignas(std::max_align_t) uint8 m_Storage[InlineSize];
+		/* Default constructed means no deadline */
+		std::chrono::steady_clock::time_point m_Deadline;
+		/* Reference to the state of the attached CancellationToken, if any */
+		Impl::CancellationState* m_Cancellation;
+		/* Creation order among the coalescing tasks which share the name slot */
+		uint32 m_CoalesceSeq;
+		uint8 m_Priority;
+		uint8 m_DeadlinePolicy;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+		/* TaskStats::Now when the task was sent, 0 if it was never sent */
+		uint64 m_SendTime;
+#endif
+
+		template<typename F>
+		void Store(F&& fn)
+		{
+			using Fn = typename std::decay<F>::type;
+			if constexpr (FitsInline<Fn>)
+			{
+				new(m_Storage) Fn(std::forward<F>(fn));
+				m_Ops = &InlineOps<Fn>::Table;
+			}
+			else
+			{
+				*reinterpret_cast<Fn**>(m_Storage) = TaskPool::New<Fn>(std::forward<F>(fn));
+				m_Ops = &PooledOps<Fn>::Table;
+			}
+		}
+
+		void Reset()
+		{
+			if (m_Ops)
+			{
+				m_Ops->Destroy(m_Storage);
+				m_Ops = nullptr;
+			}
+			if (m_Cancellation)
+			{
+				m_Cancellation->Release();
+				m_Cancellation = nullptr;
+			}
+		}
+
+		void MoveFrom(Task_t& other)noexcept
 		{
-#if GREAPER_DEBUG_TASKMAN
-			const auto begin = std::chrono::high_resolution_clock::now();
+			Name = other.Name;
+#if GREAPER_DEBUG
+			CallerFn = other.CallerFn;
+			FileName = other.FileName;
+			FileLine = other.FileLine;
+#endif
+			m_Deadline = other.m_Deadline;
+			m_Cancellation = other.m_Cancellation;
+			other.m_Cancellation = nullptr;
+			m_CoalesceSeq = other.m_CoalesceSeq;
+			m_Priority = other.m_Priority;
+			m_DeadlinePolicy = other.m_DeadlinePolicy;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+			m_SendTime = other.m_SendTime;
 #endif
-			Function();
-#if GREAPER_DEBUG_TASKMAN
-			const auto duration = std::chrono::high_resolution_clock::now() - begin;
+			m_Ops = other.m_Ops;
+			if (m_Ops)
+			{
+				m_Ops->Move(m_Storage, other.m_Storage);
+				other.m_Ops = nullptr;
+			}
+		}
+
+		template<typename F>
+		using EnableIfCallable = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task_t>::value>::type;
+	public:
+		Task_t()noexcept
+			:Name(nullptr)
+#if GREAPER_DEBUG
+			, CallerFn(nullptr)
+			, FileName(nullptr)
+			, FileLine(0)
+#endif
+			, m_Ops(nullptr)
+			, m_Cancellation(nullptr)
+			, m_CoalesceSeq(0)
+			, m_Priority(ETaskPriority::NORMAL)
+			, m_DeadlinePolicy(ETaskDeadline::DROP)
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+			, m_SendTime(0)
+#endif
+		{
+
+		}
 
-			std::string out = "Task " + Name + " Took: " + std::to_string(duration.count() / (1000.0 * 1000.0)) + "ms.\n";
-			OutputDebugStringA(out.c_str());
+#if !GREAPER_DEBUG
+		template<typename F, typename = EnableIfCallable<F>>
+		Task_t(const ANSICHAR* name, F&& fn)
+			:Name(name)
+			, m_Ops(nullptr)
+			, m_Cancellation(nullptr)
+			, m_CoalesceSeq(0)
+			, m_Priority(ETaskPriority::NORMAL)
+			, m_DeadlinePolicy(ETaskDeadline::DROP)
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+			, m_SendTime(0)
+#endif
+		{
+			Store(std::forward<F>(fn));
+		}
+#else
+		template<typename F, typename = EnableIfCallable<F>>
+		Task_t(const ANSICHAR* name, F&& fn, const ANSICHAR* callerFn = nullptr, const ANSICHAR* fileName = nullptr, const int32 fileLine = 0)
+			:Name(name)
+			, CallerFn(callerFn)
+			, FileName(fileName)
+			, FileLine(fileLine)
+			, m_Ops(nullptr)
+			, m_Cancellation(nullptr)
+			, m_CoalesceSeq(0)
+			, m_Priority(ETaskPriority::NORMAL)
+			, m_DeadlinePolicy(ETaskDeadline::DROP)
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+			, m_SendTime(0)
+#endif
+		{
+			Store(std::forward<F>(fn));
+		}
 #endif
+
+		Task_t(Task_t&& other)noexcept
+		{
+			MoveFrom(other);
+		}
+		Task_t& operator=(Task_t&& other)noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				MoveFrom(other);
+			}
+			return *this;
 		}
+		Task_t(const Task_t&) = delete;
+		Task_t& operator=(const Task_t&) = delete;
+		~Task_t()
+		{
+			Reset();
+		}
+
+		explicit operator bool()const
+		{
+			return m_Ops != nullptr;
+		}
+
+		ETaskPriority::Type GetPriority()const
+		{
+			return static_cast<ETaskPriority::Type>(m_Priority);
+		}
+		void SetPriority(const ETaskPriority::Type priority)
+		{
+			m_Priority = static_cast<uint8>(priority);
+		}
+
+		/*
+			Gives the task a deadline, if it's picked after it the policy
+			decides whether it still runs. Coalescing tasks are ordered by
+			the time SetDeadline was called on them.
+		*/
+		void SetDeadline(std::chrono::steady_clock::time_point deadline, ETaskDeadline::Type policy);
+
+		/* The task won't run if it's picked after the token is cancelled, it replaces the previous token */
+		void SetCancellationToken(const CancellationToken& token);
+
+		bool HasCancellationToken()const
+		{
+			return m_Cancellation != nullptr;
+		}
+
+		bool IsCancelled()const
+		{
+			return m_Cancellation && m_Cancellation->IsCancelled();
+		}
+
+		/* Returns true if the task was cancelled, or it missed its deadline and its policy says it must not run */
+		bool IsDiscarded()const;
+
+		/* The execution times are kept by TaskStats, see GREAPER_TASKMAN_STATS */
+		void operator()()
+		{
+			Assertion::WhenNullptr(m_Ops, "Trying to run an empty task, it was default constructed or moved from.");
+			m_Ops->Invoke(m_Storage);
+		}
+
+		friend class TaskManager;
+		friend class TaskHandler;
+		friend class Strand;
+		friend class TaskGraph;
 	};
 
 	namespace Impl
@@ -62,7 +333,7 @@ namespace gaf
 
 #ifndef CreateTaskName
 #define CreateTaskName(taskName)\
-static const std::string taskName##_Name = #taskName
+static const ANSICHAR* const taskName##_Name = #taskName
 #endif
 
 #ifndef CreateTask
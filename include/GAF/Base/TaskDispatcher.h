@@ -20,20 +20,73 @@
 #define GAF_TASKDISPATCHER_H 1
 
 #include "GAF/Base/Task.h"
+#include "GAF/Future.h"
 
 namespace gaf
 {
+	namespace Impl
+	{
+		struct DispatcherAwaiter;
+	}
+	struct TaskHandlerGroup;
+
 	class TaskDispatcher
 	{
 		const std::string m_Name;
 		TaskManager* m_Manager;
+		/* Set by the TaskManager while the dispatcher is registered, avoids looking it up on every send */
+		TaskHandlerGroup* m_Group;
+		/* Attached to every task sent without a token of its own, replaced by CancelPendingTasks */
+		CancellationToken m_Cancellation;
+		std::shared_mutex m_CancellationMutex;
+		friend class TaskManager;
+
+		/* Gives the dispatcher token to the tasks that don't have one, m_CancellationMutex must be held */
+		void AttachCancellation(Task_t& task);
 
 	protected:
-		void SendTask(const Task_t& task, uint32 handler = static_cast<uint32>(-1));
+		void SendTask(Task_t task, uint32 handler = static_cast<uint32>(-1));
+		/* Sends a batch of tasks at once, see TaskManager::SendTasks */
+		void SendTasks(Task_t* tasks, SIZET count, uint32 handler = static_cast<uint32>(-1));
+		void SendTasks(std::vector<Task_t>& tasks, uint32 handler = static_cast<uint32>(-1));
+		/* Tasks with the same key are executed in order by the same handler, see TaskManager::SendKeyedTask */
+		void SendKeyedTask(Task_t task, SIZET key);
+
+		/* Sends fn as a task named name, the returned Future gets the value returned by fn */
+		template<typename F>
+		Future<typename std::invoke_result<F>::type> SendTask(const ANSICHAR* name, F fn, uint32 handler = static_cast<uint32>(-1))
+		{
+			Future<typename std::invoke_result<F>::type> future;
+			SendTask(decltype(future)::CreateFulfillTask(name, std::move(fn), m_Manager, future), handler);
+			return future;
+		}
+		template<typename F>
+		Future<typename std::invoke_result<F>::type> SendKeyedTask(const ANSICHAR* name, F fn, SIZET key)
+		{
+			Future<typename std::invoke_result<F>::type> future;
+			SendKeyedTask(decltype(future)::CreateFulfillTask(name, std::move(fn), m_Manager, future), key);
+			return future;
+		}
+		friend struct Impl::DispatcherAwaiter;
 	public:
 		TaskDispatcher() = delete;
 		TaskDispatcher(const std::string& name, TaskManager* manager);
 		virtual ~TaskDispatcher();
+
+		const std::string& GetName()const;
+
+		/*
+			Cancels every task sent through this dispatcher which hasn't run
+			yet, the ones sent afterwards aren't affected. Tasks with their
+			own token are only cancelled if it was created as a child of
+			GetCancellationToken.
+			The Futures of the cancelled tasks get ready with a
+			TaskDiscardedException.
+		*/
+		void CancelPendingTasks();
+
+		/* Current token of the dispatcher, to create child tokens from */
+		CancellationToken GetCancellationToken();
 	};
 }
 
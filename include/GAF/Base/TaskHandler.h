@@ -20,32 +20,163 @@
 #define GAF_TASKHANDLER_H 1
 
 #include "GAF/MPMCQueue.h"
+#include "GAF/WorkStealingQueue.h"
+#include "GAF/Base/EventCount.h"
+#include "GAF/Base/Fiber.h"
 
 namespace gaf
 {
+	/* Queue used by the TaskManager, see GREAPER_TASKMAN_QUEUE_CAPACITY */
+	using TaskQueue_t = MPMCQueue<Task_t, GREAPER_TASKMAN_QUEUE_CAPACITY>;
+	/* Queue of each TaskDispatcher handler, see GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY */
+	using DispatcherQueue_t = MPMCQueue<Task_t, GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY>;
+
+#if GREAPER_TASKMAN_FIBERS
+	/* Internal, why a fiber switched back to the thread of its TaskHandler */
+	namespace EFiberSwitch
+	{
+		enum Type
+		{
+			/* The TaskHandler is stopping, the fiber is free again */
+			STOP,
+			/* There's a ready fiber to resume, the current one is free again */
+			RESUME,
+			/* The task of the fiber waits for a JobCounter, the target is the fiber reserved to take over the thread */
+			WAIT
+		};
+	}
+#endif
+
 	/*
 		Internal class that enables the handling of tasks
+		A TaskHandler either belongs to the TaskManager pool, where it owns a
+		work stealing queue and takes tasks from it, from the global queue or
+		steals them from other TaskHandlers, or to a TaskDispatcher, where it
+		only takes tasks from its dedicated queue.
+		With GREAPER_TASKMAN_FIBERS the pool TaskHandlers run their loop on
+		fibers, when a task waits for a JobCounter its fiber is suspended
+		and the thread continues on another one, once the counter is done
+		the fiber is queued and any pool TaskHandler resumes it.
 	*/
 	class TaskHandler
 	{
-		static constexpr auto WaitTimeMS = std::chrono::milliseconds(1);
-		/* A link to the task queue */
-		MPMCQueue<Task_t>* m_TaskQueue;
+		/* Times an idle handler yields and looks for tasks again before parking */
+		static constexpr uint32 SpinCount = 64;
+		/* The pool which this handler belongs to, nullptr on dispatcher handlers */
+		TaskManager* m_Manager;
+		/* The TaskManager that created this handler, either for its pool or for a dispatcher */
+		TaskManager* m_Owner;
+		/* A link to the task queue, only used by dispatcher handlers */
+		DispatcherQueue_t* m_TaskQueue;
+		/* Tasks sent to m_TaskQueue and not taken yet, only used by dispatcher handlers */
+		std::atomic<uint32>* m_Depth;
+		/* Where the thread parks while there's nothing to do, shared with whoever sends tasks to it */
+		EventCount* m_WakeUp;
+		/* Tasks sent from this handler thread, one queue per priority, other handlers can steal from them */
+		WorkStealingQueue<Task_t*> m_LocalTasks[ETaskPriority::COUNT];
+		/* Number of tasks this handler has taken, used to give low priorities their turn */
+		uint32 m_NumAcquired;
+		/* Position of this handler inside the pool */
+		uint32 m_Index;
+		/* State of the random generator used to choose a victim to steal from */
+		uint32 m_Seed;
+		/* Name given to the thread, shown by debuggers and profilers */
+		std::string m_ThreadName;
+		/* Name of the TaskDispatcher this handler belongs to, or TaskManager, shown on the traces */
+		std::string m_DispatcherName;
+		/* Logical core the thread is pinned to, -1 if it can run on any of them */
+		std::atomic<int32> m_Core;
+		/* NUMA node of the pinned core, stealers look at the TaskHandlers of their own node first */
+		std::atomic<uint32> m_NUMANode;
 		/* The thread obj */
 		std::thread m_WorkerThread;
 		/* The thread function */
 		void Run();
 		/* Flag that tells the thread to stop */
 		AtomicFlag m_Stop;
+		/* False only while the thread is parked or stopped, TaskManager::Shutdown uses it to know when the work is done */
+		std::atomic_bool m_Busy;
+		/* Tasks taken by this handler, only written by its thread */
+		std::atomic<uint64> m_NumExecuted;
+#if GREAPER_TASKMAN_FIBERS
+		/* Context of the thread itself, the fibers switch back to it in order to stop or suspend */
+		Fiber m_ThreadFiber;
+		/* Fiber running on the thread, nullptr while the thread runs on its own context */
+		Fiber* m_CurrentFiber;
+		/* Request of the fiber that switched back to m_ThreadFiber */
+		EFiberSwitch::Type m_SwitchType;
+		Fiber* m_SwitchTarget;
+		JobCounter* m_SwitchCounter;
+		uint32 m_SwitchValue;
+
+		/* Runs on the thread context, schedules the fibers until the handler stops */
+		void RunFibers();
+		/* Loop executed by every fiber, it may move between threads, so it never keeps its TaskHandler */
+		static void FiberMain();
+		/* Called from a fiber, returns when the fiber is resumed, maybe on another thread */
+		void SwitchToThread(EFiberSwitch::Type type, Fiber* target = nullptr, JobCounter* counter = nullptr, uint32 value = 0);
+#endif
+		/* Executes the tasks on the thread itself until the handler stops */
+		void RunTasks();
+
+		/* Retrieves the next task without blocking */
+		bool TryAcquireTask(Task_t& task);
+
+		/*
+			Retrieves the next task, spinning and then parking while there's
+			none. Returns false if the handler must stop or there's a
+			suspended fiber ready to be resumed.
+		*/
+		bool WaitForTask(Task_t& task);
+
+		/* True if there are suspended fibers waiting to be resumed by the pool */
+		bool HasReadyFibers()const;
+
+		/* Executes a taken task, unless the owner is cancelling the pending ones */
+		static void RunTask(TaskManager* owner, Task_t& task);
+
+		/* Counts a taken task, only called from the thread of the handler */
+		void AddExecuted();
+
+		/* Returns a pseudo-random number, used to choose a victim to steal from */
+		uint32 NextRandom();
+
+		/* Pins the thread to m_Core */
+		void ApplyAffinity();
+
+		/*
+			Runs the task unless it missed its deadline, recording it on
+			TaskStats and TaskTrace, returns false if it was discarded.
+		*/
+		static bool Execute(Task_t& task);
 	public:
 		TaskHandler()
-			:m_TaskQueue(nullptr)
+			:m_Manager(nullptr)
+			, m_Owner(nullptr)
+			, m_TaskQueue(nullptr)
+			, m_Depth(nullptr)
+			, m_WakeUp(nullptr)
+			, m_NumAcquired(0)
+			, m_Index(0)
+			, m_Seed(1)
+			, m_Core(-1)
+			, m_NUMANode(0)
 			, m_Stop(true)
+			, m_Busy(false)
+			, m_NumExecuted(0)
+#if GREAPER_TASKMAN_FIBERS
+			, m_CurrentFiber(nullptr)
+			, m_SwitchType(EFiberSwitch::STOP)
+			, m_SwitchTarget(nullptr)
+			, m_SwitchCounter(nullptr)
+			, m_SwitchValue(0)
+#endif
 		{
 
 		}
 		/* Only TaskManager can create or destroy TaskHandlers */
-		TaskHandler(MPMCQueue<Task_t>* taskQueue);
+		TaskHandler(TaskManager* owner, DispatcherQueue_t* taskQueue, EventCount* wakeUp, std::atomic<uint32>* depth, const std::string& threadName, const std::string& dispatcherName);
+		TaskHandler(TaskManager* manager, uint32 index);
 
 		/*
 			Starts the thread and begins the tasks handling
@@ -59,12 +190,95 @@ namespace gaf
 		*/
 		void Stop();
 
-		TaskHandler(TaskHandler&& other)noexcept = default;
-		TaskHandler& operator=(TaskHandler&& other)noexcept = default;
-		TaskHandler(const TaskHandler& other);
-		TaskHandler& operator=(const TaskHandler& other);
+		/*
+			Tells the thread to stop after the current task without
+			waiting for it, the thread is joined on the next Start or Stop.
+			Only TaskManager can do this
+		*/
+		void RequestStop();
+
+		/*
+			Waits for the thread after RequestStop, it may still be
+			finishing a long task, so it must be called without locks held.
+			Only TaskManager can do this
+		*/
+		void Join();
+
+		/*
+			Pins the thread to a logical core, -1 lets it run on any core,
+			it's kept when the thread is restarted.
+			Only TaskManager can do this
+		*/
+		void SetPlacement(int32 core, uint32 numaNode);
+
+		/*
+			Returns the TaskHandler which is running on the calling thread,
+			nullptr if the calling thread is not a TaskHandler
+		*/
+		static TaskHandler* GetCurrent();
+
+		/* Returns the TaskManager of the pool, nullptr on dispatcher TaskHandlers */
+		TaskManager* GetManager()const;
+
+		/* Logical core the thread is pinned to, -1 if it can run on any core */
+		int32 GetCore()const;
+
+		TaskHandler(TaskHandler&& other)noexcept = delete;
+		TaskHandler& operator=(TaskHandler&& other)noexcept = delete;
+		TaskHandler(const TaskHandler& other) = delete;
+		TaskHandler& operator=(const TaskHandler& other) = delete;
 		~TaskHandler();
 		friend class TaskManager;
+		friend class Strand;
+		friend class TaskGraph;
+	};
+
+	/*
+		Internal, the handlers of a TaskDispatcher. The TaskDispatcher keeps a
+		pointer to its group, so sending a task doesn't need to look it up.
+	*/
+	struct TaskHandlerGroup
+	{
+		/*
+			The TaskHandler keeps a pointer to the queue, so DHandlers
+			are heap allocated in order to keep it stable.
+		*/
+		struct DHandler
+		{
+			DispatcherQueue_t Tasks;
+			EventCount WakeUp;
+			/* Tasks sent and not taken yet, cheaper to read than the queue size */
+			alignas(CACHE_LINE_SIZE) std::atomic<uint32> Depth;
+			TaskHandler Handler;
+			DHandler(TaskManager* owner, const std::string& threadName, const std::string& dispatcherName);
+			~DHandler() {};
+			DHandler(const DHandler& other) = delete;
+			DHandler& operator=(const DHandler& other) = delete;
+		};
+
+		/* Keys are hashed into a fixed number of slots, see TaskManager::SendKeyedTask */
+		static constexpr uint32 NumKeySlots = 256;
+
+		std::shared_mutex HandlerMutex;
+		/*
+			Handler of every key slot in the high 32 bits, and its tasks sent and
+			not finished in the low ones, 0 when the slot is free. Declared
+			before the handlers, as their queued tasks release their slot when
+			they are destroyed.
+		*/
+		std::atomic<uint64> KeySlots[NumKeySlots];
+		std::vector<std::unique_ptr<DHandler>> Handlers;
+		/* Handler threads are named ThreadName-index */
+		std::string ThreadName;
+		/* Logical cores the handlers are pinned to, the pool TaskHandlers stay away from them */
+		std::vector<uint32> Cores;
+		/* Owner of the group, its handle is cleared when the group is destroyed */
+		TaskDispatcher* Dispatcher;
+
+		TaskHandlerGroup() :Dispatcher(nullptr) { for (auto& slot : KeySlots) slot.store(0, std::memory_order_relaxed); };
+		~TaskHandlerGroup() {};
+		TaskHandlerGroup(const TaskHandlerGroup& other) = delete;
+		TaskHandlerGroup& operator=(const TaskHandlerGroup& other) = delete;
 	};
 }
 
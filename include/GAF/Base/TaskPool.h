@@ -0,0 +1,70 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_TASKPOOL_H
+#define GAF_TASKPOOL_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+namespace gaf
+{
+	/*
+		Fixed size block allocator used by the tasks, for closures that don't
+		fit inside a Task_t and for the nodes of the work stealing queues.
+		Every thread keeps a small cache of free blocks per size class, when
+		it runs out or has too many of them it exchanges a batch with the
+		global list, so the heap is only touched while the pool warms up.
+		Blocks bigger than MaxBlockSize go straight to the heap.
+		Threads should call ReleaseThreadCache before exiting, otherwise
+		their cached blocks are lost.
+	*/
+	class TaskPool
+	{
+	public:
+		static constexpr SIZET MinBlockSize = 64;
+		static constexpr SIZET NumSizeClasses = 4;
+		static constexpr SIZET MaxBlockSize = MinBlockSize << (NumSizeClasses - 1);
+		/* Maximum number of free blocks that a thread keeps per size class */
+		static constexpr uint32 MaxCachedBlocks = 64;
+
+		/* Returns a block of at least size bytes aligned as std::max_align_t */
+		static void* Allocate(SIZET size);
+		/* Returns the block to the pool, size must be the same given to Allocate */
+		static void Deallocate(void* ptr, SIZET size);
+		/* Moves the free blocks of the calling thread to the global list */
+		static void ReleaseThreadCache();
+
+		template<typename T, typename... Args>
+		static T* New(Args&&... args)
+		{
+			static_assert(alignof(T) <= alignof(std::max_align_t), "TaskPool can't allocate over-aligned types.");
+			return new(Allocate(sizeof(T))) T(std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		static void Delete(T* ptr)
+		{
+			if (!ptr)
+				return;
+			ptr->~T();
+			Deallocate(ptr, sizeof(T));
+		}
+	};
+}
+
+#endif /* GAF_TASKPOOL_H */
@@ -0,0 +1,131 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_TIMERWHEEL_H
+#define GAF_TIMERWHEEL_H 1
+
+#include "GAF/Base/Task.h"
+
+namespace gaf
+{
+	namespace Impl
+	{
+		struct TimerNode;
+	}
+
+	/*
+		Refers to a task scheduled on the TimerWheel, copies refer to the
+		same timer. It doesn't keep the timer alive, dropping every handle
+		doesn't cancel it.
+	*/
+	class TimerHandle
+	{
+		std::weak_ptr<Impl::TimerNode> m_Node;
+	public:
+		TimerHandle() = default;
+		explicit TimerHandle(std::weak_ptr<Impl::TimerNode> node);
+
+		/*
+			Removes the timer from the wheel, a task that was already sent
+			to the TaskHandlers still runs.
+			Return:
+				true - The timer was waiting and it won't fire anymore.
+				false - The timer had already fired or it was cancelled.
+		*/
+		bool Cancel();
+
+		/* True while the timer is waiting, periodic timers stay active until they are cancelled */
+		bool IsActive()const;
+	};
+
+	/*
+		Hierarchical timing wheel, every level has NumSlots slots and every
+		slot of a level spans a whole turn of the level below it. Timers are
+		kept in intrusive lists, so adding and cancelling them is O(1), and
+		when the lower level finishes a turn the next slot of the upper one
+		is cascaded down.
+		A single thread drives the wheel, it sleeps until the next occupied
+		slot or cascade and sends the expired tasks to the TaskManager in a
+		single batch. The thread is started with the first timer.
+	*/
+	class TimerWheel
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		static constexpr Clock::duration TickDuration = std::chrono::milliseconds(1);
+		static constexpr uint32 SlotBits = 6;
+		static constexpr uint32 NumSlots = 1 << SlotBits;
+		static constexpr uint32 NumLevels = 5;
+		/* Timers further than this are parked on the last level until they get closer */
+		static constexpr uint64 MaxTicks = 1ULL << (SlotBits * NumLevels);
+
+	private:
+		TaskManager* m_Manager;
+		const Clock::time_point m_Start;
+		/* Everything below is guarded by m_Mutex */
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		std::thread m_Thread;
+		bool m_Stop;
+		uint64 m_CurrentTick;
+		/* Tick at which the thread will wake up, it's only notified for earlier timers */
+		uint64 m_WakeTick;
+		SIZET m_NumTimers;
+		Impl::TimerNode* m_Slots[NumLevels][NumSlots];
+		/* A bit per non-empty slot */
+		uint64 m_Occupied[NumLevels];
+
+		uint64 GetNowTick()const;
+		Clock::time_point GetTickTime(uint64 tick)const;
+
+		void Link(Impl::TimerNode* node);
+		void Unlink(Impl::TimerNode* node);
+		/* Next tick that has work to do, or UINT64_MAX if there are no timers */
+		uint64 GetNextTick()const;
+		/* Moves the wheel up to tick, collecting the tasks of the expired timers */
+		void Advance(uint64 tick, std::vector<Task_t>& expired);
+		/* Cascades the slots whose turn starts at m_CurrentTick and expires the current one */
+		void ProcessTick(std::vector<Task_t>& expired);
+		void Expire(Impl::TimerNode* node, std::vector<Task_t>& expired);
+		void Run();
+		bool Cancel(Impl::TimerNode* node);
+		friend class TimerHandle;
+
+	public:
+		explicit TimerWheel(TaskManager* manager);
+		~TimerWheel();
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/*
+			Schedules the task at the given time, rounded up to the next tick.
+			With an interval greater than 0 the task is sent every interval
+			after that, skipping the periods in which the previous run hasn't
+			finished yet. Once stopped the task is destroyed and the handle is
+			never active.
+		*/
+		TimerHandle Add(Clock::time_point time, Clock::duration interval, Task_t task);
+
+		/* Stops the thread and drops the pending timers, called by the TaskManager before stopping its TaskHandlers */
+		void Stop();
+
+		SIZET GetNumTimers();
+	};
+}
+
+#endif /* GAF_TIMERWHEEL_H */
@@ -131,13 +131,14 @@ namespace gaf
 			before.
 		*/
 		void Close();
+		/* Processes the pending messages of the window and flushes the buffered events, see EventManager::FlushEvents */
 		void UpdateWindowEvents();
 		void RequestFocus();
 		/*
 			This function will send a task to be done by the thread of this window, this is useful,
 			for example for rendering things.
 		*/
-		void SendWindowTask(const Task_t& task);
+		void SendWindowTask(Task_t task);
 
 		std::thread::id GetThreadID()const;
 		std::thread::native_handle_type GetThreadNativeHandle();
@@ -0,0 +1,275 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_COROUTINE_H
+#define GAF_COROUTINE_H 1
+
+#include "GAF/Application.h"
+
+#if GREAPER_COROUTINES
+#include <coroutine>
+
+namespace gaf
+{
+	/*
+		Coroutine whose result is delivered through a Future, it starts
+		running on the calling thread and every co_await which has to wait
+		queues the coroutine, it gets resumed on a TaskHandler afterwards,
+		so no thread is blocked while it's suspended.
+		Futures can be awaited, so co_await works with SendTask,
+		FileSystem::ReadAsync or ResourceData::LoadAsync results, and with
+		other Tasks.
+		Use co_await Schedule(manager) to continue on the TaskManager pool
+		and co_await SwitchToDispatcher(dispatcher) to continue on the
+		TaskHandlers of a TaskDispatcher.
+	*/
+	template<typename T = void>
+	class Task
+	{
+		Future<T> m_Future;
+	public:
+		using promise_type = Impl::TaskPromise<T>;
+
+		explicit Task(Future<T> future)
+			:m_Future(std::move(future))
+		{
+
+		}
+
+		bool IsReady()const
+		{
+			return m_Future.IsReady();
+		}
+
+		/* Waits for the coroutine helping the TaskManager, don't use it inside coroutines */
+		decltype(auto) Get()const
+		{
+			return m_Future.Get();
+		}
+
+		const Future<T>& GetFuture()const
+		{
+			return m_Future;
+		}
+
+		Impl::FutureAwaiter<T> operator co_await()const
+		{
+			return Impl::FutureAwaiter<T>{ m_Future };
+		}
+	};
+
+	namespace Impl
+	{
+		CreateTaskName(CoroutineResumeTask);
+
+		/*
+			Resumes a suspended coroutine, if it's destroyed without running
+			the coroutine is destroyed too, so its Future gets a
+			TaskDiscardedException instead of waiting forever.
+		*/
+		class ResumeTask
+		{
+			std::coroutine_handle<> m_Handle;
+
+		public:
+			explicit ResumeTask(std::coroutine_handle<> handle)
+				:m_Handle(handle)
+			{
+
+			}
+			ResumeTask(ResumeTask&& other)noexcept
+				:m_Handle(other.m_Handle)
+			{
+				other.m_Handle = nullptr;
+			}
+			ResumeTask(const ResumeTask&) = delete;
+			ResumeTask& operator=(const ResumeTask&) = delete;
+			ResumeTask& operator=(ResumeTask&&) = delete;
+			~ResumeTask()
+			{
+				if (m_Handle)
+					m_Handle.destroy();
+			}
+			void operator()()
+			{
+				const auto handle = m_Handle;
+				m_Handle = nullptr;
+				handle.resume();
+			}
+		};
+
+		/* Task that resumes a suspended coroutine */
+		inline Task_t CreateResumeTask(std::coroutine_handle<> handle)
+		{
+			return Task_t(CoroutineResumeTask_Name, ResumeTask(handle));
+		}
+
+		/* Returns the TaskManager of the calling TaskHandler, or the application one */
+		inline TaskManager* GetCoroutineManager()
+		{
+			const auto current = TaskHandler::GetCurrent();
+			if (current && current->GetManager())
+				return current->GetManager();
+			return InstanceApp();
+		}
+
+		template<typename T>
+		struct FutureAwaiter
+		{
+			Future<T> Awaited;
+
+			bool await_ready()const
+			{
+				return Awaited.IsReady();
+			}
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				Awaited.m_State->AddContinuation(CreateResumeTask(handle));
+			}
+			decltype(auto) await_resume()const
+			{
+				return Awaited.Get();
+			}
+		};
+
+		template<typename T>
+		struct TaskPromiseBase
+		{
+			Future<T> Result;
+
+			TaskPromiseBase()
+				:Result(FutureState<T>::Create(GetCoroutineManager()))
+			{
+
+			}
+			/* Only reached before the end when the coroutine was destroyed while suspended */
+			~TaskPromiseBase()
+			{
+				if (!Result.IsReady())
+					Result.m_State->SetException(std::make_exception_ptr(TaskDiscardedException()));
+			}
+			/* Coroutine frames come from the TaskPool too */
+			static void* operator new(const SIZET size)
+			{
+				return TaskPool::Allocate(size);
+			}
+			static void operator delete(void* ptr, const SIZET size)
+			{
+				TaskPool::Deallocate(ptr, size);
+			}
+			Task<T> get_return_object()
+			{
+				return Task<T>(Result);
+			}
+			std::suspend_never initial_suspend()noexcept
+			{
+				return {};
+			}
+			std::suspend_never final_suspend()noexcept
+			{
+				return {};
+			}
+			/* The exception goes to the Future, so Get and co_await on this Task rethrow it */
+			void unhandled_exception()
+			{
+				Result.m_State->SetException(std::current_exception());
+			}
+		};
+
+		template<typename T>
+		struct TaskPromise : TaskPromiseBase<T>
+		{
+			template<typename U>
+			void return_value(U&& value)
+			{
+				this->Result.m_State->SetValue(std::forward<U>(value));
+			}
+		};
+
+		template<>
+		struct TaskPromise<void> : TaskPromiseBase<void>
+		{
+			void return_void()
+			{
+				Result.m_State->SetValue();
+			}
+		};
+
+		struct ScheduleAwaiter
+		{
+			TaskManager* Manager;
+
+			bool await_ready()const
+			{
+				return false;
+			}
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				Manager->SendTask(CreateResumeTask(handle));
+			}
+			void await_resume()const
+			{
+
+			}
+		};
+
+		struct DispatcherAwaiter
+		{
+			TaskDispatcher* Dispatcher;
+			uint32 Handler;
+
+			bool await_ready()const
+			{
+				return false;
+			}
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				Dispatcher->SendTask(CreateResumeTask(handle), Handler);
+			}
+			void await_resume()const
+			{
+
+			}
+		};
+	}
+
+	/* Continues the coroutine on a TaskHandler of the given TaskManager */
+	inline Impl::ScheduleAwaiter Schedule(TaskManager* manager)
+	{
+		Assertion::WhenNullptr(manager, "Trying to schedule a coroutine on a nullptr manager.");
+		return Impl::ScheduleAwaiter{ manager };
+	}
+
+	/* Continues the coroutine on a TaskHandler of the given TaskDispatcher */
+	inline Impl::DispatcherAwaiter SwitchToDispatcher(TaskDispatcher* dispatcher, uint32 handler = static_cast<uint32>(-1))
+	{
+		Assertion::WhenNullptr(dispatcher, "Trying to switch a coroutine to a nullptr dispatcher.");
+		return Impl::DispatcherAwaiter{ dispatcher, handler };
+	}
+
+	/* Allows to co_await Futures */
+	template<typename T>
+	Impl::FutureAwaiter<T> operator co_await(const Future<T>& future)
+	{
+		return Impl::FutureAwaiter<T>{ future };
+	}
+}
+
+#endif /* GREAPER_COROUTINES */
+
+#endif /* GAF_COROUTINE_H */
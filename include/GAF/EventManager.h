@@ -20,12 +20,137 @@
 #define GAF_EVENTMANAGER_H 1
 
 #include "GAF/GAFPrerequisites.h"
+#include "GAF/Base/EpochReclaimer.h"
+#include "GAF/Base/Task.h"
+#include "GAF/Base/TaskPool.h"
 
 namespace gaf
 {
 	typedef uint32 EventID;
 	typedef uint32 EventListenerID;
 
+	/* How the listeners of an event are called when it's dispatched, chosen at RegisterEvent */
+	namespace EEventDispatch
+	{
+		enum Type
+		{
+			/* Every dispatch sends a task which calls the listeners */
+			ASYNC,
+			/* The listeners are called right away by the dispatching thread */
+			IMMEDIATE,
+			/* Dispatches are buffered until FlushEvents, which sends them all in a single task */
+			FRAME,
+			/* Like FRAME, but the dispatches of an event between flushes collapse into the last one */
+			COALESCED
+		};
+	}
+	const ANSICHAR* GetEventDispatchStr(EEventDispatch::Type dispatch);
+
+	/* 64-bit FNV-1a, constexpr so the names known at compile time are hashed by the compiler */
+	constexpr uint64 HashEventName(const ANSICHAR* name)
+	{
+		uint64 hash = 14695981039346656037ULL;
+		for (; *name != '\0'; ++name)
+		{
+			hash ^= static_cast<uint8>(*name);
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/* Name of an event along with its hash, the EventManager looks events up by the hash */
+	struct EventName
+	{
+		const ANSICHAR* Str;
+		uint64 Hash;
+
+		constexpr EventName(const ANSICHAR* str, const uint64 hash)
+			:Str(str)
+			,Hash(hash)
+		{
+
+		}
+		constexpr explicit EventName(const ANSICHAR* str)
+			:EventName(str, HashEventName(str))
+		{
+
+		}
+		/* The string must outlive the EventName */
+		explicit EventName(const std::string& str)
+			:EventName(str.c_str())
+		{
+
+		}
+	};
+
+	namespace Impl
+	{
+		/*
+			Reference counted record of a typed dispatch, allocated from the
+			TaskPool. Payloads up to InlineSize bytes are stored inside it,
+			bigger ones in another TaskPool block. Every pending listener call
+			holds a reference, so the payload is destroyed once all of them ran.
+		*/
+		struct EventPayload
+		{
+			static constexpr SIZET InlineSize = 48;
+
+			std::atomic<uint32> RefCount;
+			void* Payload;
+			void(*Destroy)(EventPayload* record);
+			alignas(std::max_align_t) uint8 Storage[InlineSize];
+
+			template<typename T, typename U>
+			static EventPayload* Create(U&& payload)
+			{
+				static_assert(alignof(T) <= alignof(std::max_align_t), "Event payloads can't be over-aligned.");
+				const auto record = TaskPool::New<EventPayload>();
+				record->RefCount.store(1, std::memory_order_relaxed);
+				if constexpr (sizeof(T) <= InlineSize)
+				{
+					record->Payload = new(record->Storage) T(std::forward<U>(payload));
+					record->Destroy = [](EventPayload* rec) { static_cast<T*>(rec->Payload)->~T(); };
+				}
+				else
+				{
+					record->Payload = TaskPool::New<T>(std::forward<U>(payload));
+					record->Destroy = [](EventPayload* rec) { TaskPool::Delete(static_cast<T*>(rec->Payload)); };
+				}
+				return record;
+			}
+
+			void AddRef();
+			void Release();
+		};
+
+		/* Owns a reference to an EventPayload, a null one is used by the untyped events */
+		class EventPayloadRef
+		{
+			EventPayload* m_Record;
+
+		public:
+			explicit EventPayloadRef(EventPayload* record = nullptr);
+			EventPayloadRef(const EventPayloadRef&) = delete;
+			EventPayloadRef(EventPayloadRef&& other)noexcept;
+			EventPayloadRef& operator=(const EventPayloadRef&) = delete;
+			EventPayloadRef& operator=(EventPayloadRef&& other)noexcept;
+			~EventPayloadRef();
+
+			/* Another reference to the same record */
+			EventPayloadRef Share()const;
+			void* GetPayload()const;
+		};
+
+		/* Process-wide index of every payload type, each EventManager maps it to its own EventID */
+		uint32 NextTypedEventSlot();
+		template<typename T>
+		uint32 TypedEventSlot()
+		{
+			static const uint32 slot = NextTypedEventSlot();
+			return slot;
+		}
+	}
+
 	class EventManager
 	{
 		static constexpr EventID AllEventsID = static_cast<EventID>(-2);
@@ -38,22 +163,6 @@ namespace gaf
 		{
 			std::function<void(EventID, void*)> ListeningFunction;
 			std::vector<EventID> ListeneningEvents; /* If its subscribed to all events there will an EventID which will be AllEventsID */
-			std::shared_mutex Mutex;
-			EventListener(const EventListener& other)
-				:ListeningFunction(other.ListeningFunction)
-				,ListeneningEvents(other.ListeneningEvents)
-			{
-
-			}
-			EventListener& operator=(const EventListener& other)
-			{
-				if (this != &other)
-				{
-					ListeningFunction = other.ListeningFunction;
-					ListeneningEvents = other.ListeneningEvents;
-				}
-				return *this;
-			}
 			EventListener()
 			{
 
@@ -64,26 +173,150 @@ namespace gaf
 			{
 
 			}
+			bool IsListeningAll()const
+			{
+				return !ListeneningEvents.empty() && ListeneningEvents[0] == AllEventsID;
+			}
 		};
 		
-		std::atomic<uint32> m_NextEventID;
 		std::atomic<uint32> m_NextListenerID;
 		
+		/*
+			Map nodes never move, so the index below keeps pointers to them,
+			unregistered nodes are retired as dispatches may still be reading
+			them.
+		*/
 		std::map<size_t, EventListener> m_RegisteredListeners;
-		std::shared_mutex m_ListenersLock;
+		/*
+			Listeners of every event, indexed by its EventID, so dispatching
+			only touches the interested ones. Listeners of all events are
+			only kept in m_AllEventsListeners.
+			This is the writers copy, dispatching reads the published snapshot.
+		*/
+		std::vector<std::vector<EventListener*>> m_EventListeners;
+		std::vector<EventListener*> m_AllEventsListeners;
+		/* Serializes the writers, dispatching never takes it */
+		std::mutex m_ListenersLock;
+
+		using ListenerVec = std::vector<const EventListener*>;
+		/*
+			Immutable copy of the index read by the dispatches, a new one is
+			published whenever the listeners change. Rows that didn't change
+			are shared with the previous snapshot, so only the table of rows
+			and the modified ones are copied.
+		*/
+		struct ListenerSnapshot
+		{
+			std::vector<const ListenerVec*> EventListeners;
+			const ListenerVec* AllEventsListeners = nullptr;
+			/* Indexed by EventID too, events without an entry are ASYNC */
+			std::vector<EEventDispatch::Type> DispatchModes;
+			/* EventID of every payload type, indexed by its Impl::TypedEventSlot */
+			std::vector<EventID> TypedEvents;
+		};
+		std::atomic<const ListenerSnapshot*> m_Snapshot;
+		/* Deletes the old snapshots, rows and listeners once no dispatch can be reading them */
+		EpochReclaimer m_Reclaimer;
+		/* Rows modified since the last snapshot */
+		std::vector<EventID> m_DirtyEvents;
+		bool m_AllEventsDirty;
+		/* Indexed by EventID, false for the unregistered events, guarded by m_ListenersLock */
+		std::vector<bool> m_ValidEvents;
+		/* Writers copy of the dispatch mode of every event */
+		std::vector<EEventDispatch::Type> m_DispatchModes;
+		bool m_DispatchModesDirty;
+		/* Writers copy of the EventID of every payload type */
+		std::vector<EventID> m_TypedEvents;
+		bool m_TypedEventsDirty;
+
+		struct PendingEvent
+		{
+			EventID Event;
+			void* Params;
+			Impl::EventPayloadRef Payload;
+		};
+		/* FRAME and COALESCED dispatches waiting for FlushEvents, in dispatch order */
+		std::vector<PendingEvent> m_PendingEvents;
+		/* Position + 1 in m_PendingEvents of the COALESCED events already pending, indexed by EventID */
+		std::vector<uint32> m_PendingSlots;
+		std::mutex m_PendingLock;
+
+		/* Adds or removes every subscription of the listener from the index, m_ListenersLock must be held */
+		void IndexListener(EventListener* listener);
+		void UnindexListener(EventListener* listener);
+		/* Subscribes the listener to a valid event unless it already was, m_ListenersLock must be held */
+		void AddListenerEvent(EventListener* listener, EventID event);
+		/* Publishes the modified rows as a new snapshot, m_ListenersLock must be held */
+		void PublishSnapshot();
+		/* Only registered events can be listened to, m_ListenersLock must be held */
+		bool IsValidEvent(EventID event)const;
+
+		/* Creates the tasks that call the listeners of the event, each one keeps a reference to the payload */
+		void GatherListenerTasks(EventID event, void* params, const Impl::EventPayloadRef& payload, std::vector<Task_t>& listenerTasks);
+		/* A lone listener is called right away, otherwise they're sent as a single batch */
+		static void SendListenerTasks(std::vector<Task_t>& listenerTasks);
+		/* Calls the listeners of the event on this thread */
+		void CallListeners(EventID event, void* params);
+		void QueueEvent(EventID event, void* params, Impl::EventPayloadRef&& payload, bool coalesce);
+		void FlushTask(std::vector<PendingEvent>& pendingEvents);
+		/* Dispatches a typed event which isn't IMMEDIATE */
+		void DispatchPayload(EventID event, EEventDispatch::Type dispatch, Impl::EventPayloadRef&& payload);
 
-		std::map<size_t, std::string> m_RegisteredEvents;
+		/* Maps a payload type to its EventID in this EventManager */
+		void SetTypedEvent(uint32 slot, EventID event);
+		EventID GetTypedEvent(uint32 slot);
+
+		template<typename T, typename U>
+		void DispatchTyped(U&& payload)
+		{
+			const auto event = GetEventID<T>();
+			Assertion::WhenEqual(event, NullEventID, "Trying to dispatch a typed event which wasn't registered.");
+			const auto dispatch = GetEventDispatch(event);
+			/* The listeners are done before returning, so there's no need for a record */
+			if (dispatch == EEventDispatch::IMMEDIATE)
+				CallListeners(event, const_cast<void*>(static_cast<const void*>(std::addressof(payload))));
+			else
+				DispatchPayload(event, dispatch, Impl::EventPayloadRef(Impl::EventPayload::Create<T>(std::forward<U>(payload))));
+		}
+
+		struct EventEntry
+		{
+			std::string Name;
+			uint64 Hash;
+			bool Registered;
+			/* Next event whose name has the same hash, NullEventID at the end of the chain */
+			EventID NextSameHash;
+		};
+		/* Interned names indexed by EventID, an unregistered name keeps its EventID in case it's registered again */
+		std::vector<EventEntry> m_Events;
+		/* First EventID of the names with each hash, the colliding ones are chained through NextSameHash */
+		std::unordered_map<uint64, EventID> m_EventsByHash;
 		std::shared_mutex m_EventsLock;
+
+		/* m_EventsLock must be held, NullEventID if the name wasn't registered */
+		EventID FindEvent(const EventName& eventName)const;
+		/*
+			m_EventsLock and m_ListenersLock must be held exclusively, the
+			dispatch mode is published by the caller.
+		*/
+		EventID RegisterEventLocked(const EventName& eventName, EEventDispatch::Type dispatch);
 	public:
 		static constexpr auto NullEventIDStr = "NullEvent";
 		static constexpr EventID NullEventID = static_cast<EventID>(-1);
 		static constexpr EventListenerID NullEventListenerID = static_cast<EventListenerID>(-1);
 
-		EventID RegisterEvent(const std::string& eventName);
+		/* Registering a name twice returns the same EventID, even if it was unregistered in between */
+		EventID RegisterEvent(const std::string& eventName, EEventDispatch::Type dispatch = EEventDispatch::ASYNC);
+		EventID RegisterEvent(const EventName& eventName, EEventDispatch::Type dispatch = EEventDispatch::ASYNC);
+		/* Registers every event under a single lock, the EventIDs are returned in the same order */
+		std::vector<EventID> RegisterEvents(const std::vector<std::string>& eventNames, EEventDispatch::Type dispatch = EEventDispatch::ASYNC);
+		std::vector<EventID> RegisterEvents(const std::vector<EventName>& eventNames, EEventDispatch::Type dispatch = EEventDispatch::ASYNC);
 		void UnregisterEvent(EventID event);
 		void UnregisterEvent(const std::string& eventName);
 		std::string GetEventName(EventID evt);
+		/* Hashed lookups, use GAF_EVENT("EventName") so the hash is computed at compile time */
 		EventID GetEventIDFromName(const std::string& eventName);
+		EventID GetEventIDFromName(const EventName& eventName);
 
 		void AddEventToListener(EventListenerID listener, EventID event);
 		void AddEventToListener(EventListenerID listener, const std::vector<EventID>& events);
@@ -92,10 +325,76 @@ namespace gaf
 
 		EventListenerID RegisterEventListener(const std::function<void(EventID, void*)>& evtHandling, EventID event);
 		EventListenerID RegisterEventListener(const std::function<void(EventID, void*)>& evtHandling, const std::vector<EventID>& events);
+		/*
+			Listens to all events, typed ones included, whose params point to
+			the payload. Their type is only known by the EventID, so compare
+			it with GetEventID<T>() before casting the params.
+		*/
 		EventListenerID RegisterEventListener(const std::function<void(EventID, void*)>& evtHandling);
 		void UnregisterEventListener(EventListenerID listener);
 		
+		/*
+			Calls the listeners of the event as its EEventDispatch mode says,
+			params must stay valid until they are called, which for FRAME
+			and COALESCED events is after the next FlushEvents. So the params
+			of a buffered event must point to data which outlives the flush,
+			such as the Window that moved, anything else, like a value in the
+			stack of the sender, must be sent as a typed payload, which the
+			EventManager copies.
+		*/
 		void DispatchEvent(EventID event, void* params);
+		/* The mode the event was registered with, ASYNC for unknown events */
+		EEventDispatch::Type GetEventDispatch(EventID event);
+		/*
+			Sends every FRAME and COALESCED dispatch since the last flush in a
+			single task, meant to be called once per frame by the main loop.
+		*/
+		void FlushEvents();
+
+		/*
+			Typed events, registered and dispatched by their payload type. The
+			payload is copied or moved into a record owned by the EventManager,
+			so it can live in the stack of the sender, and the listeners
+			receive a const T&. Typed events must not be sent with
+			DispatchEvent. Each EventManager keeps its own EventID for every
+			payload type.
+		*/
+		template<typename T>
+		EventID RegisterEvent(const std::string& eventName, EEventDispatch::Type dispatch = EEventDispatch::ASYNC)
+		{
+			const auto id = RegisterEvent(eventName, dispatch);
+			Assertion::WhenEqual(id, NullEventID, "Trying to register a typed event without name.");
+			SetTypedEvent(Impl::TypedEventSlot<T>(), id);
+			return id;
+		}
+
+		/* NullEventID until RegisterEvent<T> is called on this EventManager */
+		template<typename T>
+		EventID GetEventID()
+		{
+			return GetTypedEvent(Impl::TypedEventSlot<T>());
+		}
+
+		template<typename T, typename F>
+		EventListenerID RegisterEventListener(F&& listener)
+		{
+			const auto event = GetEventID<T>();
+			Assertion::WhenEqual(event, NullEventID, "Trying to listen to a typed event which wasn't registered.");
+			const std::function<void(const T&)> listenerFn(std::forward<F>(listener));
+			return RegisterEventListener([listenerFn](EventID, void* params) { listenerFn(*static_cast<const T*>(params)); }, event);
+		}
+
+		template<typename T>
+		void Dispatch(const T& payload)
+		{
+			DispatchTyped<T>(payload);
+		}
+
+		template<typename T>
+		void Dispatch(T&& payload)
+		{
+			DispatchTyped<typename std::decay<T>::type>(std::forward<T>(payload));
+		}
 
 		static EventManager& Instance();
 		static EventManager* InstancePtr();
@@ -106,4 +405,7 @@ namespace gaf
 	static EventManager* InstanceEvent() { return EventManager::InstancePtr(); }
 }
 
+/* EventName whose hash is a template argument, so it's always computed at compile time */
+#define GAF_EVENT(name) gaf::EventName(name, std::integral_constant<uint64, gaf::HashEventName(name)>::value)
+
 #endif /* GAF_EVENTMANAGER_H */
\ No newline at end of file
@@ -53,21 +53,20 @@ namespace gaf
 		}
 	};
 
+	struct FileAsyncResult
+	{
+		FileSysError_t Error;
+		SIZET Bytes;
+	};
+
 	class FileSystem : public TaskDispatcher
 	{
 		static constexpr SIZET NumberIOHandlers = 4;
-		using AsyncType = bool;
-		static constexpr AsyncType AsyncRead = true;
-		static constexpr AsyncType AsyncWrite = false;
 		Directory* m_RootDir;
 		
-		using AsyncVec = std::vector<std::pair<FileAsync, AsyncType>>;
-		AsyncVec m_AsyncOperations;
-		std::shared_mutex m_AsyncMutex;
-		
-		void AsyncReadFn(AsyncVec::iterator async, const std::function<void(FileAsync*)>& beginReadFunc,
+		void AsyncReadFn(FileAsync async, const std::function<void(FileAsync*)>& beginReadFunc,
 			const std::function<void(FileAsync*)>& endReadFunc);
-		void AsyncWriteFn(AsyncVec::iterator async, const std::function<void(FileAsync*)>& beginWriteFunc,
+		void AsyncWriteFn(FileAsync async, const std::function<void(FileAsync*)>& beginWriteFunc,
 			const std::function<void(FileAsync*)>& endWriteFunc);
 
 		static constexpr auto OnFileBeginReadAsync = "FileBeginReadAsync";
@@ -124,6 +123,20 @@ namespace gaf
 		FileSysError_t StartAsyncWrite(File* file, void* buffer, SIZET bufferSize, const std::function<void(FileAsync*)>& beginWriteFunc,
 			const std::function<void(FileAsync*)>& endWriteFunc);
 
+		/*
+			Reads bufferSize bytes from the current offset of the file into the buffer on an IO TaskHandler,
+			the returned Future gets the error and the number of bytes read, it can be awaited from a coroutine.
+			The file and the buffer must be alive until the Future is ready.
+		*/
+		Future<FileAsyncResult> ReadAsync(File* file, void* buffer, SIZET bufferSize);
+
+		/*
+			Writes bufferSize bytes from the buffer into the current offset of the file on an IO TaskHandler,
+			the returned Future gets the error and the number of bytes written, it can be awaited from a coroutine.
+			The file and the buffer must be alive until the Future is ready.
+		*/
+		Future<FileAsyncResult> WriteAsync(File* file, void* buffer, SIZET bufferSize);
+
 		/*
 			Creates a File structure which won't be handled by the FileSystem, instead will be handled by you.
 			This File structure helps with the manipulation of it, use the DeleteExternalFile function in order 
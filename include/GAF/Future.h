@@ -0,0 +1,448 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_FUTURE_H
+#define GAF_FUTURE_H 1
+
+#include "GAF/Base/Task.h"
+#include "GAF/Base/EventCount.h"
+
+namespace gaf
+{
+	template<typename T> class Future;
+
+	/*
+		Rethrown by Future::Get when the task that had to fulfill it was
+		destroyed without running, because it was cancelled, it missed its
+		deadline or the TaskManager didn't accept it.
+	*/
+	class TaskDiscardedException : public std::exception
+	{
+	public:
+		const char* what()const noexcept override
+		{
+			return "The task of the Future was discarded without running.";
+		}
+	};
+
+	namespace Impl
+	{
+		template<typename T> struct TaskPromiseBase;
+		template<typename T> struct TaskPromise;
+		template<typename T> struct FutureAwaiter;
+		CreateTaskName(FutureContinuationTask);
+
+		/*
+			Reference counted state shared between a Future and the task that
+			fulfills it, allocated from the TaskPool.
+			Continuations are kept in a lock-free list which gets closed when
+			the state becomes ready, anything added after that is scheduled
+			right away.
+		*/
+		class FutureStateBase
+		{
+			struct Continuation
+			{
+				Task_t Task;
+				Continuation* Next;
+				bool RunInline;
+			};
+			static Continuation* const ClosedList;
+
+			std::atomic<uint32> m_RefCount;
+			std::atomic_bool m_Ready;
+			std::atomic<Continuation*> m_Continuations;
+			EventCount m_ReadyEvent;
+			std::exception_ptr m_Exception;
+			std::atomic_bool m_HasException;
+
+		protected:
+			TaskManager* m_Manager;
+			/* Frees the derived state, called when the last reference is released */
+			virtual void Destroy() = 0;
+
+		public:
+			/* Inputs left to complete, used by WhenAll and WhenAny */
+			std::atomic<uint32> PendingInputs;
+
+			explicit FutureStateBase(TaskManager* manager);
+			virtual ~FutureStateBase() = default;
+			FutureStateBase(const FutureStateBase&) = delete;
+			FutureStateBase& operator=(const FutureStateBase&) = delete;
+
+			void AddRef();
+			void Release();
+
+			bool IsReady()const;
+			/* Wakes the waiters and schedules the continuations, the caller must hold a reference */
+			void MarkReady();
+			/* Keeps the exception for Get to rethrow, only the first one stored is kept */
+			void StoreException(std::exception_ptr exception);
+			/* Stores the exception and marks the state as ready */
+			void SetException(std::exception_ptr exception);
+			/* Only meaningful once the state is ready */
+			bool HasException()const;
+			const std::exception_ptr& GetException()const;
+			/* Rethrows the stored exception, if any, once the state is ready */
+			void RethrowException()const;
+			/*
+				Runs the task once the state is ready, on the TaskManager or on the
+				thread that makes it ready if runInline is true, which is meant for
+				tiny tasks only.
+			*/
+			void AddContinuation(Task_t task, bool runInline = false);
+			/* Helps the TaskManager running pending tasks until the state is ready */
+			void Wait();
+
+			TaskManager* GetManager()const;
+		};
+
+		template<typename T>
+		class FutureState : public FutureStateBase
+		{
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type m_Value;
+			bool m_HasValue;
+		protected:
+			void Destroy()override
+			{
+				TaskPool::Delete(this);
+			}
+		public:
+			explicit FutureState(TaskManager* manager)
+				:FutureStateBase(manager)
+				,m_HasValue(false)
+			{
+
+			}
+			~FutureState()
+			{
+				if (m_HasValue)
+					reinterpret_cast<T*>(&m_Value)->~T();
+			}
+			static FutureState* Create(TaskManager* manager)
+			{
+				return TaskPool::New<FutureState>(manager);
+			}
+			template<typename U>
+			void SetValue(U&& value)
+			{
+				new(&m_Value) T(std::forward<U>(value));
+				m_HasValue = true;
+				MarkReady();
+			}
+			const T& GetValue()const
+			{
+				return *reinterpret_cast<const T*>(&m_Value);
+			}
+		};
+
+		template<>
+		class FutureState<void> : public FutureStateBase
+		{
+		protected:
+			void Destroy()override
+			{
+				TaskPool::Delete(this);
+			}
+		public:
+			explicit FutureState(TaskManager* manager)
+				:FutureStateBase(manager)
+			{
+
+			}
+			static FutureState* Create(TaskManager* manager)
+			{
+				return TaskPool::New<FutureState>(manager);
+			}
+			void SetValue()
+			{
+				MarkReady();
+			}
+		};
+
+		/* Calls fn and stores its result, if any, in the state, or the exception it throws */
+		template<typename R, typename F, typename... Args>
+		void Fulfill(FutureState<R>* state, F& fn, Args&&... args)
+		{
+			try
+			{
+				if constexpr (std::is_void<R>::value)
+				{
+					fn(std::forward<Args>(args)...);
+					state->SetValue();
+				}
+				else
+				{
+					state->SetValue(fn(std::forward<Args>(args)...));
+				}
+			}
+			catch (...)
+			{
+				state->SetException(std::current_exception());
+			}
+		}
+
+		/*
+			Task function which fulfills the state by calling fn, if it's
+			destroyed without running the state gets a TaskDiscardedException,
+			so discarded tasks never leave their Future waiting forever.
+		*/
+		template<typename R, typename F>
+		class FulfillTask
+		{
+			FutureState<R>* m_State;
+			F m_Fn;
+
+		public:
+			FulfillTask(FutureState<R>* state, F fn)
+				:m_State(state)
+				,m_Fn(std::move(fn))
+			{
+				m_State->AddRef();
+			}
+			FulfillTask(FulfillTask&& other)noexcept(std::is_nothrow_move_constructible<F>::value)
+				:m_State(other.m_State)
+				,m_Fn(std::move(other.m_Fn))
+			{
+				other.m_State = nullptr;
+			}
+			FulfillTask(const FulfillTask&) = delete;
+			FulfillTask& operator=(const FulfillTask&) = delete;
+			FulfillTask& operator=(FulfillTask&&) = delete;
+			~FulfillTask()
+			{
+				if (!m_State)
+					return;
+				m_State->SetException(std::make_exception_ptr(TaskDiscardedException()));
+				m_State->Release();
+			}
+			void operator()()
+			{
+				const auto state = m_State;
+				m_State = nullptr;
+				Fulfill(state, m_Fn);
+				state->Release();
+			}
+		};
+
+		template<typename T, typename F>
+		struct ContinuationResult
+		{
+			using Type = typename std::invoke_result<F, const T&>::type;
+		};
+
+		template<typename F>
+		struct ContinuationResult<void, F>
+		{
+			using Type = typename std::invoke_result<F>::type;
+		};
+	}
+
+	/*
+		Handle to the result of a task, copies share the same result.
+		Get and Wait help the TaskManager running pending tasks until the
+		result is ready instead of blocking.
+	*/
+	template<typename T>
+	class Future
+	{
+		Impl::FutureState<T>* m_State;
+
+		template<typename U> friend class Future;
+		friend class TaskManager;
+		friend class TaskDispatcher;
+		friend class Strand;
+		template<typename U> friend Future<void> WhenAll(const std::vector<Future<U>>& futures);
+		template<typename U> friend Future<SIZET> WhenAny(const std::vector<Future<U>>& futures);
+		friend struct Impl::TaskPromiseBase<T>;
+		friend struct Impl::TaskPromise<T>;
+		friend struct Impl::FutureAwaiter<T>;
+
+		/* Takes a new reference to the state */
+		explicit Future(Impl::FutureState<T>* state)
+			:m_State(state)
+		{
+			if (m_State)
+				m_State->AddRef();
+		}
+
+		/* Creates the future and the task that fulfills it by calling fn */
+		template<typename F>
+		static Task_t CreateFulfillTask(const ANSICHAR* name, F fn, TaskManager* manager, Future& future)
+		{
+			future = Future(Impl::FutureState<T>::Create(manager));
+			return Task_t(name, Impl::FulfillTask<T, F>(future.m_State, std::move(fn)));
+		}
+
+	public:
+		Future()
+			:m_State(nullptr)
+		{
+
+		}
+		Future(const Future& other)
+			:m_State(other.m_State)
+		{
+			if (m_State)
+				m_State->AddRef();
+		}
+		Future(Future&& other)noexcept
+			:m_State(other.m_State)
+		{
+			other.m_State = nullptr;
+		}
+		Future& operator=(const Future& other)
+		{
+			if (this != &other)
+			{
+				if (other.m_State)
+					other.m_State->AddRef();
+				if (m_State)
+					m_State->Release();
+				m_State = other.m_State;
+			}
+			return *this;
+		}
+		Future& operator=(Future&& other)noexcept
+		{
+			if (this != &other)
+			{
+				if (m_State)
+					m_State->Release();
+				m_State = other.m_State;
+				other.m_State = nullptr;
+			}
+			return *this;
+		}
+		~Future()
+		{
+			if (m_State)
+				m_State->Release();
+		}
+
+		/* Returns false on default constructed futures */
+		bool IsValid()const
+		{
+			return m_State != nullptr;
+		}
+
+		bool IsReady()const
+		{
+			Assertion::WhenNullptr(m_State, "Trying to use an invalid Future.");
+			return m_State->IsReady();
+		}
+
+		void Wait()const
+		{
+			Assertion::WhenNullptr(m_State, "Trying to wait for an invalid Future.");
+			m_State->Wait();
+		}
+
+		/*
+			Waits for the result and returns it, rethrows the exception thrown
+			by the task instead if there was one, or a TaskDiscardedException
+			if the task was destroyed without running.
+		*/
+		decltype(auto) Get()const
+		{
+			Wait();
+			m_State->RethrowException();
+			if constexpr (!std::is_void<T>::value)
+				return m_State->GetValue();
+		}
+
+		/* True once ready if Get would throw */
+		bool HasException()const
+		{
+			Assertion::WhenNullptr(m_State, "Trying to use an invalid Future.");
+			return m_State->IsReady() && m_State->HasException();
+		}
+
+		/*
+			Sends fn to the TaskManager once this result is ready, fn receives
+			the result, or nothing on Future<void>, and its return value becomes
+			the result of the returned Future.
+			If this Future holds an exception fn isn't called and the returned
+			Future gets the same exception.
+		*/
+		template<typename F>
+		Future<typename Impl::ContinuationResult<T, F>::Type> Then(F fn)const
+		{
+			using R = typename Impl::ContinuationResult<T, F>::Type;
+			Assertion::WhenNullptr(m_State, "Trying to add a continuation to an invalid Future.");
+			Future<R> next(Impl::FutureState<R>::Create(m_State->GetManager()));
+			auto thenFn = [self = *this, fn = std::move(fn)]() mutable -> R
+			{
+				self.m_State->RethrowException();
+				if constexpr (std::is_void<T>::value)
+					return fn();
+				else
+					return fn(self.m_State->GetValue());
+			};
+			m_State->AddContinuation(Task_t(Impl::FutureContinuationTask_Name, Impl::FulfillTask<R, decltype(thenFn)>(next.m_State, std::move(thenFn))));
+			return next;
+		}
+	};
+
+	/*
+		Returns a Future which gets ready once every given future is ready,
+		if any of them holds an exception the returned Future gets the first
+		one stored.
+	*/
+	template<typename T>
+	Future<void> WhenAll(const std::vector<Future<T>>& futures)
+	{
+		Assertion::WhenTrue(futures.empty(), "Trying to wait for all the futures of an empty list.");
+		Future<void> all(Impl::FutureState<void>::Create(futures.front().m_State->GetManager()));
+		all.m_State->PendingInputs.store(static_cast<uint32>(futures.size()), std::memory_order_relaxed);
+		for (auto it = futures.begin(); it != futures.end(); ++it)
+		{
+			/* The continuation runs while the input state is alive, so it can be read directly */
+			auto inputFn = [all, input = it->m_State]()
+			{
+				if (input->HasException())
+					all.m_State->StoreException(input->GetException());
+				if (all.m_State->PendingInputs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					all.m_State->SetValue();
+			};
+			it->m_State->AddContinuation(Task_t(Impl::FutureContinuationTask_Name, std::move(inputFn)), true);
+		}
+		return all;
+	}
+
+	/* Returns a Future with the index of the first given future that gets ready */
+	template<typename T>
+	Future<SIZET> WhenAny(const std::vector<Future<T>>& futures)
+	{
+		Assertion::WhenTrue(futures.empty(), "Trying to wait for any future of an empty list.");
+		Future<SIZET> any(Impl::FutureState<SIZET>::Create(futures.front().m_State->GetManager()));
+		any.m_State->PendingInputs.store(1, std::memory_order_relaxed);
+		for (SIZET i = 0; i < futures.size(); ++i)
+		{
+			auto inputFn = [any, i]()
+			{
+				if (any.m_State->PendingInputs.exchange(0, std::memory_order_acq_rel) == 1)
+					any.m_State->SetValue(i);
+			};
+			futures[i].m_State->AddContinuation(Task_t(Impl::FutureContinuationTask_Name, std::move(inputFn)), true);
+		}
+		return any;
+	}
+}
+
+#endif /* GAF_FUTURE_H */
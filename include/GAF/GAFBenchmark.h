@@ -0,0 +1,79 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#pragma once
+
+#ifndef GREAPER_GAF_BENCHMARK_H
+#define GREAPER_GAF_BENCHMARK_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+/*
+	Throughput and latency benchmarks of the concurrency primitives, run it
+	as the GAFTest once the Application is up. Besides the usual log, every
+	measure is written to GAFBenchmark_Result.json and
+	GAFBenchmark_Result.csv, so runs can be compared in order to catch
+	regressions of the queues or the scheduler.
+	The pool size is changed while measuring the scaling curves, it's
+	restored afterwards.
+*/
+class GAFBenchmark : public Test
+{
+public:
+	/* A single measure, a row of the CSV and an object of the JSON */
+	struct Metric
+	{
+		std::string Benchmark;
+		std::string Case;
+		/* Threads involved, producers plus consumers or TaskHandlers */
+		uint32 Threads;
+		double Value;
+		std::string Unit;
+	};
+private:
+	std::vector<Metric> m_Metrics;
+
+	void AddMetric(std::string benchmark, std::string caseName, uint32 threads, double value, std::string unit);
+	/* Powers of two up to the number of logical cores, which is always included */
+	static std::vector<uint32> GetThreadCounts();
+
+	void QueueBenchmark(ResultVec& resultVec);
+	void TaskThroughputBenchmark(ResultVec& resultVec);
+	void TaskLatencyBenchmark(ResultVec& resultVec);
+	void DispatcherFairnessBenchmark(ResultVec& resultVec);
+	void ScalingBenchmark(ResultVec& resultVec);
+	void EventRoutingBenchmark(ResultVec& resultVec);
+	void EventDispatchBenchmark(ResultVec& resultVec);
+	void EventNameBenchmark(ResultVec& resultVec);
+
+	void WriteResults()const;
+public:
+
+	GAFBenchmark();
+	GAFBenchmark(const GAFBenchmark&) = default;
+	GAFBenchmark(GAFBenchmark&&)noexcept = default;
+	GAFBenchmark& operator=(const GAFBenchmark&) = default;
+	GAFBenchmark& operator=(GAFBenchmark&&)noexcept = default;
+	~GAFBenchmark() = default;
+
+	/* Runs every benchmark, then writes the log and the JSON and CSV results */
+	void Run();
+
+	const std::vector<Metric>& GetMetrics()const;
+};
+
+#endif /* GREAPER_GAF_BENCHMARK_H */
@@ -32,13 +32,16 @@ namespace gaf
 	class DayTime;
 	class Directory;
 	class IDisplayAdapter;
+	class EpochReclaimer;
 	class EventManager;
+	class Fiber;
 	class File;
 	class FileSystem;
 	class HWDetector;
 	class HIDDevice;
 	class InputManager;
 	class InputSystem;
+	class JobCounter;
 	class LogManager;
 	class IMonitor;
 	typedef std::pair<int32, int32> Position_t;
@@ -52,6 +55,7 @@ namespace gaf
 	class ResourceImporter;
 	class ResourceLocation;
 	class ResourceManager;
+	class Strand;
 	class TaskDispatcher;
 	class TaskHandler;
 	class TaskManager;
@@ -26,12 +26,27 @@ class GAFTest : public Test
 	void FileSysTest(ResultVec& resultVec);
 	void LogTest(ResultVec& resultVec);
 	void EventTest(ResultVec& resultVec);
+	void EventRoutingTest(ResultVec& resultVec);
 	void PropertyTest(ResultVec& resultVec);
 	void WindowTest(ResultVec& resultVec);
 	void CryptoTest(ResultVec& resultVec);
 	void ResourceTest(ResultVec& resultVec);
 	void CommandTest(ResultVec& resultVec);
 	void InputTest(ResultVec& resultVec);
+	void TaskObjectTest(ResultVec& resultVec);
+	void WorkStealingTest(ResultVec& resultVec);
+	void TaskTest(ResultVec& resultVec);
+	void StatsTest(ResultVec& resultVec);
+	void TraceTest(ResultVec& resultVec);
+	void TaskGraphTest(ResultVec& resultVec);
+	void DispatcherTest(ResultVec& resultVec);
+	void FutureTest(ResultVec& resultVec);
+	void CoroutineTest(ResultVec& resultVec);
+	void StrandTest(ResultVec& resultVec);
+	void TimerTest(ResultVec& resultVec);
+	void CancellationTest(ResultVec& resultVec);
+	void JobCounterTest(ResultVec& resultVec);
+	void ParallelTest(ResultVec& resultVec);
 public:
 
 	GAFTest();
@@ -27,6 +27,9 @@ namespace gaf
 	class HWDetector
 	{
 		CPUInfo m_Info;
+		/* Empty when the OS couldn't tell us the topology */
+		std::vector<LogicalCoreInfo> m_Topology;
+		uint32 m_NumNUMANodes;
 		HWDetector();
 		~HWDetector() = default;
 		static HWDetector* m_Instance;
@@ -37,6 +40,13 @@ namespace gaf
 
 		uint32 GetNumberLogicalCores()const;
 		uint32 GetNumberPhysicalCores()const;
+		uint32 GetNumberNUMANodes()const;
+		/*
+			Returns the logical cores sorted by their index, with their physical
+			core and NUMA node, empty if the topology couldn't be read.
+			On Windows only the first processor group is reported.
+		*/
+		const std::vector<LogicalCoreInfo>& GetCoreTopology()const;
 		CPUInfo GetCPUInfo()const;
 		uint64 GetRAMAmount()const;
 		std::string GetOSNameAndVer();
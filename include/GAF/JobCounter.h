@@ -0,0 +1,83 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#pragma once
+
+#ifndef GAF_JOBCOUNTER_H
+#define GAF_JOBCOUNTER_H 1
+
+#include "GAF/GAFPrerequisites.h"
+#include "GAF/Base/EventCount.h"
+
+namespace gaf
+{
+	/*
+		Counts the jobs of a batch that haven't finished yet, the tasks sent
+		with TaskManager::SendTask(task, counter) add one and remove it once
+		they have run or have been destroyed without running.
+		TaskManager::WaitForCounter waits until it drops to a given value,
+		with GREAPER_TASKMAN_FIBERS the waiting task is suspended instead of
+		blocking its TaskHandler.
+		Once WaitForCounter returns with a target of 0 no task touches the
+		counter anymore, so it can be destroyed right away.
+	*/
+	class JobCounter
+	{
+#if GREAPER_TASKMAN_FIBERS
+		struct Waiter
+		{
+			Fiber* WaitingFiber;
+			TaskManager* Manager;
+			uint32 Target;
+		};
+		/* Fibers suspended by WaitForCounter */
+		std::mutex m_WaitersMutex;
+		std::vector<Waiter> m_Waiters;
+		std::atomic<uint32> m_NumWaiters;
+
+		/* Returns false if the counter is already at or below target, so the fiber must go on */
+		bool AddWaiter(Fiber* fiber, TaskManager* manager, uint32 target);
+		/* Hands the fibers whose target was reached to their TaskManager */
+		void ResumeWaiters();
+#endif
+		std::atomic<uint32> m_Value;
+		/* Decrements still touching the counter, it can't be destroyed until they finish */
+		std::atomic<uint32> m_Notifying;
+		/* The threads that aren't fibers park here */
+		EventCount m_Event;
+
+		/* Waits for the decrements in progress */
+		void WaitForNotifiers()const;
+	public:
+		explicit JobCounter(uint32 value = 0);
+		~JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		void Add(uint32 count = 1);
+
+		/* Wakes the waiters whose target is reached */
+		void Decrement(uint32 count = 1);
+
+		uint32 GetValue()const;
+
+		friend class TaskManager;
+		friend class TaskHandler;
+	};
+}
+
+#endif /* GAF_JOBCOUNTER_H */
@@ -54,12 +54,15 @@ namespace gaf
 		static std::vector<MessageInfo> m_Messages;
 		static std::shared_mutex m_MessageMutex;
 		std::vector<std::pair<bool, LogHandler>> m_LogHandlers;
+		/* One per LogHandler slot, so every handler sees the messages in order */
+		std::vector<std::unique_ptr<Strand>> m_HandlerStrands;
 		std::shared_mutex m_HandlersMutex;
 		std::atomic<LogHandlerID> m_DefaultLogHandler;
 		static File* m_DefaultLogFile;
 		void DefaultLoggingFn(const std::string& msg, const DayTime& time, const LogLevel level);
 		
-		void LogTask(const MessageInfo& msg);
+		/* Runs a single LogHandler, the message is shared by the tasks of every handler */
+		void LogTask(const MessageInfo& msg, LogHandlerID handler);
 
 		LogManager();
 		~LogManager();
@@ -23,8 +23,231 @@
 
 namespace gaf
 {
-	template<typename T>
+	/*
+		Bounded lock-free MPMCQueue, selected when Capacity is not 0.
+		It's a ring of Capacity cells where every cell carries a sequence
+		number which tells producers and consumers if that cell is ready to be
+		written or read, so pushing and popping is just a CAS on the tail or
+		the head plus a release store on the cell. Head and tail live on
+		separate cache lines to avoid false sharing between producers and
+		consumers.
+		PushBack and EmplaceBack spin until there's room in the ring, use
+		TryPush or TryEmplace in order to handle the back-pressure yourself.
+	*/
+	template<typename T, SIZET Capacity = 0>
 	class MPMCQueue
+	{
+		static_assert(IsPowerOfTwo(Capacity), "MPMCQueue capacity must be a power of two.");
+		static constexpr SIZET Mask = Capacity - 1;
+
+		struct Cell
+		{
+			std::atomic<SIZET> Sequence;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+		};
+
+		std::unique_ptr<Cell[]> m_Cells;
+		alignas(CACHE_LINE_SIZE) std::atomic<SIZET> m_Tail;
+		alignas(CACHE_LINE_SIZE) std::atomic<SIZET> m_Head;
+		uint8 m_Padding[CACHE_LINE_SIZE - sizeof(std::atomic<SIZET>)];
+
+		/* Claims the next cell to write to, returns nullptr if the ring is full */
+		Cell* ClaimPushCell(SIZET& pos)
+		{
+			pos = m_Tail.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell* cell = &m_Cells[pos & Mask];
+				const auto seq = cell->Sequence.load(std::memory_order_acquire);
+				const auto diff = static_cast<SSIZET>(seq) - static_cast<SSIZET>(pos);
+				if (diff == 0)
+				{
+					if (m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						return cell;
+				}
+				else if (diff < 0)
+				{
+					return nullptr;
+				}
+				else
+				{
+					pos = m_Tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/* Claims the next cell to read from, returns nullptr if the ring is empty */
+		Cell* ClaimPopCell(SIZET& pos)
+		{
+			pos = m_Head.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Cell* cell = &m_Cells[pos & Mask];
+				const auto seq = cell->Sequence.load(std::memory_order_acquire);
+				const auto diff = static_cast<SSIZET>(seq) - static_cast<SSIZET>(pos + 1);
+				if (diff == 0)
+				{
+					if (m_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						return cell;
+				}
+				else if (diff < 0)
+				{
+					return nullptr;
+				}
+				else
+				{
+					pos = m_Head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+	public:
+		MPMCQueue()
+			:m_Cells(new Cell[Capacity])
+			,m_Tail(0)
+			,m_Head(0)
+		{
+			for (SIZET i = 0; i < Capacity; ++i)
+				m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+		~MPMCQueue()
+		{
+			const auto tail = m_Tail.load(std::memory_order_acquire);
+			for (auto pos = m_Head.load(std::memory_order_acquire); pos != tail; ++pos)
+				reinterpret_cast<T*>(&m_Cells[pos & Mask].Storage)->~T();
+		}
+		MPMCQueue(const MPMCQueue&) = delete;
+		MPMCQueue(MPMCQueue&&) = delete;
+		MPMCQueue& operator=(const MPMCQueue&) = delete;
+		MPMCQueue& operator=(MPMCQueue&&) = delete;
+
+		/*
+			Constructs the element in place if there's room in the ring.
+			Return:
+				true - The element was queued.
+				false - The queue was full, the arguments are left untouched.
+		*/
+		template<typename... Args>
+		bool TryEmplace(Args&&... args)
+		{
+			SIZET pos;
+			Cell* cell = ClaimPushCell(pos);
+			if (!cell)
+				return false;
+			new(&cell->Storage) T(std::forward<Args>(args)...);
+			cell->Sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool TryPush(const T& val)
+		{
+			return TryEmplace(val);
+		}
+		bool TryPush(T&& val)
+		{
+			return TryEmplace(std::move(val));
+		}
+
+		void PushBack(const T& val)
+		{
+			while (!TryEmplace(val))
+				std::this_thread::yield();
+		}
+		void PushBack(T&& val)
+		{
+			while (!TryEmplace(std::move(val)))
+				std::this_thread::yield();
+		}
+
+		template<typename... Args>
+		void EmplaceBack(Args&&... args)
+		{
+			while (!TryEmplace(std::forward<Args>(args)...))
+				std::this_thread::yield();
+		}
+
+		/*
+			Moves as many elements as there's room for, from the beginning of
+			vals, reserving their cells with a single CAS on the tail.
+			Returns the number of elements queued, the rest are left untouched.
+		*/
+		SIZET TryPushBulk(T* vals, const SIZET count)
+		{
+			if (count == 0)
+				return 0;
+			auto pos = m_Tail.load(std::memory_order_relaxed);
+			SIZET num;
+			for (;;)
+			{
+				const auto head = m_Head.load(std::memory_order_acquire);
+				const auto used = static_cast<SSIZET>(pos - head);
+				if (used >= static_cast<SSIZET>(Capacity))
+					return 0;
+				num = Min(count, Capacity - static_cast<SIZET>(Max(used, (SSIZET)0)));
+				if (m_Tail.compare_exchange_weak(pos, pos + num, std::memory_order_relaxed))
+					break;
+			}
+			for (SIZET i = 0; i < num; ++i)
+			{
+				Cell* cell = &m_Cells[(pos + i) & Mask];
+				/* The consumer which claimed the old element of this cell may still be moving it out */
+				while (cell->Sequence.load(std::memory_order_acquire) != pos + i)
+					std::this_thread::yield();
+				new(&cell->Storage) T(std::move(vals[i]));
+				cell->Sequence.store(pos + i + 1, std::memory_order_release);
+			}
+			return num;
+		}
+
+		/* Moves every element of vals into the queue, spinning while it's full */
+		void PushBulk(T* vals, SIZET count)
+		{
+			while (count > 0)
+			{
+				const auto num = TryPushBulk(vals, count);
+				if (num == 0)
+					std::this_thread::yield();
+				vals += num;
+				count -= num;
+			}
+		}
+
+		bool PopFront(T& val)
+		{
+			SIZET pos;
+			Cell* cell = ClaimPopCell(pos);
+			if (!cell)
+				return false;
+			T* item = reinterpret_cast<T*>(&cell->Storage);
+			val = std::move(*item);
+			item->~T();
+			cell->Sequence.store(pos + Mask + 1, std::memory_order_release);
+			return true;
+		}
+
+		/* The size is just an approximation while there are other threads using the queue */
+		SIZET Size()const
+		{
+			const auto head = m_Head.load(std::memory_order_relaxed);
+			const auto tail = m_Tail.load(std::memory_order_relaxed);
+			return tail > head ? tail - head : 0;
+		}
+
+		bool Empty()const
+		{
+			return Size() == 0;
+		}
+
+		static constexpr SIZET GetCapacity()
+		{
+			return Capacity;
+		}
+	};
+
+	/*
+		Unbounded MPMCQueue, guarded by a mutex.
+	*/
+	template<typename T>
+	class MPMCQueue<T, 0>
 	{
 		std::queue<T> m_Data;
 		std::shared_mutex m_Mutex;
@@ -84,6 +307,18 @@ namespace gaf
 			return *this;
 		}
 
+		/* The unbounded queue never applies back-pressure, so TryPush always succeeds */
+		bool TryPush(const T& val)
+		{
+			PushBack(val);
+			return true;
+		}
+		bool TryPush(T&& val)
+		{
+			PushBack(std::move(val));
+			return true;
+		}
+
 		void PushBack(const T& val)
 		{
 			m_Mutex.lock();
@@ -93,7 +328,7 @@ namespace gaf
 		void PushBack(T&& val)
 		{
 			m_Mutex.lock();
-			m_Data.push(val);
+			m_Data.push(std::move(val));
 			m_Mutex.unlock();
 		}
 
@@ -101,7 +336,21 @@ namespace gaf
 		void EmplaceBack(Args&&... args)
 		{
 			m_Mutex.lock();
-			m_Data.emplace(std::forward<Args>(args));
+			m_Data.emplace(std::forward<Args>(args)...);
+			m_Mutex.unlock();
+		}
+
+		/* Moves every element of vals into the queue under a single lock, so it always returns count */
+		SIZET TryPushBulk(T* vals, const SIZET count)
+		{
+			PushBulk(vals, count);
+			return count;
+		}
+		void PushBulk(T* vals, const SIZET count)
+		{
+			m_Mutex.lock();
+			for (SIZET i = 0; i < count; ++i)
+				m_Data.push(std::move(vals[i]));
 			m_Mutex.unlock();
 		}
 
@@ -110,7 +359,7 @@ namespace gaf
 			m_Mutex.lock();
 			if (!m_Data.empty())
 			{
-				val = m_Data.front();
+				val = std::move(m_Data.front());
 				m_Data.pop();
 				m_Mutex.unlock();
 				return true;
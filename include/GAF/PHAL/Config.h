@@ -85,18 +85,91 @@
 #endif
 #endif
 
-#ifndef GREAPER_DEBUG_TASKMAN
+#ifndef GREAPER_DEBUG_WINDOW
 #if GREAPER_DEBUG
-#define GREAPER_DEBUG_TASKMAN 1
+#define GREAPER_DEBUG_WINDOW 1
 #else
-#define GREAPER_DEBUG_TASKMAN 0
+#define GREAPER_DEBUG_WINDOW 0
 #endif
 #endif
 
-#ifndef GREAPER_DEBUG_WINDOW
-#if GREAPER_DEBUG
-#define GREAPER_DEBUG_WINDOW 1
+/*
+	Capacity of the shared TaskManager queues, one per ETaskPriority, when
+	it's not 0 the lock-free bounded MPMCQueue is used, otherwise the
+	unbounded mutex guarded one is used. Must be a power of two.
+	Tasks sent from the pool stay in the local queue of their TaskHandler,
+	so these only hold the ones sent from other threads. When they are full
+	the sender runs the task itself.
+*/
+#ifndef GREAPER_TASKMAN_QUEUE_CAPACITY
+#define GREAPER_TASKMAN_QUEUE_CAPACITY 1024
+#endif
+
+/*
+	Capacity of the queue of every TaskDispatcher handler, with the same
+	rules as GREAPER_TASKMAN_QUEUE_CAPACITY. The cells are allocated up
+	front for each handler, so it's kept smaller than the shared ones.
+	When it's full the sender waits for room.
+*/
+#ifndef GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY
+#define GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY 256
+#endif
+
+/*
+	Enables the coroutine support of GAF/Coroutine.h, needs a compiler
+	with C++20 coroutines.
+*/
+#ifndef GREAPER_COROUTINES
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define GREAPER_COROUTINES 1
 #else
-#define GREAPER_DEBUG_WINDOW 0
+#define GREAPER_COROUTINES 0
+#endif
+#endif
+/*
+	Keeps per task name counters and histograms of the wait and execution
+	times of the tasks run by the TaskHandlers, see GAF/TaskStats.h.
+*/
+#ifndef GREAPER_TASKMAN_STATS
+#define GREAPER_TASKMAN_STATS 1
+#endif
+
+/*
+	Enables the timeline recording of GAF/TaskTrace.h and GAF_TRACE_SCOPE,
+	the recording itself must still be started at runtime.
+*/
+#ifndef GREAPER_TASKMAN_TRACE
+#define GREAPER_TASKMAN_TRACE 1
+#endif
+
+/*
+	Runs the tasks of the pool TaskHandlers on fibers, so a task that calls
+	TaskManager::WaitForCounter is suspended and its thread keeps executing
+	other tasks meanwhile. Only available on Linux, elsewhere
+	WaitForCounter helps executing pending tasks until the counter is done.
+*/
+#ifndef GREAPER_TASKMAN_FIBERS
+#define GREAPER_TASKMAN_FIBERS 0
+#endif
+#if GREAPER_TASKMAN_FIBERS && !PLATFORM_LINUX
+#undef GREAPER_TASKMAN_FIBERS
+#define GREAPER_TASKMAN_FIBERS 0
+#endif
+
+/*
+	Stack size of every fiber, see GREAPER_TASKMAN_FIBERS. There's a guard
+	page below it, so an overflow crashes instead of corrupting memory.
+*/
+#ifndef GREAPER_TASKMAN_FIBER_STACK_SIZE
+#define GREAPER_TASKMAN_FIBER_STACK_SIZE (256 * 1024)
+#endif
+
+/*
+	Maximum number of fibers the TaskManager creates for the waits, see
+	GREAPER_TASKMAN_FIBERS. Each TaskHandler always gets the one it starts
+	on. Once reached, a task that waits for a JobCounter keeps its thread
+	and helps executing pending tasks until the counter is done.
+*/
+#ifndef GREAPER_TASKMAN_MAX_FIBERS
+#define GREAPER_TASKMAN_MAX_FIBERS 256
 #endif
-#endif
\ No newline at end of file
@@ -362,7 +362,9 @@ typedef PlatformTypes::SSIZET			SSIZET;
 #include <bitset>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <deque>
+#include <exception>
 #include <fstream>
 #include <functional>
 #include <initializer_list>
@@ -383,5 +385,6 @@ typedef PlatformTypes::SSIZET			SSIZET;
 #include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
\ No newline at end of file
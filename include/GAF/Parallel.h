@@ -0,0 +1,199 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_PARALLEL_H
+#define GAF_PARALLEL_H 1
+
+#include "GAF/Application.h"
+
+namespace gaf
+{
+	/*
+		Parallel algorithms built on top of the TaskManager.
+		Ranges are split recursively in halves, the right half is sent as a
+		task and the left half is processed by the calling thread, so the
+		halves that get stolen are the biggest ones. Waiting for the right
+		half helps the TaskManager, usually running that same half if nobody
+		stole it.
+		Ranges smaller than the grain size run inline, a grain size of 0
+		chooses one from the number of TaskHandlers.
+		An exception thrown by a callback is rethrown to the caller once
+		every half sent is done, if several halves throw only one of them
+		is rethrown.
+	*/
+	namespace Impl
+	{
+		CreateTaskName(ParallelTask);
+
+		/* Smallest grain size chosen automatically, see the ParallelTest in GAFTest */
+		static constexpr SIZET MinAutoGrainSize = 2048;
+		/* Chunks per TaskHandler when the grain size is chosen automatically */
+		static constexpr SIZET AutoChunksPerHandler = 8;
+
+		inline SIZET ComputeGrainSize(TaskManager* manager, const SIZET count, const SIZET grain)
+		{
+			if (grain != 0)
+				return grain;
+			const auto handlers = Max(manager->GetNumberTaskHandlers(), static_cast<SIZET>(1));
+			return Max(count / (handlers * AutoChunksPerHandler), MinAutoGrainSize);
+		}
+
+		template<typename Index, typename F>
+		void ParallelForRange(TaskManager* manager, const Index begin, const Index end, const SIZET grain, const F& fn)
+		{
+			if (static_cast<SIZET>(end - begin) <= grain)
+			{
+				for (auto i = begin; i < end; ++i)
+					fn(i);
+				return;
+			}
+			const auto mid = begin + (end - begin) / 2;
+			auto right = manager->SendTask(ParallelTask_Name, [manager, mid, end, grain, &fn]() { ParallelForRange(manager, mid, end, grain, fn); });
+			try
+			{
+				ParallelForRange(manager, begin, mid, grain, fn);
+			}
+			catch (...)
+			{
+				/* The right half references fn, so it must be done before unwinding */
+				right.Wait();
+				throw;
+			}
+			right.Get();
+		}
+
+		template<typename T, typename Index, typename MapFn, typename ReduceFn>
+		T ParallelReduceRange(TaskManager* manager, const Index begin, const Index end, const SIZET grain, const T& identity, const MapFn& map, const ReduceFn& reduce)
+		{
+			if (static_cast<SIZET>(end - begin) <= grain)
+			{
+				T result = identity;
+				for (auto i = begin; i < end; ++i)
+					result = reduce(result, map(i));
+				return result;
+			}
+			const auto mid = begin + (end - begin) / 2;
+			auto right = manager->SendTask(ParallelTask_Name, [manager, mid, end, grain, &identity, &map, &reduce]()
+			{
+				return ParallelReduceRange(manager, mid, end, grain, identity, map, reduce);
+			});
+			T left = identity;
+			try
+			{
+				left = ParallelReduceRange(manager, begin, mid, grain, identity, map, reduce);
+			}
+			catch (...)
+			{
+				right.Wait();
+				throw;
+			}
+			return reduce(left, right.Get());
+		}
+
+		template<typename RandomIt, typename Compare>
+		void ParallelSortRange(TaskManager* manager, const RandomIt first, const RandomIt last, const SIZET grain, const Compare& comp)
+		{
+			if (static_cast<SIZET>(last - first) <= grain)
+			{
+				std::sort(first, last, comp);
+				return;
+			}
+			const auto mid = first + (last - first) / 2;
+			auto right = manager->SendTask(ParallelTask_Name, [manager, mid, last, grain, &comp]() { ParallelSortRange(manager, mid, last, grain, comp); });
+			try
+			{
+				ParallelSortRange(manager, first, mid, grain, comp);
+			}
+			catch (...)
+			{
+				right.Wait();
+				throw;
+			}
+			right.Get();
+			std::inplace_merge(first, mid, last, comp);
+		}
+	}
+
+	/* Calls fn(i) for every i in [begin, end) */
+	template<typename Index, typename F>
+	void ParallelFor(TaskManager* manager, const Index begin, const Index end, const SIZET grain, const F& fn)
+	{
+		Assertion::WhenNullptr(manager, "Trying to run a ParallelFor with a nullptr manager.");
+		if (end <= begin)
+			return;
+		Impl::ParallelForRange(manager, begin, end, Impl::ComputeGrainSize(manager, static_cast<SIZET>(end - begin), grain), fn);
+	}
+
+	template<typename Index, typename F>
+	void ParallelFor(const Index begin, const Index end, const SIZET grain, const F& fn)
+	{
+		ParallelFor(static_cast<TaskManager*>(InstanceApp()), begin, end, grain, fn);
+	}
+
+	/*
+		Returns reduce(...reduce(identity, map(begin))..., map(end - 1)),
+		reduce must be associative and identity its neutral element, as
+		partial results are combined in any grouping.
+	*/
+	template<typename T, typename Index, typename MapFn, typename ReduceFn>
+	T ParallelReduce(TaskManager* manager, const Index begin, const Index end, const SIZET grain, const T& identity, const MapFn& map, const ReduceFn& reduce)
+	{
+		Assertion::WhenNullptr(manager, "Trying to run a ParallelReduce with a nullptr manager.");
+		if (end <= begin)
+			return identity;
+		return Impl::ParallelReduceRange(manager, begin, end, Impl::ComputeGrainSize(manager, static_cast<SIZET>(end - begin), grain), identity, map, reduce);
+	}
+
+	template<typename T, typename Index, typename MapFn, typename ReduceFn>
+	T ParallelReduce(const Index begin, const Index end, const SIZET grain, const T& identity, const MapFn& map, const ReduceFn& reduce)
+	{
+		return ParallelReduce(static_cast<TaskManager*>(InstanceApp()), begin, end, grain, identity, map, reduce);
+	}
+
+	/* Stores fn(*(first + i)) into *(out + i), both ranges must be random access */
+	template<typename InputIt, typename OutputIt, typename F>
+	void ParallelTransform(TaskManager* manager, const InputIt first, const InputIt last, const OutputIt out, const SIZET grain, const F& fn)
+	{
+		const auto transformFn = [first, out, &fn](const SIZET i) { *(out + i) = fn(*(first + i)); };
+		ParallelFor(manager, static_cast<SIZET>(0), static_cast<SIZET>(last - first), grain, transformFn);
+	}
+
+	template<typename InputIt, typename OutputIt, typename F>
+	void ParallelTransform(const InputIt first, const InputIt last, const OutputIt out, const SIZET grain, const F& fn)
+	{
+		ParallelTransform(static_cast<TaskManager*>(InstanceApp()), first, last, out, grain, fn);
+	}
+
+	/* Merge sort, halves are sorted in parallel and then merged, it's not stable */
+	template<typename RandomIt, typename Compare>
+	void ParallelSort(TaskManager* manager, const RandomIt first, const RandomIt last, const Compare& comp, const SIZET grain)
+	{
+		Assertion::WhenNullptr(manager, "Trying to run a ParallelSort with a nullptr manager.");
+		if (last - first < 2)
+			return;
+		Impl::ParallelSortRange(manager, first, last, Impl::ComputeGrainSize(manager, static_cast<SIZET>(last - first), grain), comp);
+	}
+
+	template<typename RandomIt, typename Compare = std::less<>>
+	void ParallelSort(const RandomIt first, const RandomIt last, const Compare& comp = Compare(), const SIZET grain = 0)
+	{
+		ParallelSort(static_cast<TaskManager*>(InstanceApp()), first, last, comp, grain);
+	}
+}
+
+#endif /* GAF_PARALLEL_H */
@@ -21,6 +21,7 @@
 
 #include "GAF/GAFPrerequisites.h"
 #include "GAF/EventManager.h"
+#include "GAF/Future.h"
 
 namespace gaf
 {
@@ -161,6 +162,13 @@ namespace gaf
 		void Unload()override;
 	};
 
+	/* Payload of the OnResourceDataDestroying event, the ResourceData is already gone when the listeners get it */
+	struct ResourceDataDestroyingEvent
+	{
+		ResourceDataID ID;
+		std::string Name;
+	};
+
 	class ResourceData
 	{
 	public:
@@ -202,7 +210,8 @@ namespace gaf
 		void ChangeSourceData(ResourceLocation* location);
 		
 		void Load();
-		void LoadAsync();
+		/* Loads the data on the TaskManager, the returned Future gets ready once it's loaded */
+		Future<void> LoadAsync();
 
 		void Unload();
 
@@ -0,0 +1,101 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_STRAND_H
+#define GAF_STRAND_H 1
+
+#include "GAF/TaskManager.h"
+
+namespace gaf
+{
+	/*
+		Serial executor on top of the TaskManager, the tasks posted to a
+		Strand are executed one at a time and in the same order they were
+		posted, but on the pool TaskHandlers instead of a dedicated thread.
+		While the Strand has pending tasks a single drain task is queued on
+		the pool, which executes them until the Strand is empty or it has
+		executed MaxTasksPerRun, then it queues itself again so a busy
+		Strand can't keep a TaskHandler forever.
+		The pending tasks are still executed if the Strand is destroyed
+		before they finish. Once the TaskManager is shut down the tasks
+		are executed by the thread that posts them, and if the drain task
+		is discarded, the pending tasks are discarded with it.
+	*/
+	class Strand
+	{
+		struct State
+		{
+			TaskManager* Manager;
+			ETaskPriority::Type Priority;
+			MPMCQueue<Task_t> Tasks;
+			/* Posted and not finished tasks, the one that moves it from 0 queues the drain task */
+			std::atomic<uint32> Pending;
+		};
+		std::shared_ptr<State> m_State;
+
+		/* Pool task that drains the Strand, or discards its tasks if it's destroyed without running */
+		class DrainTask;
+
+		/* Executes the pending tasks of a Strand, runs as a pool task */
+		static void Drain(const std::shared_ptr<State>& state);
+		/* Destroys the pending tasks of a Strand without running them */
+		static void Discard(const std::shared_ptr<State>& state);
+		/* Queues the drain task on the pool */
+		static void Schedule(const std::shared_ptr<State>& state);
+		/*
+			Replaces the Strand the calling thread is executing and returns the
+			previous one, TaskManager::WaitForCounter takes it along when a
+			suspended task is resumed on another thread.
+		*/
+		static const void* ExchangeCurrent(const void* state);
+		friend class TaskManager;
+
+	public:
+		/* Tasks executed by a single drain task before giving the TaskHandler back to the pool */
+		static constexpr uint32 MaxTasksPerRun = 32;
+
+		/* The drain tasks are sent with the given priority */
+		explicit Strand(TaskManager* manager, ETaskPriority::Type priority = ETaskPriority::NORMAL);
+		~Strand() = default;
+		Strand(const Strand&) = delete;
+		Strand& operator=(const Strand&) = delete;
+
+		/* Queues a task, it will be executed after every task posted before it */
+		void Post(Task_t task);
+
+		/* Posts fn as a task named name, the returned Future gets the value returned by fn */
+		template<typename F>
+		Future<typename std::invoke_result<F>::type> Post(const ANSICHAR* name, F fn)
+		{
+			Future<typename std::invoke_result<F>::type> future;
+			Post(decltype(future)::CreateFulfillTask(name, std::move(fn), m_State->Manager, future));
+			return future;
+		}
+
+		/* Executes the task right away when called from a task of this Strand, otherwise it's posted */
+		void Dispatch(Task_t task);
+
+		/* True when the calling thread is executing a task of this Strand */
+		bool IsRunningInThisThread()const;
+
+		/* Posted tasks that haven't finished yet */
+		uint32 GetPendingTasks()const;
+	};
+}
+
+#endif /* GAF_STRAND_H */
@@ -0,0 +1,134 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_TASKGRAPH_H
+#define GAF_TASKGRAPH_H 1
+
+#include "GAF/TaskManager.h"
+
+namespace gaf
+{
+	/*
+		Set of tasks with dependencies between them, every node keeps an
+		atomic counter of unfinished predecessors and when a node finishes
+		it schedules the successors which counter reached 0, running one of
+		them right away on the same thread.
+		Build the graph, then Run it and Wait for it, waiting helps the
+		TaskManager executing pending tasks instead of blocking.
+		A finished graph can be run again, but it can't be modified while
+		it's running.
+		If a node is discarded without running, because the TaskManager
+		was shut down, it still counts as finished, and so do the nodes
+		it makes ready, so Wait always returns. WasCancelled tells it
+		happened.
+	*/
+	class TaskGraph
+	{
+	public:
+		typedef uint32 NodeID;
+		static constexpr NodeID NullNodeID = static_cast<NodeID>(-1);
+
+	private:
+		struct Node
+		{
+			Task_t Task;
+			std::vector<NodeID> Successors;
+			uint32 NumPredecessors;
+			std::atomic<uint32> PendingPredecessors;
+			std::atomic_bool Finished;
+
+			explicit Node(Task_t task)
+				:Task(std::move(task))
+				,NumPredecessors(0)
+				,PendingPredecessors(0)
+				,Finished(false)
+			{
+
+			}
+		};
+
+		TaskManager* m_Manager;
+		std::vector<std::unique_ptr<Node>> m_Nodes;
+		std::atomic<uint32> m_PendingNodes;
+		/* Threads inside ExecuteNode, the graph can't be destroyed until they leave */
+		std::atomic<uint32> m_Executing;
+		AtomicFlag m_Running;
+		/* Set when a node was discarded during the last Run */
+		std::atomic_bool m_Cancelled;
+		/* Set by the first node that throws, the nodes that didn't start yet are discarded */
+		std::atomic_bool m_Failed;
+		/* Exception of the first node that threw during the last Run, written by whoever sets m_Failed */
+		std::exception_ptr m_Exception;
+		/* Waiting threads park here when there's nothing to help with */
+		EventCount m_Finished;
+
+		/* Pool task of a node, it cancels the node if it's destroyed without running */
+		class NodeTask;
+
+		/* Sends a node whose predecessors have finished to the TaskManager */
+		void ScheduleNode(NodeID node);
+		/*
+			Runs a node and then the chain of successors that it makes ready,
+			if cancelled the nodes are marked as finished without running.
+			Nodes are run through TaskHandler::Execute, so a node discarded
+			by its token or deadline cancels the chain like a dropped one.
+		*/
+		void ExecuteNode(NodeID node, bool cancelled = false);
+		/* Kahn's topological sort, true when some node can never become ready */
+		bool HasCycle()const;
+
+	public:
+		TaskGraph(TaskManager* manager);
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+		/* Waits for the graph if it's still running */
+		~TaskGraph();
+
+		/* Adds a task without predecessors */
+		NodeID AddTask(Task_t task);
+
+		/* Adds a task that will be executed after all of its predecessors finish */
+		NodeID AddTask(Task_t task, std::initializer_list<NodeID> predecessors);
+
+		/* Makes successor wait for predecessor */
+		void AddDependency(NodeID predecessor, NodeID successor);
+
+		/* Sends every task without predecessors to the TaskManager */
+		void Run();
+
+		/*
+			Waits until every task of the graph has finished, then rethrows
+			the exception of the first task that threw, if any.
+		*/
+		void Wait();
+
+		/* Waits until the given task has finished */
+		void Wait(NodeID node);
+
+		bool IsFinished()const;
+
+		bool IsFinished(NodeID node)const;
+
+		/* True if some node of the last Run was discarded without running, or a node threw */
+		bool WasCancelled()const;
+
+		SIZET GetNumTasks()const;
+	};
+}
+
+#endif /* GAF_TASKGRAPH_H */
@@ -21,63 +21,244 @@
 
 #include "GAF/GAFPrerequisites.h"
 #include "GAF/MPMCQueue.h"
+#include "GAF/Base/CPUInfo.h"
 #include "GAF/Base/Task.h"
 #include "GAF/Base/TaskHandler.h"
 #include "GAF/Base/TaskDispatcher.h"
+#include "GAF/Base/TimerWheel.h"
+#include "GAF/Base/Fiber.h"
+#include "GAF/JobCounter.h"
+#include "GAF/Future.h"
 
 namespace gaf
 {
+	/* Where the pool TaskHandlers run */
+	namespace ETaskPlacement
+	{
+		enum Type
+		{
+			/* The OS decides */
+			NONE,
+			/* Every TaskHandler is pinned to a physical core, grouped by NUMA node */
+			PHYSICAL_CORES,
+			/* Every TaskHandler is pinned to a logical core, SMT siblings are used once every physical core has one */
+			LOGICAL_CORES
+		};
+	}
+	const ANSICHAR* GetTaskPlacementStr(ETaskPlacement::Type placement);
+
+	/* What TaskManager::Shutdown does with the tasks that are still pending */
+	namespace ETaskShutdown
+	{
+		enum Type
+		{
+			/* They are executed, if they don't finish before the timeout the rest are cancelled */
+			DRAIN,
+			/* They are destroyed without running, the running ones still finish */
+			CANCEL
+		};
+	}
+	const ANSICHAR* GetTaskShutdownStr(ETaskShutdown::Type mode);
+
+	/* What TaskManager::Shutdown did and how long every phase took */
+	struct TaskShutdownReport
+	{
+		ETaskShutdown::Type Mode;
+		/* The drain didn't finish in time and the remaining tasks were cancelled */
+		bool TimedOut;
+		/* Pending tasks destroyed without running */
+		SIZET CancelledTasks;
+		/* Tasks sent from outside the TaskHandlers after the intake was closed, they were destroyed too */
+		SIZET RejectedTasks;
+		std::chrono::microseconds StopIntakeTime;
+		std::chrono::microseconds DrainTime;
+		std::chrono::microseconds JoinTime;
+	};
+
 	/*
 		Class that gives to the overloaded class a set of functions that
 		enable task dispatching and handling and makes small operations
 		easier and paralelized
+		The pool is a work stealing scheduler, tasks sent from a pool
+		TaskHandler go to its own queue, tasks sent from any other thread go
+		to the global queue, and idle TaskHandlers steal from random ones.
+		Every queue is split by task priority, higher priorities are taken
+		first, but every StarvationPeriod tasks a TaskHandler looks at the
+		lower priorities first so they always make progress.
+		The size of the pool is managed by a controller thread, which
+		samples the pending tasks and the idle TaskHandlers and adds or
+		retires them between the limits given by the TaskManagerMinHandlers
+		and TaskManagerMaxHandlers properties.
+		The TaskHandlers can be pinned to cores through the
+		TaskManagerPlacement property, then stealers rob the TaskHandlers
+		of their own NUMA node first.
 	*/
 	class TaskManager
 	{
-		MPMCQueue<Task_t> m_Tasks;
-		std::vector<TaskHandler> m_TaskHandlers;
+		/* Maximum number of pool TaskHandlers per logical core */
+		static constexpr SIZET MaxHandlersPerCore = 4;
+		/* Time between two samples of the pool controller */
+		static constexpr std::chrono::milliseconds ControllerInterval{ 50 };
+		/* Consecutive samples with pending tasks and no idle TaskHandler needed to add one */
+		static constexpr uint32 GrowSamples = 2;
+		/* Consecutive samples with idle TaskHandlers and no pending tasks needed to retire one */
+		static constexpr uint32 ShrinkSamples = 40;
+		/* Every how many tasks a TaskHandler gives the lower priorities the first turn, realtime ones still go first */
+		static constexpr uint32 StarvationPeriod = 16;
+		/* Global queues, one per priority */
+		TaskQueue_t m_Tasks[ETaskPriority::COUNT];
+		/* Idle pool TaskHandlers park here until a task is sent */
+		EventCount m_WakeUp;
+		/* Slots are allocated up-front and never moved, so stealers can access them without locking */
+		std::vector<std::unique_ptr<TaskHandler>> m_TaskHandlers;
+		std::atomic<uint32> m_NumTaskHandlers;
 		std::shared_mutex m_HandlersLock;
+		/* Serializes the pool resizes, retired threads are joined holding only this one */
+		std::mutex m_ResizeMutex;
 		
-		struct Dispatcher
-		{
-			struct DHandler
-			{
-				MPMCQueue<Task_t> Tasks;
-				TaskHandler Handler;
-				DHandler();
-				~DHandler() {};
-				DHandler(const DHandler& other);
-				DHandler(DHandler&& other)noexcept;
-				DHandler& operator=(const DHandler& other);
-				DHandler& operator=(DHandler&& other)noexcept;
-			};
-
-			std::shared_mutex HandlerMutex;
-			std::vector<DHandler> Handlers;
-
-			Dispatcher() {};
-			~Dispatcher() {};
-			Dispatcher(const Dispatcher& other);
-			Dispatcher(Dispatcher&& other)noexcept;
-			Dispatcher& operator=(const Dispatcher& other);
-			Dispatcher& operator=(Dispatcher&& other)noexcept;
-		};
-
-		std::map<size_t, Dispatcher> m_Dispatchers;
+		/* Map nodes never move, so the TaskDispatchers can keep a pointer to their group */
+		std::map<size_t, TaskHandlerGroup> m_Dispatchers;
 		std::shared_mutex m_DispatchersLock;
 
 		/* Hardware concurrency */
 		SIZET m_StartingNum;
+		SIZET m_MaxHandlers;
+
+		/* Limits of the pool size, the controller keeps the number of TaskHandlers between them */
+		std::atomic<uint32> m_MinTaskHandlers;
+		std::atomic<uint32> m_MaxTaskHandlers;
+		/* Pool controller thread */
+		std::thread m_ControllerThread;
+		std::mutex m_ControllerMutex;
+		std::condition_variable m_ControllerCondition;
+		bool m_ControllerStop;
+		/* Only touched by the controller thread */
+		uint32 m_GrowSamples;
+		uint32 m_ShrinkSamples;
+		SIZET m_LastPending;
+
+		/* Guarded by m_HandlersLock */
+		ETaskPlacement::Type m_Placement;
+		/* Cores given to the pool TaskHandlers in order, empty when they aren't pinned */
+		std::vector<LogicalCoreInfo> m_PlacementCores;
+		/* True when the TaskHandlers are pinned to more than one NUMA node */
+		std::atomic<bool> m_StealByNode;
+
+		/* Drives SendTaskAfter, SendTaskAt and SendPeriodic */
+		TimerWheel m_Timers;
+
+		/* Cleared by Shutdown, after that only the TaskHandlers can send tasks */
+		std::atomic_bool m_AcceptingTasks;
+		std::atomic<SIZET> m_RejectedTasks;
+		AtomicFlag m_IsShutDown;
+		/* Set by Shutdown while cancelling, the TaskHandlers destroy the tasks they take instead of running them */
+		std::atomic_bool m_DiscardTasks;
+		std::atomic<SIZET> m_NumDiscarded;
+
+#if GREAPER_TASKMAN_FIBERS
+		/* Every fiber created so far, they are destroyed with the TaskManager */
+		std::vector<std::unique_ptr<Fiber>> m_Fibers;
+		std::mutex m_FibersMutex;
+		/* Fibers that aren't in the middle of a task */
+		MPMCQueue<Fiber*> m_FreeFibers;
+		/* Suspended fibers whose counter reached its target, the TaskHandlers resume them before taking new tasks */
+		MPMCQueue<Fiber*> m_ReadyFibers;
+		/* Cheaper to check than the queue, which takes a lock */
+		std::atomic<uint32> m_NumReadyFibers;
+
+		/*
+			Returns a fiber which isn't running a task, creating it if there's
+			none. When limited, returns nullptr instead of going over
+			GREAPER_TASKMAN_MAX_FIBERS.
+		*/
+		Fiber* AcquireFiber(bool limited = false);
+		void ReleaseFiber(Fiber* fiber);
+		/* Queues a suspended fiber, so a TaskHandler resumes it */
+		void ResumeFiber(Fiber* fiber);
+		bool TryAcquireReadyFiber(Fiber*& fiber);
+		friend class JobCounter;
+#endif
+
+		/* Gives the wrapper the name, priority, deadline and token of the task */
+		static void CopyTaskInfo(Task_t& wrapper, Task_t& task);
+		/* Wraps the task so it decrements the counter once it has run or it's destroyed */
+		static void AttachCounter(Task_t& task, JobCounter& counter);
+
+		/* Returns false and destroys the tasks if the intake is closed and they weren't sent by a TaskHandler */
+		bool AcceptTasks(Task_t* tasks, SIZET count);
+		/*
+			True if every queue is empty and every TaskHandler is parked,
+			executed gets the number of tasks taken so far, so two calls
+			with the same result mean nothing happened in between.
+		*/
+		bool IsIdle(uint64& executed);
+		/* Destroys every pending task without running it, returns how many */
+		SIZET DiscardPendingTasks();
+		/* Stops the controller and the TaskHandlers, the dispatcher ones first */
+		void JoinTaskHandlers();
+
+		/* Pins the pool TaskHandler to its core, m_HandlersLock must be held */
+		void PlaceTaskHandler(SIZET index);
+
+		/* The controller thread function */
+		void RunController();
+		/* Samples the pool and adds or retires a TaskHandler if needed */
+		void UpdatePoolSize();
+
+		/*
+			Retrieves the next task that a pool TaskHandler must execute,
+			first from its own queue, then from the global one and then
+			stealing from the other TaskHandlers.
+		*/
+		bool AcquireTask(TaskHandler* handler, Task_t& task);
+		/* Steals a task from the pool TaskHandlers, beginning at a given one, thief can be nullptr */
+		bool StealTask(TaskHandler* thief, uint32 start, Task_t& task);
+		/* Moves the remaining tasks of a stopped TaskHandler to the global queue */
+		void DrainTaskHandler(TaskHandler* handler);
+		friend class TaskHandler;
+
+		/* Group of a registered dispatcher, straight from its handle */
+		static TaskHandlerGroup& GetHandlerGroup(TaskDispatcher* dispatcher);
+		/* Picks the less loaded of two random handlers, HandlerMutex must be held */
+		static uint32 SelectHandler(TaskHandlerGroup& group);
+		/* Handler that gets the tasks of a given key, wraps the task so it holds the key slot until it finishes, HandlerMutex must be held */
+		static uint32 AttachKeySlot(TaskHandlerGroup& group, SIZET key, Task_t& task);
+		/* HandlerMutex must be held */
+		static void PushToHandler(TaskHandlerGroup& group, uint32 handler, Task_t&& task);
 
 	protected:
-		void SendTask(TaskDispatcher* dispatcher, const Task_t& task, uint32 handler = static_cast<uint32>(-1));
+		/*
+			Without a handler the task goes to the less loaded of two random
+			handlers of the dispatcher.
+		*/
+		void SendTask(TaskDispatcher* dispatcher, Task_t task, uint32 handler = static_cast<uint32>(-1));
+		/*
+			Tasks with the same key always go to the same handler, so they are
+			executed in order and keep its caches warm. Keys are hashed into
+			TaskHandlerGroup::NumKeySlots slots, and a slot only moves to
+			another handler when it has no tasks left, so adding handlers to
+			the dispatcher never reorders a key.
+		*/
+		void SendKeyedTask(TaskDispatcher* dispatcher, Task_t task, SIZET key);
+		/*
+			Sends count tasks to the handlers of a dispatcher, every handler
+			gets its share with a single push and a single wake-up. Without
+			a handler the batch is split so their queues end up as even as
+			possible, keeping the tasks in order inside each share.
+		*/
+		void SendTasks(TaskDispatcher* dispatcher, Task_t* tasks, SIZET count, uint32 handler = static_cast<uint32>(-1));
 		uint32 GetPendingTask(TaskDispatcher* dispatcher, uint32 handler);
 		friend class TaskDispatcher;
 	public:
 		TaskManager();
 		virtual ~TaskManager();
 		
-		void RegisterTaskDispatcher(TaskDispatcher* dispatcher, uint32 handlers);
+		/*
+			Registers a dispatcher with its dedicated handlers, their threads
+			are named gaf-threadName-index, or after the dispatcher if
+			threadName is empty.
+		*/
+		void RegisterTaskDispatcher(TaskDispatcher* dispatcher, uint32 handlers, const std::string& threadName = std::string());
 
 		void UnregisterTaskDispatcher(TaskDispatcher* dispatcher);
 
@@ -85,6 +266,23 @@ namespace gaf
 
 		void ChangeNumberOfHandlers(TaskDispatcher* dispatcher, uint32 handlers);
 
+		/*
+			Pins the handlers of a dispatcher to the given logical cores, the
+			handler i goes to logicalCores[i % logicalCores.size()], an empty
+			vector lets them run anywhere. The pool TaskHandlers are moved out
+			of those cores while there are others to use.
+		*/
+		void SetDispatcherAffinity(TaskDispatcher* dispatcher, const std::vector<uint32>& logicalCores);
+
+		/*
+			Changes where the pool TaskHandlers run, usually set through the
+			TaskManagerPlacement property. If there are more TaskHandlers
+			than cores they wrap around.
+		*/
+		void SetTaskPlacement(ETaskPlacement::Type placement);
+
+		ETaskPlacement::Type GetTaskPlacement();
+
 		/*
 			Returns the number of TaskHandlers currently available
 		*/
@@ -92,17 +290,167 @@ namespace gaf
 
 		/*
 			Sends a task to the TaskHandlers in order to be executed
-			as soon as possible
+			as soon as possible after the pending tasks of its priority,
+			if the queue is full the task will be executed by the calling
+			thread.
 		*/
 		void SendTask(Task_t task);
 
 		/*
-			Changes the number of TaskHandlers even though if there
-			are too many tasks queued the TaskManager will add more
+			Same as SendTask, but when the intake is closed by Shutdown the
+			task is left untouched and false is returned, so the caller can
+			run it by itself instead of losing it.
+		*/
+		bool TrySendTask(Task_t& task);
+
+		/*
+			Sends count tasks at once, the tasks are moved out of the array.
+			Every run of tasks with the same priority is queued with a single
+			reservation and the sleeping TaskHandlers are woken once, as many
+			as tasks were queued. The tasks that don't fit in a full queue are
+			executed by the calling thread.
+		*/
+		void SendTasks(Task_t* tasks, SIZET count);
+		void SendTasks(std::vector<Task_t>& tasks);
+
+		/*
+			Adds one to the counter for every task sent, and the task removes
+			it once it has run or it has been destroyed without running, see
+			WaitForCounter.
+		*/
+		void SendTask(Task_t task, JobCounter& counter);
+		void SendTasks(Task_t* tasks, SIZET count, JobCounter& counter);
+
+		/*
+			Returns once the counter is at or below target. When called from
+			a task run by a pool TaskHandler with GREAPER_TASKMAN_FIBERS, the
+			task is suspended and its thread keeps executing other tasks, the
+			task is resumed afterwards, maybe on another thread, so it must not
+			hold locks or keep thread_local values across the call. Otherwise,
+			or once GREAPER_TASKMAN_MAX_FIBERS are in use, the calling thread
+			executes pending tasks meanwhile, as HelpUntil.
+		*/
+		void WaitForCounter(JobCounter& counter, uint32 target = 0);
+
+		/*
+			Sends the task to the TaskHandlers once the delay has passed, it's
+			rounded up to TimerWheel::TickDuration. The returned handle can
+			cancel it until then.
+		*/
+		TimerHandle SendTaskAfter(std::chrono::steady_clock::duration delay, Task_t task);
+
+		/* Same as SendTaskAfter, but at a given time */
+		TimerHandle SendTaskAt(std::chrono::steady_clock::time_point time, Task_t task);
+
+		/*
+			Sends the task to the TaskHandlers every interval, the first time
+			one interval from now, until the returned handle cancels it. If a
+			run hasn't finished when the next one is due, that one is skipped.
+		*/
+		TimerHandle SendPeriodic(std::chrono::steady_clock::duration interval, Task_t task);
+
+		/*
+			Sends fn to the TaskHandlers as a task named name, the returned
+			Future gets the value returned by fn.
+		*/
+		template<typename F>
+		Future<typename std::invoke_result<F>::type> SendTask(const ANSICHAR* name, F fn)
+		{
+			Future<typename std::invoke_result<F>::type> future;
+			SendTask(decltype(future)::CreateFulfillTask(name, std::move(fn), this, future));
+			return future;
+		}
+
+		/*
+			Executes one of the pending tasks on the calling thread,
+			useful to help the TaskHandlers while waiting for something
+			instead of blocking.
+			Return:
+				true - A task was executed.
+				false - There were no pending tasks.
+		*/
+		bool TryRunPendingTask();
+
+		/* Returns true if the calling thread is one of the pool TaskHandlers */
+		bool IsTaskHandlerThread()const;
+
+		/*
+			Returns the number of tasks of the given priority that are waiting
+			in the pool, it's just an approximation as the TaskHandlers keep
+			taking them.
+		*/
+		SIZET GetNumPendingTasks(ETaskPriority::Type priority);
+
+		/*
+			Executes pending tasks on the calling thread until the condition
+			is true, when there's nothing to execute the thread parks on the
+			given EventCount, so it must be notified when the condition
+			changes. Pool TaskHandlers never park, as the work they are
+			waiting for may be queued behind them.
+		*/
+		template<typename Pred>
+		void HelpUntil(EventCount& event, Pred condition)
+		{
+			const bool canPark = !IsTaskHandlerThread();
+			while (!condition())
+			{
+				if (TryRunPendingTask())
+					continue;
+				if (!canPark)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				const auto key = event.PrepareWait();
+				if (condition())
+					event.CancelWait();
+				else
+					event.Wait(key);
+			}
+		}
+
+		/*
+			Changes the number of TaskHandlers, clamped to the pool limits,
+			the controller will still add or retire TaskHandlers later on.
 			This is just if you want preallocating all the future
-			needed TaskHandlers.
+			needed TaskHandlers. Retired TaskHandlers finish their current
+			task on their own, shrinking never waits for them, but growing
+			waits for a retired one which is still finishing its task.
 		*/
 		void SetNumberTaskHandlers(SIZET num);
+
+		/*
+			Stops the TaskManager in a deterministic way, first the intake is
+			closed, so only tasks sent by the TaskHandlers themselves are
+			accepted and the timers are dropped. Then the pending tasks are
+			executed or cancelled depending on mode, and finally every
+			TaskHandler thread is joined.
+			Tasks sent from outside afterwards are destroyed without running,
+			like the cancelled ones, so their Futures get a
+			TaskDiscardedException and their TaskGraph nodes count as
+			finished.
+			The destructor calls it with CANCEL if it wasn't called before.
+		*/
+		TaskShutdownReport Shutdown(ETaskShutdown::Type mode, std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+		bool IsShutDown()const;
+
+		/*
+			Changes the limits of the pool size, 0 means the default one,
+			which is the number of logical cores for the minimum and
+			MaxHandlersPerCore per logical core for the maximum.
+			Usually set through the TaskManagerMinHandlers and
+			TaskManagerMaxHandlers properties.
+		*/
+		void SetTaskHandlerLimits(SIZET minHandlers, SIZET maxHandlers);
+
+		/*
+			Returns the current limits of the pool size, with the defaults
+			already resolved
+		*/
+		SIZET GetMinTaskHandlers()const;
+
+		SIZET GetMaxTaskHandlers()const;
 	};
 }
 
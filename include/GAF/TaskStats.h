@@ -0,0 +1,119 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_TASKSTATS_H
+#define GAF_TASKSTATS_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+#if PLATFORM_WINDOWS
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+namespace gaf
+{
+	/*
+		Log-linear histogram, every power of two is split in SubBuckets
+		buckets, so the values keep a 1/SubBuckets precision over the whole
+		range like in an HDR histogram. Values are kept in ticks of
+		TaskStats::Now and reported in nanoseconds.
+	*/
+	class TaskHistogram
+	{
+	public:
+		static constexpr uint32 SubBucketBits = 3;
+		static constexpr uint32 SubBuckets = 1 << SubBucketBits;
+		/* Values up to 2^MaxBits ticks, which are some minutes */
+		static constexpr uint32 MaxBits = 40;
+		static constexpr uint32 NumBuckets = (MaxBits - SubBucketBits + 1) * SubBuckets;
+
+		static uint32 GetBucket(uint64 ticks);
+		/* Lowest value that goes into the bucket */
+		static uint64 GetBucketValue(uint32 bucket);
+		/* Number of values that go into the bucket */
+		static uint64 GetBucketWidth(uint32 bucket);
+
+	private:
+		std::array<uint64, NumBuckets> m_Buckets;
+		uint64 m_Count;
+		uint64 m_Sum;
+		uint64 m_Max;
+		double m_NanosPerTick;
+		friend class TaskStats;
+
+	public:
+		TaskHistogram();
+
+		uint64 GetCount()const;
+		/* In nanoseconds */
+		double GetMean()const;
+		/* In nanoseconds, percentile goes from 0 to 100 */
+		double GetPercentile(double percentile)const;
+		/* In nanoseconds */
+		double GetMax()const;
+	};
+
+	struct TaskStatsEntry
+	{
+		/* The name given by CreateTaskName */
+		std::string Name;
+		/* Time between SendTask and the beginning of the execution */
+		TaskHistogram WaitTime;
+		TaskHistogram ExecutionTime;
+	};
+
+	/*
+		Per task name counters and histograms of the tasks executed by the
+		TaskHandlers, enabled with GREAPER_TASKMAN_STATS.
+		Every thread records into its own buffer, so recording a task is
+		just a couple of timestamps and some relaxed stores, Snapshot merges
+		the buffers of every thread when asked.
+		The timestamps come from the TSC, which is invariant on the x64
+		CPUs supported, and are converted to nanoseconds on the snapshot.
+	*/
+	class TaskStats
+	{
+	public:
+		static uint64 Now()
+		{
+			return __rdtsc();
+		}
+
+		/* Length of a tick of Now, measured against the steady clock */
+		static double GetNanosPerTick();
+
+		/* Records a task executed by the calling thread, sendTime is 0 if unknown */
+		static void Record(const ANSICHAR* name, uint64 sendTime, uint64 beginTime, uint64 endTime);
+
+		/* Lets another thread reuse the buffer of the calling thread, its data is kept */
+		static void ReleaseThreadBuffer();
+
+		/* Returns the stats of every task name, sorted by total execution time */
+		static std::vector<TaskStatsEntry> Snapshot();
+
+		/* Clears every counter, tasks being recorded meanwhile may be partially kept */
+		static void Reset();
+
+		/* Writes the snapshot to the log, used by the TaskStats command */
+		static void Dump();
+	};
+}
+
+#endif /* GAF_TASKSTATS_H */
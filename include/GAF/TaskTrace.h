@@ -0,0 +1,112 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_TASKTRACE_H
+#define GAF_TASKTRACE_H 1
+
+#include "GAF/TaskStats.h"
+
+namespace gaf
+{
+	/*
+		Timeline of the tasks executed by the TaskHandlers and of the user
+		zones, enabled with GREAPER_TASKMAN_TRACE and recorded between Start
+		and Stop. Every thread writes its events into its own ring buffer,
+		so only the last EventsPerThread events of each thread are kept.
+		Write saves the timeline as Chrome trace JSON, which can be opened
+		with chrome://tracing or https://ui.perfetto.dev
+		Names are kept by pointer, so they must be string literals or the
+		names given by CreateTaskName.
+	*/
+	class TaskTrace
+	{
+		static std::atomic<bool> m_Enabled;
+	public:
+		static constexpr SIZET EventsPerThread = 1 << 15;
+
+		/* Begins recording, the events recorded before are not written anymore */
+		static void Start();
+		/* Stops recording, the recorded events are kept until the next Start */
+		static void Stop();
+
+		static bool IsEnabled()
+		{
+			return m_Enabled.load(std::memory_order_relaxed);
+		}
+
+		/*
+			Names the calling thread on the timeline and tells which pool or
+			dispatcher it belongs to, both strings must outlive the thread.
+		*/
+		static void SetThreadName(const ANSICHAR* threadName, const ANSICHAR* dispatcherName);
+
+		/* Records a task executed by the calling thread, sendTime is 0 if unknown */
+		static void RecordTask(const ANSICHAR* name, uint64 sendTime, uint64 beginTime, uint64 endTime);
+
+		/* Records a user zone of the calling thread, see GAF_TRACE_SCOPE */
+		static void RecordZone(const ANSICHAR* name, uint64 beginTime, uint64 endTime);
+
+		/* Lets another thread with the same name reuse the buffer of the calling thread */
+		static void ReleaseThreadBuffer();
+
+		/* Returns the events recorded between Start and Stop as Chrome trace JSON */
+		static std::string ToChromeJSON();
+
+		/*
+			Writes the Chrome trace JSON to a file, replacing it if it exists.
+			Return:
+				true - The file was written.
+				false - The file couldn't be created or written, check the log.
+		*/
+		static bool Write(const std::string& filePathName);
+	};
+
+	/* Records the lifetime of the object as a zone of the calling thread */
+	class TraceScope
+	{
+		const ANSICHAR* m_Name;
+		uint64 m_Begin;
+	public:
+		explicit TraceScope(const ANSICHAR* name)
+			:m_Name(name)
+			,m_Begin(TaskTrace::IsEnabled() ? TaskStats::Now() : 0)
+		{
+
+		}
+		~TraceScope()
+		{
+			if (m_Begin != 0)
+				TaskTrace::RecordZone(m_Name, m_Begin, TaskStats::Now());
+		}
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+	};
+
+#define GAF_TRACE_CONCAT_IMPL(a, b) a##b
+#define GAF_TRACE_CONCAT(a, b) GAF_TRACE_CONCAT_IMPL(a, b)
+
+#ifndef GAF_TRACE_SCOPE
+#if GREAPER_TASKMAN_TRACE
+#define GAF_TRACE_SCOPE(name) gaf::TraceScope GAF_TRACE_CONCAT(gafTraceScope, __LINE__){ name }
+#else
+#define GAF_TRACE_SCOPE(name)
+#endif
+#endif
+}
+
+#endif /* GAF_TASKTRACE_H */
@@ -0,0 +1,159 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#pragma once
+
+#ifndef GAF_WORKSTEALINGQUEUE_H
+#define GAF_WORKSTEALINGQUEUE_H 1
+
+#include "GAF/GAFPrerequisites.h"
+
+namespace gaf
+{
+	/*
+		Chase-Lev work stealing deque, the owner thread pushes and pops from
+		the bottom in a LIFO way and any other thread can steal from the top.
+		The ring grows when its full, the old rings are never freed before
+		the queue is destroyed as stealers may still be reading from them.
+		As every ring doubles the previous one, they take less memory than
+		the biggest ring again.
+		Only trivially copyable types can be stored, use pointers for bigger
+		objects.
+	*/
+	template<typename T>
+	class WorkStealingQueue
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "WorkStealingQueue only holds trivially copyable types.");
+
+		struct Array
+		{
+			const int64 Capacity;
+			const int64 Mask;
+			std::unique_ptr<std::atomic<T>[]> Data;
+
+			explicit Array(const int64 capacity)
+				:Capacity(capacity)
+				,Mask(capacity - 1)
+				,Data(new std::atomic<T>[static_cast<SIZET>(capacity)])
+			{
+
+			}
+			void Put(const int64 index, T val)
+			{
+				Data[index & Mask].store(val, std::memory_order_relaxed);
+			}
+			T Get(const int64 index)const
+			{
+				return Data[index & Mask].load(std::memory_order_relaxed);
+			}
+		};
+
+		alignas(CACHE_LINE_SIZE) std::atomic<int64> m_Top;
+		alignas(CACHE_LINE_SIZE) std::atomic<int64> m_Bottom;
+		std::atomic<Array*> m_Array;
+		/* Every ring the queue had, only touched by the owner and freed by the destructor */
+		std::vector<std::unique_ptr<Array>> m_Arrays;
+
+		Array* Grow(Array* current, const int64 bottom, const int64 top)
+		{
+			auto bigger = std::make_unique<Array>(current->Capacity * 2);
+			for (auto i = top; i != bottom; ++i)
+				bigger->Put(i, current->Get(i));
+			auto ptr = bigger.get();
+			m_Arrays.emplace_back(std::move(bigger));
+			m_Array.store(ptr, std::memory_order_release);
+			return ptr;
+		}
+	public:
+		static constexpr SIZET DefaultCapacity = 1024;
+
+		explicit WorkStealingQueue(SIZET capacity = DefaultCapacity)
+			:m_Top(0)
+			,m_Bottom(0)
+		{
+			Assertion::WhenTrue(!IsPowerOfTwo(capacity), "WorkStealingQueue capacity must be a power of two.");
+			m_Arrays.emplace_back(std::make_unique<Array>(static_cast<int64>(capacity)));
+			m_Array.store(m_Arrays.back().get(), std::memory_order_relaxed);
+		}
+		~WorkStealingQueue() = default;
+		WorkStealingQueue(const WorkStealingQueue&) = delete;
+		WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+		/* Owner only */
+		void Push(T val)
+		{
+			const auto bottom = m_Bottom.load(std::memory_order_relaxed);
+			const auto top = m_Top.load(std::memory_order_acquire);
+			auto array = m_Array.load(std::memory_order_relaxed);
+			if (bottom - top > array->Capacity - 1)
+				array = Grow(array, bottom, top);
+			array->Put(bottom, val);
+			m_Bottom.store(bottom + 1, std::memory_order_release);
+		}
+
+		/* Owner only, returns the last pushed element */
+		bool Pop(T& val)
+		{
+			const auto bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+			const auto array = m_Array.load(std::memory_order_relaxed);
+			m_Bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			auto top = m_Top.load(std::memory_order_relaxed);
+			if (top > bottom)
+			{
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+			val = array->Get(bottom);
+			if (top == bottom)
+			{
+				/* Last element, race against the stealers */
+				const auto won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		/* Any thread, returns the oldest element */
+		bool Steal(T& val)
+		{
+			auto top = m_Top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const auto bottom = m_Bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+				return false;
+			const auto array = m_Array.load(std::memory_order_acquire);
+			val = array->Get(top);
+			return m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		/* The size is just an approximation while there are other threads using the queue */
+		SIZET Size()const
+		{
+			const auto bottom = m_Bottom.load(std::memory_order_relaxed);
+			const auto top = m_Top.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<SIZET>(bottom - top) : 0;
+		}
+
+		bool Empty()const
+		{
+			return Size() == 0;
+		}
+	};
+}
+
+#endif /* GAF_WORKSTEALINGQUEUE_H */
\ No newline at end of file
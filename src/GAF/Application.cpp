@@ -69,6 +69,8 @@ void Application::Stop()
 	m_Instance->m_PropertiesManager->RemoveProperty("APPLICATION_NAME");
 	m_Instance->StopSystems();
 	m_Instance->StopModules();
+	/* The systems send tasks, and log through Strands, until they are stopped, so it's shut down afterwards */
+	m_Instance->Shutdown(ETaskShutdown::DRAIN);
 	if (LogManager::m_DefaultLogFile)
 	{
 		LogManager::m_DefaultLogFile->Close();
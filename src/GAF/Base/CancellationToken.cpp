@@ -0,0 +1,125 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Base/CancellationToken.h"
+
+using namespace gaf;
+using namespace gaf::Impl;
+
+void CancellationState::AddRef()
+{
+	RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CancellationState::Release()
+{
+	auto state = this;
+	/* Releasing a child releases its reference to the parent */
+	while (state && state->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		const auto parent = state->Parent;
+		TaskPool::Delete(state);
+		state = parent;
+	}
+}
+
+bool CancellationState::IsCancelled()const
+{
+	for (auto state = this; state; state = state->Parent)
+	{
+		if (state->Cancelled.load(std::memory_order_acquire))
+			return true;
+	}
+	return false;
+}
+
+CancellationToken::CancellationToken()
+	:m_State(nullptr)
+{
+
+}
+
+CancellationToken::CancellationToken(const CancellationToken& other)
+	:m_State(other.m_State)
+{
+	if (m_State)
+		m_State->AddRef();
+}
+
+CancellationToken::CancellationToken(CancellationToken&& other)noexcept
+	:m_State(other.m_State)
+{
+	other.m_State = nullptr;
+}
+
+CancellationToken& CancellationToken::operator=(const CancellationToken& other)
+{
+	if (this != &other)
+	{
+		if (other.m_State)
+			other.m_State->AddRef();
+		if (m_State)
+			m_State->Release();
+		m_State = other.m_State;
+	}
+	return *this;
+}
+
+CancellationToken& CancellationToken::operator=(CancellationToken&& other)noexcept
+{
+	if (this != &other)
+	{
+		if (m_State)
+			m_State->Release();
+		m_State = other.m_State;
+		other.m_State = nullptr;
+	}
+	return *this;
+}
+
+CancellationToken::~CancellationToken()
+{
+	if (m_State)
+		m_State->Release();
+}
+
+CancellationToken CancellationToken::Create()
+{
+	return Create(CancellationToken());
+}
+
+CancellationToken CancellationToken::Create(const CancellationToken& parent)
+{
+	CancellationToken token;
+	token.m_State = TaskPool::New<Impl::CancellationState>();
+	token.m_State->RefCount.store(1, std::memory_order_relaxed);
+	token.m_State->Cancelled.store(false, std::memory_order_relaxed);
+	token.m_State->Parent = parent.m_State;
+	if (parent.m_State)
+		parent.m_State->AddRef();
+	return token;
+}
+
+void CancellationToken::Cancel()
+{
+	if (m_State)
+		m_State->Cancelled.store(true, std::memory_order_release);
+}
+
+bool CancellationToken::IsCancelled()const
+{
+	return m_State && m_State->IsCancelled();
+}
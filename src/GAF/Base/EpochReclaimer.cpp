@@ -0,0 +1,103 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#include "GAF/Base/EpochReclaimer.h"
+
+using namespace gaf;
+
+namespace
+{
+	std::atomic<uint32> gNextReaderStripe(0);
+	GREAPER_THLOCAL uint32 gReaderStripe = static_cast<uint32>(-1);
+
+	/* Threads are spread through the stripes in the order they first read */
+	uint32 GetReaderStripe()
+	{
+		if (gReaderStripe == static_cast<uint32>(-1))
+			gReaderStripe = gNextReaderStripe.fetch_add(1, std::memory_order_relaxed) % EpochReclaimer::NumStripes;
+		return gReaderStripe;
+	}
+}
+
+EpochReclaimer::EpochReclaimer()
+	:m_Epoch(0)
+{
+	for (auto& stripe : m_Stripes)
+	{
+		stripe.Readers[0].store(0, std::memory_order_relaxed);
+		stripe.Readers[1].store(0, std::memory_order_relaxed);
+	}
+}
+
+EpochReclaimer::~EpochReclaimer()
+{
+	for (const auto& retired : m_Retired)
+		retired.Deleter(retired.Object);
+}
+
+bool EpochReclaimer::HasReaders(const uint64 parity)const
+{
+	for (const auto& stripe : m_Stripes)
+	{
+		if (stripe.Readers[parity].load(std::memory_order_seq_cst) != 0)
+			return true;
+	}
+	return false;
+}
+
+EpochReclaimer::ReadToken EpochReclaimer::EnterRead()
+{
+	const auto stripe = GetReaderStripe();
+	const auto parity = static_cast<uint32>(m_Epoch.load(std::memory_order_seq_cst) & 1);
+	/*
+		A writer that checks this counter after the increment sees the reader,
+		otherwise the published pointer is read after the writer's check, so
+		it can't be any object retired before it.
+	*/
+	m_Stripes[stripe].Readers[parity].fetch_add(1, std::memory_order_seq_cst);
+	return (stripe << 1) | parity;
+}
+
+void EpochReclaimer::ExitRead(const ReadToken token)
+{
+	m_Stripes[token >> 1].Readers[token & 1].fetch_sub(1, std::memory_order_release);
+}
+
+void EpochReclaimer::RetireObject(void* object, void(*deleter)(void*))
+{
+	m_Retired.push_back({ m_Epoch.load(std::memory_order_relaxed), object, deleter });
+	Reclaim();
+}
+
+void EpochReclaimer::Reclaim()
+{
+	auto epoch = m_Epoch.load(std::memory_order_relaxed);
+	/* The readers of the previous epoch share the parity with the next one */
+	if (!HasReaders((epoch + 1) & 1))
+		m_Epoch.store(++epoch, std::memory_order_seq_cst);
+	if (epoch < 2)
+		return;
+	const auto it = std::partition(m_Retired.begin(), m_Retired.end(), [epoch](const Retired& retired) { return retired.Epoch > epoch - 2; });
+	for (auto itt = it; itt != m_Retired.end(); ++itt)
+		itt->Deleter(itt->Object);
+	m_Retired.erase(it, m_Retired.end());
+}
+
+SIZET EpochReclaimer::GetNumRetired()const
+{
+	return m_Retired.size();
+}
@@ -0,0 +1,115 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Base/EventCount.h"
+
+#if PLATFORM_LINUX
+extern "C"
+{
+#include <linux/futex.h>
+#include <sys/syscall.h>
+}
+#endif
+
+using namespace gaf;
+
+#if PLATFORM_LINUX
+namespace
+{
+	/* The futex works on the 32-bit epoch, which is the upper half of the state */
+	uint32* GetEpochAddress(std::atomic<uint64>& state)
+	{
+		static_assert(PLATFORM_ENDIANESS == PLATFORM_LITTLE_ENDIAN, "The epoch address assumes little endian.");
+		return reinterpret_cast<uint32*>(&state) + 1;
+	}
+}
+#endif
+
+EventCount::EventCount()
+	:m_State(0)
+{
+
+}
+
+EventCount::Key EventCount::PrepareWait()
+{
+	const auto prev = m_State.fetch_add(1, std::memory_order_seq_cst);
+	return static_cast<Key>(prev >> EpochShift);
+}
+
+void EventCount::CancelWait()
+{
+	m_State.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::Wait(const Key key)
+{
+#if PLATFORM_LINUX
+	while (static_cast<Key>(m_State.load(std::memory_order_acquire) >> EpochShift) == key)
+		syscall(SYS_futex, GetEpochAddress(m_State), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+#else
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (static_cast<Key>(m_State.load(std::memory_order_acquire) >> EpochShift) == key)
+		m_Condition.wait(lock);
+#endif
+	m_State.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::Notify(const uint32 count)
+{
+	/* Pairs with the PrepareWait of the waiters, so either they see the new condition or we see them */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if ((m_State.load(std::memory_order_relaxed) & WaiterMask) == 0)
+		return;
+	m_State.fetch_add(AddEpoch, std::memory_order_seq_cst);
+#if PLATFORM_LINUX
+	syscall(SYS_futex, GetEpochAddress(m_State), FUTEX_WAKE_PRIVATE, (int32)Min(count, (uint32)std::numeric_limits<int32>::max()), nullptr, nullptr, 0);
+#else
+	/* Waiters check the epoch while holding the mutex, so taking it here avoids lost wake-ups */
+	m_Mutex.lock();
+	m_Mutex.unlock();
+	if (count >= GetNumWaiters())
+	{
+		m_Condition.notify_all();
+	}
+	else
+	{
+		for (uint32 i = 0; i < count; ++i)
+			m_Condition.notify_one();
+	}
+#endif
+}
+
+void EventCount::NotifyOne()
+{
+	Notify(1);
+}
+
+void EventCount::NotifyMany(const uint32 count)
+{
+	if (count > 0)
+		Notify(count);
+}
+
+void EventCount::NotifyAll()
+{
+	Notify(std::numeric_limits<uint32>::max());
+}
+
+uint32 EventCount::GetNumWaiters()const
+{
+	return static_cast<uint32>(m_State.load(std::memory_order_relaxed) & WaiterMask);
+}
\ No newline at end of file
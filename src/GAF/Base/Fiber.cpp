@@ -0,0 +1,64 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#include "GAF/Base/Fiber.h"
+
+#if GREAPER_TASKMAN_FIBERS
+extern "C"
+{
+#include <sys/mman.h>
+#include <unistd.h>
+}
+
+using namespace gaf;
+
+Fiber::Fiber()
+	:m_Stack(nullptr)
+	,m_StackSize(0)
+{
+	std::memset(&m_Context, 0, sizeof(m_Context));
+}
+
+Fiber::Fiber(const EntryFn entry, const SIZET stackSize)
+	:m_Stack(nullptr)
+	,m_StackSize(0)
+{
+	const auto pageSize = static_cast<SIZET>(sysconf(_SC_PAGESIZE));
+	m_StackSize = (stackSize + pageSize - 1) / pageSize * pageSize + pageSize;
+	m_Stack = mmap(nullptr, m_StackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	Assertion::WhenTrue(m_Stack == MAP_FAILED, "Couldn't map the stack of a fiber.");
+	/* The stack grows down, so an overflow hits the lowest page */
+	mprotect(m_Stack, pageSize, PROT_NONE);
+
+	getcontext(&m_Context);
+	m_Context.uc_stack.ss_sp = static_cast<uint8*>(m_Stack) + pageSize;
+	m_Context.uc_stack.ss_size = m_StackSize - pageSize;
+	m_Context.uc_link = nullptr;
+	makecontext(&m_Context, entry, 0);
+}
+
+Fiber::~Fiber()
+{
+	if (m_Stack && m_Stack != MAP_FAILED)
+		munmap(m_Stack, m_StackSize);
+}
+
+void Fiber::Switch(Fiber& from, Fiber& to)
+{
+	swapcontext(&from.m_Context, &to.m_Context);
+}
+#endif
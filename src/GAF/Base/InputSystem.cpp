@@ -865,7 +865,7 @@ void InputSystem::AttachWindow(Window * wnd)
 	const auto id = GetCurrentThreadId();
 	using namespace std::placeholders;
 
-	InstanceApp()->RegisterTaskDispatcher(this, 1);
+	InstanceApp()->RegisterTaskDispatcher(this, 1, "input");
 
 	m_WindowEvents = SetWindowsHookExA(WH_CALLWNDPROC, &gaf::WindowProc, nullptr, id);
 	if (!m_WindowEvents)
@@ -0,0 +1,75 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Base/Task.h"
+
+using namespace gaf;
+
+namespace
+{
+	/*
+		Last creation order given to a coalescing task, per name slot. Names
+		that share a slot coalesce with each other, which is fine for tasks
+		that are already late.
+	*/
+	constexpr SIZET CoalesceSlots = 256;
+	std::atomic<uint32> gCoalesceSeqs[CoalesceSlots];
+
+	std::atomic<uint32>& GetCoalesceSeq(const ANSICHAR* name)
+	{
+		return gCoalesceSeqs[std::hash<const ANSICHAR*>{}(name) % CoalesceSlots];
+	}
+}
+
+const ANSICHAR* gaf::GetTaskPriorityStr(const ETaskPriority::Type priority)
+{
+	static const ANSICHAR* PriorityStr[] =
+	{
+		"REALTIME",
+		"HIGH",
+		"NORMAL",
+		"BACKGROUND"
+	};
+	return PriorityStr[static_cast<SIZET>(priority)];
+}
+
+void Task_t::SetDeadline(const std::chrono::steady_clock::time_point deadline, const ETaskDeadline::Type policy)
+{
+	m_Deadline = deadline;
+	m_DeadlinePolicy = static_cast<uint8>(policy);
+	if (policy == ETaskDeadline::COALESCE)
+		m_CoalesceSeq = GetCoalesceSeq(Name).fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void Task_t::SetCancellationToken(const CancellationToken& token)
+{
+	if (token.m_State)
+		token.m_State->AddRef();
+	if (m_Cancellation)
+		m_Cancellation->Release();
+	m_Cancellation = token.m_State;
+}
+
+bool Task_t::IsDiscarded()const
+{
+	if (IsCancelled())
+		return true;
+	if (m_Deadline == std::chrono::steady_clock::time_point() || std::chrono::steady_clock::now() <= m_Deadline)
+		return false;
+	if (m_DeadlinePolicy == ETaskDeadline::DROP)
+		return true;
+	return GetCoalesceSeq(Name).load(std::memory_order_relaxed) != m_CoalesceSeq;
+}
@@ -18,14 +18,48 @@
 
 using namespace gaf;
 
-void TaskDispatcher::SendTask(const Task_t & task, const uint32 handler)
+void TaskDispatcher::AttachCancellation(Task_t& task)
 {
-	m_Manager->SendTask(this, task, handler);
+	if (!task.HasCancellationToken())
+		task.SetCancellationToken(m_Cancellation);
+}
+
+void TaskDispatcher::SendTask(Task_t task, const uint32 handler)
+{
+	m_CancellationMutex.lock_shared();
+	AttachCancellation(task);
+	m_CancellationMutex.unlock_shared();
+	m_Manager->SendTask(this, std::move(task), handler);
+}
+
+void TaskDispatcher::SendTasks(Task_t* tasks, const SIZET count, const uint32 handler)
+{
+	m_CancellationMutex.lock_shared();
+	for (SIZET i = 0; i < count; ++i)
+		AttachCancellation(tasks[i]);
+	m_CancellationMutex.unlock_shared();
+	m_Manager->SendTasks(this, tasks, count, handler);
+}
+
+void TaskDispatcher::SendTasks(std::vector<Task_t>& tasks, const uint32 handler)
+{
+	SendTasks(tasks.data(), tasks.size(), handler);
+	tasks.clear();
+}
+
+void TaskDispatcher::SendKeyedTask(Task_t task, const SIZET key)
+{
+	m_CancellationMutex.lock_shared();
+	AttachCancellation(task);
+	m_CancellationMutex.unlock_shared();
+	m_Manager->SendKeyedTask(this, std::move(task), key);
 }
 
 TaskDispatcher::TaskDispatcher(const std::string & name, TaskManager * manager)
 	:m_Name(name.empty() ? std::to_string((PTRUINT)this) : name)
 	, m_Manager(manager)
+	, m_Group(nullptr)
+	, m_Cancellation(CancellationToken::Create())
 {
 	Assertion::WhenNullptr(manager, "Trying to attach a TaskDispatcher named:%s, with a nullptr manager.");
 }
@@ -35,3 +69,24 @@ TaskDispatcher::~TaskDispatcher()
 	m_Manager->UnregisterTaskDispatcher(this);
 }
 
+const std::string& TaskDispatcher::GetName() const
+{
+	return m_Name;
+}
+
+void TaskDispatcher::CancelPendingTasks()
+{
+	m_CancellationMutex.lock();
+	m_Cancellation.Cancel();
+	m_Cancellation = CancellationToken::Create();
+	m_CancellationMutex.unlock();
+}
+
+CancellationToken TaskDispatcher::GetCancellationToken()
+{
+	m_CancellationMutex.lock_shared();
+	auto token = m_Cancellation;
+	m_CancellationMutex.unlock_shared();
+	return token;
+}
+
@@ -15,41 +15,356 @@
 ***********************************************************************************/
 
 #include "GAF/TaskManager.h"
+#include "GAF/LogManager.h"
+#include "GAF/TaskStats.h"
+#include "GAF/TaskTrace.h"
+
+#if PLATFORM_LINUX
+extern "C"
+{
+#include <pthread.h>
+#include <sched.h>
+}
+#endif
 
 using namespace gaf;
 
-void TaskHandler::Run()
+static GREAPER_THLOCAL TaskHandler* gCurrentHandler = nullptr;
+
+#if GREAPER_TASKMAN_FIBERS
+/*
+	A fiber may continue on another thread after switching, and the compiler
+	could reuse the address of the thread_local computed before, so the
+	fibers read it through a call that can't be inlined.
+*/
+static FORCENOINLINE TaskHandler* LoadCurrentHandler()
+{
+	return gCurrentHandler;
+}
+#endif
+
+static void SetThreadName(std::thread& thread, const std::string& name)
+{
+#if PLATFORM_WINDOWS
+	/* SetThreadDescription is only available since Windows 10 1607 */
+	using SetThreadDescriptionFn = HRESULT(WINAPI*)(HANDLE, PCWSTR);
+	static const auto setThreadDescription = (SetThreadDescriptionFn)GetProcAddress(GetModuleHandleA("kernel32.dll"), "SetThreadDescription");
+	if (setThreadDescription)
+	{
+		const std::wstring wideName(name.begin(), name.end());
+		setThreadDescription(thread.native_handle(), wideName.c_str());
+	}
+#elif PLATFORM_LINUX
+	/* Thread names are limited to 15 characters */
+	pthread_setname_np(thread.native_handle(), name.substr(0, 15).c_str());
+#endif
+}
+
+static bool SetThreadAffinity(std::thread& thread, const int32 core)
+{
+#if PLATFORM_WINDOWS
+	DWORD_PTR mask = 0;
+	if (core >= 0 && core < (int32)(sizeof(DWORD_PTR) * 8))
+	{
+		mask = (DWORD_PTR)1 << core;
+	}
+	else
+	{
+		DWORD_PTR systemMask;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask))
+			return false;
+	}
+	return SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+#elif PLATFORM_LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (core >= 0 && core < CPU_SETSIZE)
+	{
+		CPU_SET(core, &set);
+	}
+	else
+	{
+		for (int32 i = 0; i < CPU_SETSIZE; ++i)
+			CPU_SET(i, &set);
+	}
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+	return core < 0;
+#endif
+}
+
+uint32 TaskHandler::NextRandom()
+{
+	/* xorshift32 */
+	auto x = m_Seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	m_Seed = x;
+	return x;
+}
+
+bool TaskHandler::TryAcquireTask(Task_t& task)
+{
+	if (m_Manager)
+		return m_Manager->AcquireTask(this, task);
+	if (!m_TaskQueue->PopFront(task))
+		return false;
+	m_Depth->fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool TaskHandler::Execute(Task_t& task)
 {
-	std::this_thread::sleep_for(WaitTimeMS);
-	bool stop = false;
-	while (!stop)
+	if (task.IsDiscarded())
+		return false;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	const auto begin = TaskStats::Now();
+	task();
+	const auto end = TaskStats::Now();
+#if GREAPER_TASKMAN_STATS
+	TaskStats::Record(task.Name, task.m_SendTime, begin, end);
+#endif
+#if GREAPER_TASKMAN_TRACE
+	if (TaskTrace::IsEnabled())
+		TaskTrace::RecordTask(task.Name, task.m_SendTime, begin, end);
+#endif
+#else
+	task();
+#endif
+	return true;
+}
+
+bool TaskHandler::HasReadyFibers()const
+{
+#if GREAPER_TASKMAN_FIBERS
+	return m_Manager && m_Manager->m_NumReadyFibers.load(std::memory_order_seq_cst) != 0;
+#else
+	return false;
+#endif
+}
+
+bool TaskHandler::WaitForTask(Task_t& task)
+{
+	bool hasValue = TryAcquireTask(task);
+	/* Tasks usually come in bursts, so spin a bit before parking */
+	for (uint32 i = 0; !hasValue && i < SpinCount && !m_Stop && !HasReadyFibers(); ++i)
+	{
+		std::this_thread::yield();
+		hasValue = TryAcquireTask(task);
+	}
+	if (!hasValue)
 	{
-		if (m_Stop)
+		const auto key = m_WakeUp->PrepareWait();
+		if (m_Stop || HasReadyFibers() || (hasValue = TryAcquireTask(task)))
 		{
-			stop = true;
+			m_WakeUp->CancelWait();
 		}
-		else if (!m_TaskQueue)
+		else
 		{
-			m_Stop.store(true);
-			stop = true;
+			m_Busy.store(false, std::memory_order_seq_cst);
+			m_WakeUp->Wait(key);
+			/* Set before looking for tasks again, so a taken task is never unaccounted */
+			m_Busy.store(true, std::memory_order_seq_cst);
 		}
-		else
+	}
+	return hasValue;
+}
+
+void TaskHandler::RunTask(TaskManager* owner, Task_t& task)
+{
+	if (owner->m_DiscardTasks.load(std::memory_order_relaxed))
+	{
+		/* TaskManager::Shutdown is cancelling the pending tasks */
+		task = Task_t();
+		owner->m_NumDiscarded.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		Execute(task);
+	}
+}
+
+void TaskHandler::AddExecuted()
+{
+	m_NumExecuted.store(m_NumExecuted.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void TaskHandler::RunTasks()
+{
+	while (!m_Stop)
+	{
+		Task_t task;
+		if (WaitForTask(task))
 		{
-			Task_t task;
-			bool hasValue = false;
-			if (m_TaskQueue && !m_Stop)
-				hasValue = m_TaskQueue->PopFront(task);
-			if (!hasValue)
-				std::this_thread::sleep_for(WaitTimeMS);
-			else
-				task();
+			RunTask(m_Owner, task);
+			AddExecuted();
 		}
 	}
 }
 
-TaskHandler::TaskHandler(MPMCQueue<Task_t>* taskQueue)
-	:m_TaskQueue(taskQueue)
+#if GREAPER_TASKMAN_FIBERS
+void TaskHandler::SwitchToThread(const EFiberSwitch::Type type, Fiber* target, JobCounter* counter, const uint32 value)
+{
+	m_SwitchType = type;
+	m_SwitchTarget = target;
+	m_SwitchCounter = counter;
+	m_SwitchValue = value;
+	/* Nothing of this handler can be touched after the switch */
+	Fiber::Switch(*m_CurrentFiber, m_ThreadFiber);
+}
+
+void TaskHandler::FiberMain()
+{
+	for (;;)
+	{
+		/* Read on every loop, a task that waited may have resumed this fiber on another thread */
+		const auto handler = LoadCurrentHandler();
+		if (handler->m_Stop)
+		{
+			handler->SwitchToThread(EFiberSwitch::STOP);
+			continue;
+		}
+		Fiber* ready;
+		if (handler->m_Manager->TryAcquireReadyFiber(ready))
+		{
+			handler->SwitchToThread(EFiberSwitch::RESUME, ready);
+			continue;
+		}
+		Task_t task;
+		if (handler->WaitForTask(task))
+		{
+			RunTask(handler->m_Owner, task);
+			LoadCurrentHandler()->AddExecuted();
+		}
+	}
+}
+
+void TaskHandler::RunFibers()
+{
+	auto next = m_Manager->AcquireFiber();
+	Fiber* ready;
+	while (next)
+	{
+		m_CurrentFiber = next;
+		Fiber::Switch(m_ThreadFiber, *next);
+		/* The fiber that switched back is saved now, so other threads can resume it from here on */
+		const auto fiber = m_CurrentFiber;
+		m_CurrentFiber = nullptr;
+		switch (m_SwitchType)
+		{
+		case EFiberSwitch::STOP:
+			m_Manager->ReleaseFiber(fiber);
+			next = nullptr;
+			break;
+		case EFiberSwitch::RESUME:
+			m_Manager->ReleaseFiber(fiber);
+			next = m_SwitchTarget;
+			break;
+		case EFiberSwitch::WAIT:
+			/* m_SwitchTarget is the fiber reserved by the waiting task, it's given back if not needed */
+			next = m_SwitchTarget;
+			if (!m_SwitchCounter->AddWaiter(fiber, m_Manager, m_SwitchValue))
+			{
+				m_Manager->ReleaseFiber(next);
+				next = fiber; /* The counter reached its target meanwhile */
+			}
+			else if (m_Manager->TryAcquireReadyFiber(ready))
+			{
+				m_Manager->ReleaseFiber(next);
+				next = ready;
+			}
+			break;
+		}
+	}
+}
+#endif
+
+void TaskHandler::Run()
+{
+	if (!m_Manager && !m_TaskQueue)
+	{
+		m_Stop.store(true);
+		return;
+	}
+	gCurrentHandler = this;
+#if GREAPER_TASKMAN_TRACE
+	TaskTrace::SetThreadName(m_ThreadName.c_str(), m_DispatcherName.c_str());
+#endif
+	m_Busy.store(true, std::memory_order_seq_cst);
+#if GREAPER_TASKMAN_FIBERS
+	/* The dispatcher handlers must run their tasks in order, so only the pool ones use fibers */
+	if (m_Manager)
+		RunFibers();
+	else
+		RunTasks();
+#else
+	RunTasks();
+#endif
+	m_Busy.store(false, std::memory_order_seq_cst);
+	/* Nobody steals from a retired handler, so its leftovers go back to the pool */
+	if (m_Manager)
+		m_Manager->DrainTaskHandler(this);
+	TaskPool::ReleaseThreadCache();
+#if GREAPER_TASKMAN_STATS
+	TaskStats::ReleaseThreadBuffer();
+#endif
+#if GREAPER_TASKMAN_TRACE
+	TaskTrace::ReleaseThreadBuffer();
+#endif
+	gCurrentHandler = nullptr;
+}
+
+TaskHandler::TaskHandler(TaskManager* owner, DispatcherQueue_t* taskQueue, EventCount* wakeUp, std::atomic<uint32>* depth, const std::string& threadName, const std::string& dispatcherName)
+	:m_Manager(nullptr)
+	, m_Owner(owner)
+	, m_TaskQueue(taskQueue)
+	, m_Depth(depth)
+	, m_WakeUp(wakeUp)
+	, m_NumAcquired(0)
+	, m_Index(0)
+	, m_Seed(1)
+	, m_ThreadName(threadName)
+	, m_DispatcherName(dispatcherName)
+	, m_Core(-1)
+	, m_NUMANode(0)
 	, m_Stop(true)
+	, m_Busy(false)
+	, m_NumExecuted(0)
+#if GREAPER_TASKMAN_FIBERS
+	, m_CurrentFiber(nullptr)
+	, m_SwitchType(EFiberSwitch::STOP)
+	, m_SwitchTarget(nullptr)
+	, m_SwitchCounter(nullptr)
+	, m_SwitchValue(0)
+#endif
+{
+	Start();
+}
+
+TaskHandler::TaskHandler(TaskManager* manager, const uint32 index)
+	:m_Manager(manager)
+	, m_Owner(manager)
+	, m_TaskQueue(nullptr)
+	, m_Depth(nullptr)
+	, m_WakeUp(&manager->m_WakeUp)
+	, m_NumAcquired(0)
+	, m_Index(index)
+	, m_Seed(index * 2654435761U + 1)
+	, m_ThreadName("gaf-worker-" + std::to_string(index))
+	, m_DispatcherName("TaskManager")
+	, m_Core(-1)
+	, m_NUMANode(0)
+	, m_Stop(true)
+	, m_Busy(false)
+	, m_NumExecuted(0)
+#if GREAPER_TASKMAN_FIBERS
+	, m_CurrentFiber(nullptr)
+	, m_SwitchType(EFiberSwitch::STOP)
+	, m_SwitchTarget(nullptr)
+	, m_SwitchCounter(nullptr)
+	, m_SwitchValue(0)
+#endif
 {
 	Start();
 }
@@ -57,43 +372,85 @@ TaskHandler::TaskHandler(MPMCQueue<Task_t>* taskQueue)
 TaskHandler::~TaskHandler()
 {
 	Stop();
+	Task_t* task;
+	for (auto& localTasks : m_LocalTasks)
+	{
+		while (localTasks.Pop(task))
+			TaskPool::Delete(task);
+	}
 }
 
 void TaskHandler::Start()
 {
 	if (m_Stop.load())
 	{
+		/* A retired thread may still be finishing its last task */
+		if (m_WorkerThread.joinable())
+			m_WorkerThread.join();
 		m_Stop.store(false);
 		m_WorkerThread = /* new */ std::thread(&TaskHandler::Run, this);
+		SetThreadName(m_WorkerThread, m_ThreadName);
+		/* New threads can run on any core already */
+		if (m_Core.load(std::memory_order_relaxed) >= 0)
+			ApplyAffinity();
 	}
 }
 
-void TaskHandler::Stop()
+void TaskHandler::ApplyAffinity()
 {
-	if (!m_Stop.load())
+	const auto core = m_Core.load(std::memory_order_relaxed);
+	if (!SetThreadAffinity(m_WorkerThread, core))
 	{
-		m_Stop.store(true);
-		if (m_WorkerThread.joinable())
-			m_WorkerThread.join();
+		LogManager::LogMessage(LL_WARN, "Couldn't pin the thread '%s' to the logical core %d.", m_ThreadName.c_str(), core);
 	}
 }
 
-TaskHandler::TaskHandler(const TaskHandler& other)
-	:m_TaskQueue(other.m_TaskQueue)
-	, m_Stop(true)
+void TaskHandler::SetPlacement(const int32 core, const uint32 numaNode)
 {
-	if (!other.m_Stop)
-		Start();
+	m_NUMANode.store(numaNode, std::memory_order_relaxed);
+	if (m_Core.exchange(core, std::memory_order_relaxed) == core)
+		return;
+	if (m_WorkerThread.joinable())
+		ApplyAffinity();
 }
 
-TaskHandler& TaskHandler::operator=(const TaskHandler& other)
+void TaskHandler::Stop()
 {
-	if (this != &other)
-	{
-		Stop();
-		m_TaskQueue = other.m_TaskQueue;
-		if (!other.m_Stop.load())
-			Start();
-	}
-	return *this;
-}
\ No newline at end of file
+	RequestStop();
+	if (m_WorkerThread.joinable())
+		m_WorkerThread.join();
+}
+
+void TaskHandler::RequestStop()
+{
+	/* The handlers share the EventCount, so all of them must be woken to ensure this one sees the flag */
+	if (!m_Stop.exchange(true) && m_WakeUp)
+		m_WakeUp->NotifyAll();
+}
+
+void TaskHandler::Join()
+{
+	if (m_Stop.load() && m_WorkerThread.joinable())
+		m_WorkerThread.join();
+}
+
+TaskHandler* TaskHandler::GetCurrent()
+{
+	return gCurrentHandler;
+}
+
+TaskManager* TaskHandler::GetManager() const
+{
+	return m_Manager;
+}
+
+int32 TaskHandler::GetCore() const
+{
+	return m_Core.load(std::memory_order_relaxed);
+}
+TaskHandlerGroup::DHandler::DHandler(TaskManager* owner, const std::string& threadName, const std::string& dispatcherName)
+	:Depth(0)
+	, Handler(owner, &Tasks, &WakeUp, &Depth, threadName, dispatcherName)
+{
+
+}
@@ -0,0 +1,144 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Base/TaskPool.h"
+
+using namespace gaf;
+
+namespace
+{
+	struct FreeBlock
+	{
+		FreeBlock* Next;
+	};
+
+	struct GlobalList
+	{
+		std::mutex Mutex;
+		FreeBlock* Head = nullptr;
+
+		~GlobalList()
+		{
+			while (Head)
+			{
+				auto next = Head->Next;
+				::operator delete(Head);
+				Head = next;
+			}
+		}
+	};
+
+	/* POD, so it can live in GREAPER_THLOCAL */
+	struct ThreadCache
+	{
+		FreeBlock* Head[TaskPool::NumSizeClasses];
+		uint32 Count[TaskPool::NumSizeClasses];
+	};
+
+	GlobalList gGlobalLists[TaskPool::NumSizeClasses];
+	GREAPER_THLOCAL ThreadCache gThreadCache;
+
+	SIZET GetSizeClass(const SIZET size)
+	{
+		SIZET sizeClass = 0;
+		for (auto blockSize = TaskPool::MinBlockSize; blockSize < size; blockSize <<= 1)
+			++sizeClass;
+		return sizeClass;
+	}
+
+	/* Moves count blocks from the thread cache to the global list */
+	void FlushBlocks(const SIZET sizeClass, uint32 count)
+	{
+		auto& cache = gThreadCache;
+		if (count == 0 || !cache.Head[sizeClass])
+			return;
+		auto first = cache.Head[sizeClass];
+		auto last = first;
+		uint32 moved = 1;
+		while (moved < count && last->Next)
+		{
+			last = last->Next;
+			++moved;
+		}
+		cache.Head[sizeClass] = last->Next;
+		cache.Count[sizeClass] -= moved;
+		auto& global = gGlobalLists[sizeClass];
+		global.Mutex.lock();
+		last->Next = global.Head;
+		global.Head = first;
+		global.Mutex.unlock();
+	}
+}
+
+void* TaskPool::Allocate(const SIZET size)
+{
+	if (size > MaxBlockSize)
+		return ::operator new(size);
+	const auto sizeClass = GetSizeClass(size);
+	auto& cache = gThreadCache;
+	if (!cache.Head[sizeClass])
+	{
+		/* Take half a cache worth of blocks from the global list */
+		auto& global = gGlobalLists[sizeClass];
+		global.Mutex.lock();
+		auto first = global.Head;
+		auto last = first;
+		uint32 taken = first ? 1 : 0;
+		while (last && taken < MaxCachedBlocks / 2 && last->Next)
+		{
+			last = last->Next;
+			++taken;
+		}
+		if (last)
+		{
+			global.Head = last->Next;
+			last->Next = nullptr;
+		}
+		global.Mutex.unlock();
+		if (!first)
+			return ::operator new(MinBlockSize << sizeClass);
+		cache.Head[sizeClass] = first;
+		cache.Count[sizeClass] = taken;
+	}
+	auto block = cache.Head[sizeClass];
+	cache.Head[sizeClass] = block->Next;
+	--cache.Count[sizeClass];
+	return block;
+}
+
+void TaskPool::Deallocate(void* ptr, const SIZET size)
+{
+	if (!ptr)
+		return;
+	if (size > MaxBlockSize)
+	{
+		::operator delete(ptr);
+		return;
+	}
+	const auto sizeClass = GetSizeClass(size);
+	auto& cache = gThreadCache;
+	auto block = static_cast<FreeBlock*>(ptr);
+	block->Next = cache.Head[sizeClass];
+	cache.Head[sizeClass] = block;
+	if (++cache.Count[sizeClass] > MaxCachedBlocks)
+		FlushBlocks(sizeClass, MaxCachedBlocks / 2);
+}
+
+void TaskPool::ReleaseThreadCache()
+{
+	for (SIZET i = 0; i < NumSizeClasses; ++i)
+		FlushBlocks(i, gThreadCache.Count[i]);
+}
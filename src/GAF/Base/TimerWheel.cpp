@@ -0,0 +1,325 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/TaskManager.h"
+
+using namespace gaf;
+
+namespace gaf
+{
+	namespace Impl
+	{
+		struct TimerNode
+		{
+			Task_t Task;
+			TimerWheel* Wheel;
+			uint64 Deadline;
+			/* In ticks, 0 for one-shot timers */
+			uint64 Interval;
+			TimerNode* Prev;
+			TimerNode* Next;
+			uint32 Level;
+			uint32 Slot;
+			/* Keeps the node alive while it's linked on the wheel */
+			std::shared_ptr<TimerNode> Self;
+			std::atomic_bool Active;
+			/* A periodic task is running, the next periods are skipped until it finishes */
+			std::atomic_bool Running;
+		};
+	}
+}
+
+constexpr TimerWheel::Clock::duration TimerWheel::TickDuration;
+
+TimerHandle::TimerHandle(std::weak_ptr<Impl::TimerNode> node)
+	:m_Node(std::move(node))
+{
+
+}
+
+bool TimerHandle::Cancel()
+{
+	const auto node = m_Node.lock();
+	if (!node || !node->Active.load(std::memory_order_acquire))
+		return false;
+	return node->Wheel->Cancel(node.get());
+}
+
+bool TimerHandle::IsActive()const
+{
+	const auto node = m_Node.lock();
+	return node && node->Active.load(std::memory_order_acquire);
+}
+
+uint64 TimerWheel::GetNowTick()const
+{
+	return static_cast<uint64>((Clock::now() - m_Start) / TickDuration);
+}
+
+TimerWheel::Clock::time_point TimerWheel::GetTickTime(const uint64 tick)const
+{
+	return m_Start + TickDuration * tick;
+}
+
+void TimerWheel::Link(Impl::TimerNode* node)
+{
+	auto delta = node->Deadline - m_CurrentTick;
+	if (delta >= MaxTicks)
+		delta = MaxTicks - 1;
+	const auto slotTick = m_CurrentTick + delta;
+	uint32 level = 0;
+	while (level < NumLevels - 1 && delta >= (1ULL << (SlotBits * (level + 1))))
+		++level;
+	const auto slot = static_cast<uint32>((slotTick >> (SlotBits * level)) & (NumSlots - 1));
+	node->Level = level;
+	node->Slot = slot;
+	node->Prev = nullptr;
+	node->Next = m_Slots[level][slot];
+	if (node->Next)
+		node->Next->Prev = node;
+	m_Slots[level][slot] = node;
+	m_Occupied[level] |= 1ULL << slot;
+}
+
+void TimerWheel::Unlink(Impl::TimerNode* node)
+{
+	if (node->Prev)
+		node->Prev->Next = node->Next;
+	else
+		m_Slots[node->Level][node->Slot] = node->Next;
+	if (node->Next)
+		node->Next->Prev = node->Prev;
+	if (!m_Slots[node->Level][node->Slot])
+		m_Occupied[node->Level] &= ~(1ULL << node->Slot);
+	node->Prev = nullptr;
+	node->Next = nullptr;
+}
+
+uint64 TimerWheel::GetNextTick()const
+{
+	if (m_NumTimers == 0)
+		return std::numeric_limits<uint64>::max();
+	/* Occupied slots of the first level left in its current turn, otherwise the cascade at the end of the turn */
+	const auto index = static_cast<uint32>(m_CurrentTick & (NumSlots - 1));
+	const auto ahead = index == NumSlots - 1 ? 0 : m_Occupied[0] & ~((2ULL << index) - 1);
+	if (ahead != 0)
+		return (m_CurrentTick & ~static_cast<uint64>(NumSlots - 1)) + CountTrailingZeros64(ahead);
+	return (m_CurrentTick | (NumSlots - 1)) + 1;
+}
+
+void TimerWheel::Advance(const uint64 tick, std::vector<Task_t>& expired)
+{
+	while (m_CurrentTick < tick)
+	{
+		const auto next = GetNextTick();
+		if (next > tick)
+		{
+			/* Nothing happens in between */
+			m_CurrentTick = tick;
+			break;
+		}
+		m_CurrentTick = next;
+		ProcessTick(expired);
+	}
+}
+
+void TimerWheel::ProcessTick(std::vector<Task_t>& expired)
+{
+	/* Upper levels first, so their timers can still land on the slots processed right after */
+	for (auto level = NumLevels - 1; level > 0; --level)
+	{
+		if ((m_CurrentTick & ((1ULL << (SlotBits * level)) - 1)) != 0)
+			continue;
+		const auto slot = static_cast<uint32>((m_CurrentTick >> (SlotBits * level)) & (NumSlots - 1));
+		auto node = m_Slots[level][slot];
+		m_Slots[level][slot] = nullptr;
+		m_Occupied[level] &= ~(1ULL << slot);
+		while (node)
+		{
+			const auto next = node->Next;
+			if (node->Deadline <= m_CurrentTick)
+				Expire(node, expired);
+			else
+				Link(node);
+			node = next;
+		}
+	}
+	const auto slot = static_cast<uint32>(m_CurrentTick & (NumSlots - 1));
+	auto node = m_Slots[0][slot];
+	m_Slots[0][slot] = nullptr;
+	m_Occupied[0] &= ~(1ULL << slot);
+	while (node)
+	{
+		const auto next = node->Next;
+		Expire(node, expired);
+		node = next;
+	}
+}
+
+CreateTaskName(PeriodicTimerTask);
+
+void TimerWheel::Expire(Impl::TimerNode* node, std::vector<Task_t>& expired)
+{
+	if (node->Interval == 0)
+	{
+		node->Active.store(false, std::memory_order_release);
+		expired.emplace_back(std::move(node->Task));
+		--m_NumTimers;
+		/* May destroy the node */
+		node->Self.reset();
+		return;
+	}
+	if (!node->Running.exchange(true, std::memory_order_acq_rel))
+	{
+		auto self = node->Self;
+		const auto periodicFn = [self]()
+		{
+			self->Task();
+			self->Running.store(false, std::memory_order_release);
+		};
+		expired.emplace_back(node->Task.Name ? node->Task.Name : PeriodicTimerTask_Name, periodicFn);
+		expired.back().SetPriority(node->Task.GetPriority());
+	}
+	/* Stays in phase with the first deadline, the periods missed while the thread was late are skipped */
+	const auto late = m_CurrentTick - node->Deadline;
+	node->Deadline += (late / node->Interval + 1) * node->Interval;
+	Link(node);
+}
+
+void TimerWheel::Run()
+{
+	std::vector<Task_t> expired;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (!m_Stop)
+	{
+		Advance(GetNowTick(), expired);
+		if (!expired.empty())
+		{
+			lock.unlock();
+			m_Manager->SendTasks(expired);
+			lock.lock();
+			continue;
+		}
+		m_WakeTick = GetNextTick();
+		if (m_WakeTick == std::numeric_limits<uint64>::max())
+			m_Condition.wait(lock);
+		else
+			m_Condition.wait_until(lock, GetTickTime(m_WakeTick));
+	}
+}
+
+bool TimerWheel::Cancel(Impl::TimerNode* node)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (!node->Active.exchange(false, std::memory_order_acq_rel))
+		return false;
+	Unlink(node);
+	--m_NumTimers;
+	node->Self.reset();
+	return true;
+}
+
+TimerWheel::TimerWheel(TaskManager* manager)
+	:m_Manager(manager)
+	,m_Start(Clock::now())
+	,m_Stop(false)
+	,m_CurrentTick(0)
+	,m_WakeTick(std::numeric_limits<uint64>::max())
+	,m_NumTimers(0)
+	,m_Slots{}
+	,m_Occupied{}
+{
+
+}
+
+TimerWheel::~TimerWheel()
+{
+	Stop();
+}
+
+TimerHandle TimerWheel::Add(const Clock::time_point time, const Clock::duration interval, Task_t task)
+{
+	auto node = std::make_shared<Impl::TimerNode>();
+	node->Task = std::move(task);
+	node->Wheel = this;
+	node->Interval = 0;
+	if (interval > Clock::duration::zero())
+		node->Interval = Max(static_cast<uint64>((interval + TickDuration - Clock::duration(1)) / TickDuration), (uint64)1);
+	node->Prev = nullptr;
+	node->Next = nullptr;
+	node->Active.store(true, std::memory_order_relaxed);
+	node->Running.store(false, std::memory_order_relaxed);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	/* The TaskManager is shutting down, the task is dropped as any other one sent after that */
+	if (m_Stop)
+		return TimerHandle();
+	if (!m_Thread.joinable())
+		m_Thread = std::thread(&TimerWheel::Run, this);
+	/* An empty wheel can jump to the present, so the thread doesn't walk the time it was sleeping */
+	if (m_NumTimers == 0)
+		m_CurrentTick = Max(m_CurrentTick, GetNowTick());
+	const auto since = time - m_Start;
+	uint64 deadline = 0;
+	if (since > Clock::duration::zero())
+		deadline = static_cast<uint64>((since + TickDuration - Clock::duration(1)) / TickDuration);
+	node->Deadline = Max(deadline, m_CurrentTick + 1);
+	node->Self = node;
+	Link(node.get());
+	++m_NumTimers;
+	const auto notify = node->Deadline < m_WakeTick;
+	if (notify)
+		m_WakeTick = node->Deadline;
+	lock.unlock();
+	if (notify)
+		m_Condition.notify_one();
+	return TimerHandle(node);
+}
+
+void TimerWheel::Stop()
+{
+	m_Mutex.lock();
+	m_Stop = true;
+	m_Mutex.unlock();
+	m_Condition.notify_one();
+	if (m_Thread.joinable())
+		m_Thread.join();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (uint32 level = 0; level < NumLevels; ++level)
+	{
+		for (uint32 slot = 0; slot < NumSlots; ++slot)
+		{
+			auto node = m_Slots[level][slot];
+			m_Slots[level][slot] = nullptr;
+			while (node)
+			{
+				const auto next = node->Next;
+				node->Active.store(false, std::memory_order_release);
+				node->Self.reset();
+				node = next;
+			}
+		}
+		m_Occupied[level] = 0;
+	}
+	m_NumTimers = 0;
+}
+
+SIZET TimerWheel::GetNumTimers()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_NumTimers;
+}
@@ -51,6 +51,7 @@ void Window::Run()
 				task();
 		}
 	}
+	TaskPool::ReleaseThreadCache();
 }
 
 #if PLATFORM_WINDOWS
@@ -392,6 +393,8 @@ void Window::_UpdateWindowEvents()
 #else
 
 #endif
+	/* The window update is the frame, it sends the buffered events, such as OnWindowMove */
+	InstanceEvent()->FlushEvents();
 }
 
 void Window::_RequestFocus()
@@ -572,11 +575,11 @@ void Window::RequestFocus()
 	m_CommandQueue.PushBack(CreateTask(WindowRequestFocusTask, std::bind(&Window::_RequestFocus, this)));
 }
 
-void Window::SendWindowTask(const Task_t & task)
+void Window::SendWindowTask(Task_t task)
 {
 	if (m_HasToClose)
 		return;
-	m_CommandQueue.PushBack(task);
+	m_CommandQueue.PushBack(std::move(task));
 }
 
 std::thread::id Window::GetThreadID() const
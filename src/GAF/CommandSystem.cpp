@@ -80,7 +80,7 @@ void CommandSystem::RegisterStaticCommand(const StaticCommand cmd)
 		}
 		cur->Next = new StaticCmdElem();
 		cur->Next->Next = nullptr;
-		gCMDHead->Cmd = new StaticCommand(std::move(cmd));
+		cur->Next->Cmd = new StaticCommand(std::move(cmd));
 	}
 #if GREAPER_DEBUG_ALLOCATION
 	if (!gCleanAtExit)
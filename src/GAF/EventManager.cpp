@@ -17,12 +17,90 @@
 #include "GAF/Application.h" 
 #include "GAF/EventManager.h"
 #include "GAF/LogManager.h"
+#include "GAF/TaskTrace.h"
 
 using namespace gaf;
 
+const ANSICHAR* gaf::GetEventDispatchStr(const EEventDispatch::Type dispatch)
+{
+	static const ANSICHAR* DispatchStr[] =
+	{
+		"ASYNC",
+		"IMMEDIATE",
+		"FRAME",
+		"COALESCED"
+	};
+	return DispatchStr[static_cast<SIZET>(dispatch)];
+}
+
+void gaf::Impl::EventPayload::AddRef()
+{
+	RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void gaf::Impl::EventPayload::Release()
+{
+	if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Destroy(this);
+		TaskPool::Delete(this);
+	}
+}
+
+gaf::Impl::EventPayloadRef::EventPayloadRef(EventPayload* record)
+	:m_Record(record)
+{
+
+}
+
+gaf::Impl::EventPayloadRef::EventPayloadRef(EventPayloadRef&& other)noexcept
+	:m_Record(other.m_Record)
+{
+	other.m_Record = nullptr;
+}
+
+gaf::Impl::EventPayloadRef& gaf::Impl::EventPayloadRef::operator=(EventPayloadRef&& other)noexcept
+{
+	if (this != &other)
+	{
+		if (m_Record)
+			m_Record->Release();
+		m_Record = other.m_Record;
+		other.m_Record = nullptr;
+	}
+	return *this;
+}
+
+gaf::Impl::EventPayloadRef::~EventPayloadRef()
+{
+	if (m_Record)
+		m_Record->Release();
+}
+
+gaf::Impl::EventPayloadRef gaf::Impl::EventPayloadRef::Share()const
+{
+	if (m_Record)
+		m_Record->AddRef();
+	return EventPayloadRef(m_Record);
+}
+
+void* gaf::Impl::EventPayloadRef::GetPayload()const
+{
+	return m_Record ? m_Record->Payload : nullptr;
+}
+
+uint32 gaf::Impl::NextTypedEventSlot()
+{
+	static std::atomic<uint32> nextSlot(0);
+	return nextSlot.fetch_add(1, std::memory_order_relaxed);
+}
+
 EventManager::EventManager()
-	:m_NextEventID(0)
-	,m_NextListenerID(0)
+	:m_NextListenerID(0)
+	,m_Snapshot(new ListenerSnapshot())
+	,m_AllEventsDirty(false)
+	,m_DispatchModesDirty(false)
+	,m_TypedEventsDirty(false)
 {
 	LogManager::LogMessage(LL_INFO, "Starting EventManager...");
 }
@@ -30,74 +108,363 @@ EventManager::EventManager()
 EventManager::~EventManager()
 {
 	LogManager::LogMessage(LL_INFO, "Stopping EventManager...");
+	const auto snapshot = m_Snapshot.load(std::memory_order_acquire);
+	for (const auto row : snapshot->EventListeners)
+		delete row;
+	delete snapshot->AllEventsListeners;
+	delete snapshot;
+}
+
+CreateTaskName(EventListenerTask);
+
+template<typename T>
+static void SwapErase(std::vector<T>& vec, const T& val)
+{
+	const auto it = std::find(vec.begin(), vec.end(), val);
+	if (it != vec.end())
+	{
+		*it = vec.back();
+		vec.pop_back();
+	}
+}
+
+void EventManager::IndexListener(EventListener* listener)
+{
+	if (listener->IsListeningAll())
+	{
+		m_AllEventsListeners.push_back(listener);
+		m_AllEventsDirty = true;
+		return;
+	}
+	for (const auto event : listener->ListeneningEvents)
+	{
+		if (event >= m_EventListeners.size())
+			m_EventListeners.resize(event + 1);
+		m_EventListeners[event].push_back(listener);
+		m_DirtyEvents.push_back(event);
+	}
+}
+
+void EventManager::UnindexListener(EventListener* listener)
+{
+	if (listener->IsListeningAll())
+	{
+		SwapErase(m_AllEventsListeners, listener);
+		m_AllEventsDirty = true;
+		return;
+	}
+	for (const auto event : listener->ListeneningEvents)
+	{
+		if (event < m_EventListeners.size())
+		{
+			SwapErase(m_EventListeners[event], listener);
+			m_DirtyEvents.push_back(event);
+		}
+	}
+}
+
+void EventManager::AddListenerEvent(EventListener* listener, const EventID event)
+{
+	auto& events = listener->ListeneningEvents;
+	if (event == AllEventsID)
+	{
+		if (listener->IsListeningAll())
+			return;
+		UnindexListener(listener);
+		events.insert(events.begin(), AllEventsID);
+		IndexListener(listener);
+		return;
+	}
+	if (std::find(events.begin(), events.end(), event) != events.end())
+		return;
+	events.emplace_back(event);
+	/* Listeners of all events aren't indexed per event */
+	if (listener->IsListeningAll())
+		return;
+	if (event >= m_EventListeners.size())
+		m_EventListeners.resize(event + 1);
+	m_EventListeners[event].push_back(listener);
+	m_DirtyEvents.push_back(event);
+}
+
+void EventManager::PublishSnapshot()
+{
+	if (m_DirtyEvents.empty() && !m_AllEventsDirty && !m_DispatchModesDirty && !m_TypedEventsDirty)
+		return;
+	const auto current = m_Snapshot.load(std::memory_order_relaxed);
+	const auto snapshot = new ListenerSnapshot(*current);
+	std::vector<const ListenerVec*> replacedRows;
+	const auto makeRow = [](const std::vector<EventListener*>& listeners)
+	{
+		return listeners.empty() ? nullptr : new ListenerVec(listeners.begin(), listeners.end());
+	};
+
+	std::sort(m_DirtyEvents.begin(), m_DirtyEvents.end());
+	m_DirtyEvents.erase(std::unique(m_DirtyEvents.begin(), m_DirtyEvents.end()), m_DirtyEvents.end());
+	if (snapshot->EventListeners.size() < m_EventListeners.size())
+		snapshot->EventListeners.resize(m_EventListeners.size(), nullptr);
+	for (const auto event : m_DirtyEvents)
+	{
+		replacedRows.push_back(snapshot->EventListeners[event]);
+		snapshot->EventListeners[event] = makeRow(m_EventListeners[event]);
+	}
+	if (m_AllEventsDirty)
+	{
+		replacedRows.push_back(snapshot->AllEventsListeners);
+		snapshot->AllEventsListeners = makeRow(m_AllEventsListeners);
+	}
+	if (m_DispatchModesDirty)
+		snapshot->DispatchModes = m_DispatchModes;
+	if (m_TypedEventsDirty)
+		snapshot->TypedEvents = m_TypedEvents;
+	m_DirtyEvents.clear();
+	m_AllEventsDirty = false;
+	m_DispatchModesDirty = false;
+	m_TypedEventsDirty = false;
+
+	m_Snapshot.store(snapshot, std::memory_order_seq_cst);
+	for (const auto row : replacedRows)
+		m_Reclaimer.Retire(row);
+	m_Reclaimer.Retire(current);
+}
+
+bool EventManager::IsValidEvent(const EventID event)const
+{
+	return event == AllEventsID || (event < m_ValidEvents.size() && m_ValidEvents[event]);
+}
+
+void EventManager::GatherListenerTasks(const EventID event, void* params, const Impl::EventPayloadRef& payload, std::vector<Task_t>& listenerTasks)
+{
+	if (event == EventManager::NullEventID)
+		return;
+	const auto addListenerTasks = [&listenerTasks, &payload, event, params](const ListenerVec* listeners)
+	{
+		if (listeners == nullptr)
+			return;
+		for (const auto listener : *listeners)
+		{
+			/* The listener may be unregistered and deleted once the read section ends, so its function is copied */
+			auto listenerFn = [listeningFn = listener->ListeningFunction, ref = payload.Share(), event, params]()
+			{
+				GAF_TRACE_SCOPE("EventListener");
+				listeningFn(event, params);
+			};
+			listenerTasks.emplace_back(CreateTask(EventListenerTask, std::move(listenerFn)));
+		}
+	};
+	/* Wait-free, registrations publish a new snapshot instead of blocking the dispatches */
+	const auto token = m_Reclaimer.EnterRead();
+	const auto snapshot = m_Snapshot.load(std::memory_order_seq_cst);
+	if (event < snapshot->EventListeners.size())
+		addListenerTasks(snapshot->EventListeners[event]);
+	addListenerTasks(snapshot->AllEventsListeners);
+	m_Reclaimer.ExitRead(token);
+}
+
+void EventManager::SendListenerTasks(std::vector<Task_t>& listenerTasks)
+{
+	if (listenerTasks.size() == 1)
+		listenerTasks[0]();
+	else
+		InstanceApp()->SendTasks(listenerTasks);
 }
 
 void EventManager::EventTask(const EventID event, void * params)
+{
+	std::vector<Task_t> listenerTasks;
+	GatherListenerTasks(event, params, Impl::EventPayloadRef(), listenerTasks);
+	SendListenerTasks(listenerTasks);
+}
+
+void EventManager::CallListeners(const EventID event, void* params)
 {
 	if (event == EventManager::NullEventID)
 		return;
-	m_ListenersLock.lock_shared();
-	for (auto it = m_RegisteredListeners.begin(); it != m_RegisteredListeners.end(); ++it)
+	const auto callListeners = [event, params](const ListenerVec* listeners)
 	{
-		it->second.Mutex.lock_shared();
-		if (it->second.ListeneningEvents.empty())
+		if (listeners == nullptr)
+			return;
+		for (const auto listener : *listeners)
 		{
-			it->second.Mutex.unlock_shared();
-			continue;
+			GAF_TRACE_SCOPE("EventListener");
+			listener->ListeningFunction(event, params);
 		}
-		if (it->second.ListeneningEvents[0] == AllEventsID)
+	};
+	/* The snapshot can't be reclaimed while the listeners run, even if they unregister themselves */
+	const auto token = m_Reclaimer.EnterRead();
+	const auto snapshot = m_Snapshot.load(std::memory_order_seq_cst);
+	if (event < snapshot->EventListeners.size())
+		callListeners(snapshot->EventListeners[event]);
+	callListeners(snapshot->AllEventsListeners);
+	m_Reclaimer.ExitRead(token);
+}
+
+void EventManager::QueueEvent(const EventID event, void* params, Impl::EventPayloadRef&& payload, const bool coalesce)
+{
+	m_PendingLock.lock();
+	if (coalesce)
+	{
+		if (event >= m_PendingSlots.size())
+			m_PendingSlots.resize(event + 1, 0);
+		auto& slot = m_PendingSlots[event];
+		if (slot != 0)
 		{
-			it->second.ListeningFunction(event, params);
+			auto& pending = m_PendingEvents[slot - 1];
+			pending.Params = params;
+			/* The replaced payload is released outside the lock, as its destructor may dispatch events */
+			std::swap(pending.Payload, payload);
+			m_PendingLock.unlock();
+			return;
 		}
-		else
+		slot = static_cast<uint32>(m_PendingEvents.size() + 1);
+	}
+	m_PendingEvents.push_back({ event, params, std::move(payload) });
+	m_PendingLock.unlock();
+}
+
+void EventManager::FlushTask(std::vector<PendingEvent>& pendingEvents)
+{
+	std::vector<Task_t> listenerTasks;
+	for (const auto& pending : pendingEvents)
+		GatherListenerTasks(pending.Event, pending.Params, pending.Payload, listenerTasks);
+	/* The listener tasks hold their own references */
+	pendingEvents.clear();
+	SendListenerTasks(listenerTasks);
+}
+
+EventID EventManager::FindEvent(const EventName& eventName)const
+{
+	const auto it = m_EventsByHash.find(eventName.Hash);
+	if (it == m_EventsByHash.end())
+		return NullEventID;
+	/* The name is compared too, so a collision is never taken as the other event */
+	for (auto id = it->second; id != NullEventID; id = m_Events[id].NextSameHash)
+	{
+		const auto& entry = m_Events[id];
+		if (entry.Name == eventName.Str)
+			return entry.Registered ? id : NullEventID;
+	}
+	return NullEventID;
+}
+
+EventID EventManager::RegisterEventLocked(const EventName& eventName, const EEventDispatch::Type dispatch)
+{
+	EventID id = NullEventID;
+	const auto it = m_EventsByHash.find(eventName.Hash);
+	if (it != m_EventsByHash.end())
+	{
+		for (auto chained = it->second; chained != NullEventID; chained = m_Events[chained].NextSameHash)
 		{
-			for (auto itt = it->second.ListeneningEvents.begin();
-				itt != it->second.ListeneningEvents.end(); ++itt)
+			if (m_Events[chained].Name == eventName.Str)
 			{
-				if ((*itt) == event)
-				{
-					it->second.ListeningFunction(event, params);
-				}
+				id = chained;
+				break;
 			}
 		}
-		it->second.Mutex.unlock_shared();
 	}
-	m_ListenersLock.unlock_shared();
+	if (id != NullEventID)
+	{
+		auto& entry = m_Events[id];
+		if (entry.Registered)
+		{
+			LogManager::LogMessage(LL_WARN, "Trying to register an already registerd"
+				" event:%s.", eventName.Str);
+			return id;
+		}
+		entry.Registered = true;
+	}
+	else
+	{
+		id = static_cast<EventID>(m_Events.size());
+		/* A colliding name goes first in the chain of its hash */
+		const auto next = it != m_EventsByHash.end() ? it->second : NullEventID;
+		m_Events.push_back({ eventName.Str, eventName.Hash, true, next });
+		m_EventsByHash.insert_or_assign(eventName.Hash, id);
+		m_ValidEvents.resize(m_Events.size(), false);
+	}
+	m_ValidEvents[id] = true;
+	/* Events without an entry are ASYNC, so only the other modes need a new snapshot */
+	if (dispatch != EEventDispatch::ASYNC || id < m_DispatchModes.size())
+	{
+		if (id >= m_DispatchModes.size())
+			m_DispatchModes.resize(id + 1, EEventDispatch::ASYNC);
+		m_DispatchModes[id] = dispatch;
+		m_DispatchModesDirty = true;
+	}
+	return id;
 }
 
-EventID EventManager::RegisterEvent(const std::string & eventName)
+EventID EventManager::RegisterEvent(const std::string & eventName, const EEventDispatch::Type dispatch)
 {
-	auto id = GetEventIDFromName(eventName);
-	if (id != NullEventID)
+	return RegisterEvent(EventName(eventName), dispatch);
+}
+
+EventID EventManager::RegisterEvent(const EventName& eventName, const EEventDispatch::Type dispatch)
+{
+	if (eventName.Str == nullptr || eventName.Str[0] == '\0')
 	{
-		LogManager::LogMessage(LL_WARN, "Trying to register an already registerd"
-			" event:%s.", eventName.c_str());
-		return id;
+		LogManager::LogMessage(LL_WARN, "Trying to register an event without name.");
+		return NullEventID;
 	}
-	id = m_NextEventID.load(std::memory_order_acquire);
 	m_EventsLock.lock();
-	m_RegisteredEvents.emplace(id, eventName);
+	m_ListenersLock.lock();
+	const auto id = RegisterEventLocked(eventName, dispatch);
+	PublishSnapshot();
+	m_ListenersLock.unlock();
 	m_EventsLock.unlock();
-	++m_NextEventID;
 	return id;
 }
 
-void EventManager::UnregisterEvent(const EventID event)
+std::vector<EventID> EventManager::RegisterEvents(const std::vector<std::string>& eventNames, const EEventDispatch::Type dispatch)
 {
-	m_EventsLock.lock_shared();
-	const auto it = m_RegisteredEvents.find(event);
-	m_EventsLock.unlock_shared();
-	if (it == m_RegisteredEvents.end())
+	std::vector<EventName> names;
+	names.reserve(eventNames.size());
+	for (const auto& eventName : eventNames)
+		names.emplace_back(eventName);
+	return RegisterEvents(names, dispatch);
+}
+
+std::vector<EventID> EventManager::RegisterEvents(const std::vector<EventName>& eventNames, const EEventDispatch::Type dispatch)
+{
+	std::vector<EventID> ids;
+	ids.reserve(eventNames.size());
+	m_EventsLock.lock();
+	m_ListenersLock.lock();
+	m_Events.reserve(m_Events.size() + eventNames.size());
+	m_EventsByHash.reserve(m_EventsByHash.size() + eventNames.size());
+	for (const auto& eventName : eventNames)
 	{
-		LogManager::LogMessage(LL_WARN, "Trying to unregister a non-existant"
-			" event:%d.", event);
+		if (eventName.Str == nullptr || eventName.Str[0] == '\0')
+		{
+			LogManager::LogMessage(LL_WARN, "Trying to register an event without name.");
+			ids.push_back(NullEventID);
+			continue;
+		}
+		ids.push_back(RegisterEventLocked(eventName, dispatch));
 	}
-	else
+	/* A single snapshot for every dispatch mode */
+	PublishSnapshot();
+	m_ListenersLock.unlock();
+	m_EventsLock.unlock();
+	return ids;
+}
+
+void EventManager::UnregisterEvent(const EventID event)
+{
+	m_EventsLock.lock();
+	if (event >= m_Events.size() || !m_Events[event].Registered)
 	{
-		m_EventsLock.lock();
-		m_RegisteredEvents.erase(it);
 		m_EventsLock.unlock();
+		LogManager::LogMessage(LL_WARN, "Trying to unregister a non-existant"
+			" event:%d.", event);
+		return;
 	}
+	m_Events[event].Registered = false;
+	/* The EventID is kept for the name, but it can't be listened to until it's registered again */
+	m_ListenersLock.lock();
+	m_ValidEvents[event] = false;
+	m_ListenersLock.unlock();
+	m_EventsLock.unlock();
 }
 
 void EventManager::UnregisterEvent(const std::string & eventName)
@@ -108,13 +475,12 @@ void EventManager::UnregisterEvent(const std::string & eventName)
 std::string EventManager::GetEventName(const EventID evt)
 {
 	m_EventsLock.lock_shared();
-	const auto it = m_RegisteredEvents.find(evt);
-	if (it == m_RegisteredEvents.end())
+	if (evt >= m_Events.size() || !m_Events[evt].Registered)
 	{
 		m_EventsLock.unlock_shared();
 		return NullEventIDStr;
 	}
-	const auto ret = it->second;
+	const auto ret = m_Events[evt].Name;
 	m_EventsLock.unlock_shared();
 	return ret;
 }
@@ -123,62 +489,69 @@ EventID EventManager::GetEventIDFromName(const std::string & eventName)
 {
 	if (eventName.empty())
 		return NullEventID;
+	return GetEventIDFromName(EventName(eventName));
+}
+
+EventID EventManager::GetEventIDFromName(const EventName& eventName)
+{
 	m_EventsLock.lock_shared();
-	for (auto it = m_RegisteredEvents.begin(); it != m_RegisteredEvents.end(); ++it)
-	{
-		if (it->second == eventName)
-		{
-			const auto ret = (EventID)it->first;
-			m_EventsLock.unlock_shared();
-			return ret;
-		}
-	}
+	const auto id = FindEvent(eventName);
 	m_EventsLock.unlock_shared();
-	return NullEventID;
+	return id;
 }
 
 void EventManager::AddEventToListener(const EventListenerID listener, const EventID event)
 {
-	m_ListenersLock.lock_shared();
+	m_ListenersLock.lock();
+	if (!IsValidEvent(event))
+	{
+		m_ListenersLock.unlock();
+		LogManager::LogMessage(LL_WARN, "Trying to add a non-registered event:%d to the"
+			" EventListener:%d.", event, listener);
+		return;
+	}
 	const auto it = m_RegisteredListeners.find(listener);
 	
 	if (it == m_RegisteredListeners.end())
 	{
-		m_ListenersLock.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to add an event:%d to an non-registered"
 			" EventListener:%d.", event, listener);
 		return;
 	}
-	else
-	{
-		it->second.Mutex.lock();
-		it->second.ListeneningEvents.emplace_back(event);
-		it->second.Mutex.unlock();
-	}
-	m_ListenersLock.unlock_shared();
+	AddListenerEvent(&it->second, event);
+	PublishSnapshot();
+	m_ListenersLock.unlock();
 }
 
 void EventManager::AddEventToListener(const EventListenerID listener, const std::vector<EventID>& events)
 {
-	m_ListenersLock.lock_shared();
+	m_ListenersLock.lock();
 	const auto it = m_RegisteredListeners.find(listener);
 	
 
 	if (it == m_RegisteredListeners.end())
 	{
-		m_ListenersLock.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to add a series of events to an non-registered"
 			" EventListener:%d.", listener);
 		return;
 	}
-	else
+	uint32 invalidEvents = 0;
+	for (auto itt = events.begin(); itt != events.end(); ++itt)
+	{
+		if (IsValidEvent(*itt))
+			AddListenerEvent(&it->second, *itt);
+		else
+			++invalidEvents;
+	}
+	PublishSnapshot();
+	m_ListenersLock.unlock();
+	if (invalidEvents > 0)
 	{
-		it->second.Mutex.lock();
-		for (auto itt = events.begin(); itt != events.end(); ++itt)
-			it->second.ListeneningEvents.emplace_back(*itt);
-		it->second.Mutex.unlock();
+		LogManager::LogMessage(LL_WARN, "Trying to add %d non-registered events to the"
+			" EventListener:%d.", invalidEvents, listener);
 	}
-	m_ListenersLock.unlock_shared();
 }
 
 void EventManager::RemoveEventFromListener(const EventListenerID listener, const EventID event)
@@ -189,52 +562,53 @@ void EventManager::RemoveEventFromListener(const EventListenerID listener, const
 		return;
 	}
 	const auto hash = listener;
-	m_ListenersLock.lock_shared();
+	m_ListenersLock.lock();
 	const auto it = m_RegisteredListeners.find(hash);
 	if (it == m_RegisteredListeners.end())
 	{
-		m_ListenersLock.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to remove an Event from a non-registered EventListener, eventID: %d, listenerID: %d.",
 			event, listener);
 		return;
 	}
-	m_ListenersLock.unlock_shared();
+	auto& events = it->second.ListeneningEvents;
 	if (event == AllEventsID)
 	{
-		it->second.Mutex.lock();
-		it->second.ListeneningEvents.clear();
-		it->second.Mutex.unlock();
+		UnindexListener(&it->second);
+		events.clear();
+		PublishSnapshot();
+		m_ListenersLock.unlock();
 		return;
 	}
-	it->second.Mutex.lock_shared();
-	if (it->second.ListeneningEvents.empty())
+	if (events.empty())
 	{
-		it->second.Mutex.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to remove an Event: %d, from a EventListener: %d, but that EventListener doesn't contains that event.",
 			event, listener);
 		return;
 	}
-	if (it->second.ListeneningEvents[0] == AllEventsID)
+	if (it->second.IsListeningAll())
 	{
-		it->second.Mutex.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to remove an Event: %d, from a EventListener: %d, but that EventListener allows any event to be received, and"
 			" removing just one event is not currently supported, erase the EventListener and add another one without that event.",
 			event, listener);
 		return;
 	}
-	const auto evtIt = std::find(it->second.ListeneningEvents.begin(), it->second.ListeneningEvents.end(), event);
-	if (evtIt == it->second.ListeneningEvents.end())
+	const auto evtIt = std::find(events.begin(), events.end(), event);
+	if (evtIt == events.end())
 	{
-		it->second.Mutex.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to remove an Event: %d, from a EventListener: %d, but that EventListener doesn't contains that event.",
 			event, listener);
 	}
 	else
 	{
-		it->second.Mutex.unlock_shared();
-		it->second.Mutex.lock();
-		it->second.ListeneningEvents.erase(evtIt);
-		it->second.Mutex.unlock();
+		events.erase(evtIt);
+		SwapErase(m_EventListeners[event], &it->second);
+		m_DirtyEvents.push_back(event);
+		PublishSnapshot();
+		m_ListenersLock.unlock();
 	}
 }
 
@@ -250,42 +624,45 @@ void EventManager::RemoveEventFromListener(const EventListenerID listener, const
 		LogManager::LogMessage(LL_WARN, "Trying to remove a series of events from an EventListener, but the listener was null.");
 		return;
 	}
-	m_ListenersLock.lock_shared();
+	m_ListenersLock.lock();
 	if (m_RegisteredListeners.find(listener) == m_RegisteredListeners.end())
 	{
-		m_ListenersLock.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to remove a series of events from an EventListener, but the listener was not registered.");
 		return;
 	}
-	m_ListenersLock.unlock_shared();
+	m_ListenersLock.unlock();
 	for (auto it = events.begin(); it != events.end(); ++it)
 		RemoveEventFromListener(listener, *it);
 }
 
 EventListenerID EventManager::RegisterEventListener(const std::function<void(EventID, void*)>& evtHandling, const EventID event)
 {
-	EventListener listener;
-	listener.ListeningFunction = evtHandling;
-	listener.ListeneningEvents.emplace_back(event);
-	const auto id = m_NextListenerID.load(std::memory_order_acquire);
-	++m_NextListenerID;
-
-	m_ListenersLock.lock();
-	m_RegisteredListeners.insert_or_assign(id, listener);
-	m_ListenersLock.unlock();
-
-	return id;
+	return RegisterEventListener(evtHandling, std::vector<EventID>{ event });
 }
 
 EventListenerID EventManager::RegisterEventListener(const std::function<void(EventID, void*)>& evtHandling, const std::vector<EventID>& events)
 {
-	const auto id = m_NextListenerID.load(std::memory_order_acquire);
-	++m_NextListenerID;
+	const auto id = m_NextListenerID.fetch_add(1, std::memory_order_acq_rel);
+	uint32 invalidEvents = 0;
 
 	m_ListenersLock.lock();
-	m_RegisteredListeners.insert_or_assign(id, EventListener(evtHandling, events));
+	auto& listener = m_RegisteredListeners.emplace(id, EventListener(evtHandling, {})).first->second;
+	for (auto it = events.begin(); it != events.end(); ++it)
+	{
+		if (IsValidEvent(*it))
+			AddListenerEvent(&listener, *it);
+		else
+			++invalidEvents;
+	}
+	PublishSnapshot();
 	m_ListenersLock.unlock();
 
+	if (invalidEvents > 0)
+	{
+		LogManager::LogMessage(LL_WARN, "Registering the EventListener:%d with %d non-registered"
+			" events, they were ignored.", id, invalidEvents);
+	}
 	return id;
 }
 
@@ -296,28 +673,118 @@ EventListenerID EventManager::RegisterEventListener(const std::function<void(Eve
 
 void EventManager::UnregisterEventListener(const EventListenerID listener)
 {
-	m_ListenersLock.lock_shared();
+	m_ListenersLock.lock();
 	const auto it = m_RegisteredListeners.find(listener);
 	
 	if (it == m_RegisteredListeners.end())
 	{
-		m_ListenersLock.unlock_shared();
+		m_ListenersLock.unlock();
 		LogManager::LogMessage(LL_WARN, "Trying to unregister a non-registered listener:%d.", listener);
 	}
 	else
 	{
-		m_ListenersLock.unlock_shared();
-		m_ListenersLock.lock();
-		m_RegisteredListeners.erase(it);
+		UnindexListener(&it->second);
+		PublishSnapshot();
+		/* Dispatches may still be reading the listener from the previous snapshot */
+		m_Reclaimer.Retire(new decltype(m_RegisteredListeners)::node_type(m_RegisteredListeners.extract(it)));
 		m_ListenersLock.unlock();
 	}
 }
 
 CreateTaskName(EventDispatchTask);
 
+CreateTaskName(EventFlushTask);
+
 void EventManager::DispatchEvent(const EventID event, void * params)
 {
-	InstanceApp()->SendTask(CreateTask(EventDispatchTask, std::bind(&EventManager::EventTask, this, event, params)));
+	switch (GetEventDispatch(event))
+	{
+	case EEventDispatch::IMMEDIATE:
+		CallListeners(event, params);
+		break;
+	case EEventDispatch::FRAME:
+		QueueEvent(event, params, Impl::EventPayloadRef(), false);
+		break;
+	case EEventDispatch::COALESCED:
+		QueueEvent(event, params, Impl::EventPayloadRef(), true);
+		break;
+	default:
+		InstanceApp()->SendTask(CreateTask(EventDispatchTask, std::bind(&EventManager::EventTask, this, event, params)));
+		break;
+	}
+}
+
+CreateTaskName(EventPayloadDispatchTask);
+
+void EventManager::DispatchPayload(const EventID event, const EEventDispatch::Type dispatch, Impl::EventPayloadRef&& payload)
+{
+	void* params = payload.GetPayload();
+	switch (dispatch)
+	{
+	case EEventDispatch::FRAME:
+		QueueEvent(event, params, std::move(payload), false);
+		break;
+	case EEventDispatch::COALESCED:
+		QueueEvent(event, params, std::move(payload), true);
+		break;
+	default:
+	{
+		auto dispatchFn = [this, event, params, ref = std::move(payload)]()
+		{
+			std::vector<Task_t> listenerTasks;
+			GatherListenerTasks(event, params, ref, listenerTasks);
+			SendListenerTasks(listenerTasks);
+		};
+		InstanceApp()->SendTask(CreateTask(EventPayloadDispatchTask, std::move(dispatchFn)));
+		break;
+	}
+	}
+}
+
+EEventDispatch::Type EventManager::GetEventDispatch(const EventID event)
+{
+	const auto token = m_Reclaimer.EnterRead();
+	const auto snapshot = m_Snapshot.load(std::memory_order_seq_cst);
+	const auto dispatch = event < snapshot->DispatchModes.size() ? snapshot->DispatchModes[event] : EEventDispatch::ASYNC;
+	m_Reclaimer.ExitRead(token);
+	return dispatch;
+}
+
+void EventManager::SetTypedEvent(const uint32 slot, const EventID event)
+{
+	m_ListenersLock.lock();
+	if (slot >= m_TypedEvents.size())
+		m_TypedEvents.resize(slot + 1, NullEventID);
+	m_TypedEvents[slot] = event;
+	m_TypedEventsDirty = true;
+	PublishSnapshot();
+	m_ListenersLock.unlock();
+}
+
+EventID EventManager::GetTypedEvent(const uint32 slot)
+{
+	const auto token = m_Reclaimer.EnterRead();
+	const auto snapshot = m_Snapshot.load(std::memory_order_seq_cst);
+	const auto event = slot < snapshot->TypedEvents.size() ? snapshot->TypedEvents[slot] : NullEventID;
+	m_Reclaimer.ExitRead(token);
+	return event;
+}
+
+void EventManager::FlushEvents()
+{
+	std::vector<PendingEvent> pendingEvents;
+	m_PendingLock.lock();
+	pendingEvents.swap(m_PendingEvents);
+	for (const auto& pending : pendingEvents)
+	{
+		if (pending.Event < m_PendingSlots.size())
+			m_PendingSlots[pending.Event] = 0;
+	}
+	m_PendingLock.unlock();
+	if (pendingEvents.empty())
+		return;
+	auto flushFn = [this, pendingEvents = std::move(pendingEvents)]() mutable { FlushTask(pendingEvents); };
+	InstanceApp()->SendTask(CreateTask(EventFlushTask, std::move(flushFn)));
 }
 
 EventManager & EventManager::Instance()
@@ -17,6 +17,7 @@
 #include "GAF/Application.h"
 #include "GAF/FileSystem.h"
 #include "GAF/LogManager.h"
+#include "GAF/TaskTrace.h"
 #include "GAF/Util/StringUtils.h"
 
 using namespace gaf;
@@ -45,28 +46,26 @@ std::wstring FileSystem::GetExeDirectoryW()
 	return path.substr(0, lastSlash);
 }
 
-void FileSystem::AsyncReadFn(AsyncVec::iterator async, const std::function<void(FileAsync*)>& beginReadFunc, const std::function<void(FileAsync*)>& endReadFunc)
+void FileSystem::AsyncReadFn(FileAsync async, const std::function<void(FileAsync*)>& beginReadFunc, const std::function<void(FileAsync*)>& endReadFunc)
 {
-	Assertion::WhenEqual(async->second, AsyncWrite, "Trying to call an AsyncRead with an AsyncWrite.");
-	beginReadFunc(&async->first);
+	beginReadFunc(&async);
 	SIZET readbytes;
-	async->first.FileToUse->LoadContents(async->first.Buffer, async->first.BufferSize, readbytes);
-	endReadFunc(&async->first);
-	m_AsyncMutex.lock();
-	m_AsyncOperations.erase(async);
-	m_AsyncMutex.unlock();
+	{
+		GAF_TRACE_SCOPE("FileRead");
+		async.FileToUse->LoadContents(async.Buffer, async.BufferSize, readbytes);
+	}
+	endReadFunc(&async);
 }
 
-void FileSystem::AsyncWriteFn(AsyncVec::iterator async, const std::function<void(FileAsync*)>& beginWriteFunc, const std::function<void(FileAsync*)>& endWriteFunc)
+void FileSystem::AsyncWriteFn(FileAsync async, const std::function<void(FileAsync*)>& beginWriteFunc, const std::function<void(FileAsync*)>& endWriteFunc)
 {
-	Assertion::WhenEqual(async->second, AsyncRead, "Trying to call an AsyncWrite with an AsyncRead.");
-	beginWriteFunc(&async->first);
+	beginWriteFunc(&async);
 	SIZET writtenbytes;
-	async->first.FileToUse->StoreContents(async->first.Buffer, async->first.BufferSize, writtenbytes);
-	endWriteFunc(&async->first);
-	m_AsyncMutex.lock();
-	m_AsyncOperations.erase(async);
-	m_AsyncMutex.unlock();
+	{
+		GAF_TRACE_SCOPE("FileWrite");
+		async.FileToUse->StoreContents(async.Buffer, async.BufferSize, writtenbytes);
+	}
+	endWriteFunc(&async);
 }
 
 FileSystem::FileSystem()
@@ -77,7 +76,7 @@ FileSystem::FileSystem()
 	m_RootDir->m_Name = GetExeDirectoryW();
 	m_RootDir->m_UpperDirectory = nullptr;
 	m_RootDir->Update();
-	InstanceApp()->RegisterTaskDispatcher(this, NumberIOHandlers);
+	InstanceApp()->RegisterTaskDispatcher(this, NumberIOHandlers, "io");
 }
 
 FileSystem::~FileSystem()
@@ -115,22 +114,8 @@ FileSysError_t FileSystem::StartAsyncRead(File * file, void * buffer, const SIZE
 		LogManager::LogMessage(LL_WARN, "Trying to start an AsyncRead with an empty buffer, on File: %ls.", file->GetNameW().c_str());
 		return FileSysError_t::InputError;
 	}
-	AsyncVec::iterator it;
-	{
-		const auto item = std::make_pair(FileAsync{ buffer, bufferSize, file }, AsyncRead);
-		m_AsyncMutex.lock();
-		m_AsyncOperations.emplace_back(item);
-		m_AsyncMutex.unlock();
-		m_AsyncMutex.lock_shared();
-		for (it = m_AsyncOperations.begin(); it != m_AsyncOperations.end(); ++it)
-		{
-			if (it->first == item.first && it->second && item.second)
-				break;
-		}
-		m_AsyncMutex.unlock_shared();
-	}
-	
-	SendTask(CreateTask(AsyncReadTask, std::bind(&FileSystem::AsyncReadFn, this, it, beginReadFunc, endReadFunc)));
+	/* Keyed by the File, so the operations on the same file are executed in order */
+	SendKeyedTask(CreateTask(AsyncReadTask, std::bind(&FileSystem::AsyncReadFn, this, FileAsync{ buffer, bufferSize, file }, beginReadFunc, endReadFunc)), (SIZET)file);
 	LogManager::LogMessage(LL_INFO, "AsyncRead operation started on File: %ls.", file->GetNameW().c_str());
 	return FileSysError_t::NoError;
 }
@@ -154,24 +139,53 @@ FileSysError_t FileSystem::StartAsyncWrite(File * file, void * buffer, const SIZ
 		LogManager::LogMessage(LL_WARN, "Trying to start an AsyncWrite with an empty buffer, on File: %ls.", file->GetNameW().c_str());
 		return FileSysError_t::InputError;
 	}
-	AsyncVec::iterator it;
-	{
-		const auto item = std::make_pair(FileAsync{ buffer, bufferSize, file }, AsyncWrite);
-		m_AsyncMutex.lock();
-		m_AsyncOperations.emplace_back(item);
-		m_AsyncMutex.unlock();
-		m_AsyncMutex.lock_shared();
-		for (it = m_AsyncOperations.begin(); it != m_AsyncOperations.end(); ++it)
-			if (*it == item)
-				break;
-		m_AsyncMutex.unlock_shared();
-	}
-
-	SendTask(CreateTask(AsyncWriteTask, std::bind(&FileSystem::AsyncWriteFn, this, it, beginWriteFunc, endWriteFunc)));
+	SendKeyedTask(CreateTask(AsyncWriteTask, std::bind(&FileSystem::AsyncWriteFn, this, FileAsync{ buffer, bufferSize, file }, beginWriteFunc, endWriteFunc)), (SIZET)file);
 	LogManager::LogMessage(LL_INFO, "AsyncWrite operation started on File: %ls.", file->GetNameW().c_str());
 	return FileSysError_t::NoError;
 }
 
+Future<FileAsyncResult> FileSystem::ReadAsync(File* file, void* buffer, const SIZET bufferSize)
+{
+	FileSysError_t inputError = FileSysError_t::NoError;
+	if (!file || !buffer || bufferSize == 0)
+	{
+		LogManager::LogMessage(LL_ERRO, "Trying to start a ReadAsync with a nullptr File, a nullptr Buffer or an empty buffer.");
+		inputError = FileSysError_t::InputError;
+	}
+	const auto readFn = [file, buffer, bufferSize, inputError]()
+	{
+		FileAsyncResult result{ inputError, 0 };
+		if (inputError == FileSysError_t::NoError)
+		{
+			GAF_TRACE_SCOPE("FileRead");
+			result.Error = file->LoadContents(buffer, bufferSize, result.Bytes);
+		}
+		return result;
+	};
+	return SendKeyedTask(AsyncReadTask_Name, readFn, (SIZET)file);
+}
+
+Future<FileAsyncResult> FileSystem::WriteAsync(File* file, void* buffer, const SIZET bufferSize)
+{
+	FileSysError_t inputError = FileSysError_t::NoError;
+	if (!file || !buffer || bufferSize == 0)
+	{
+		LogManager::LogMessage(LL_ERRO, "Trying to start a WriteAsync with a nullptr File, a nullptr Buffer or an empty buffer.");
+		inputError = FileSysError_t::InputError;
+	}
+	const auto writeFn = [file, buffer, bufferSize, inputError]()
+	{
+		FileAsyncResult result{ inputError, 0 };
+		if (inputError == FileSysError_t::NoError)
+		{
+			GAF_TRACE_SCOPE("FileWrite");
+			result.Error = file->StoreContents(buffer, bufferSize, result.Bytes);
+		}
+		return result;
+	};
+	return SendKeyedTask(AsyncWriteTask_Name, writeFn, (SIZET)file);
+}
+
 FileSysError_t FileSystem::GetExternalFile(const std::string & filePathName, File *& file)
 {
 	return GetExternalFile(StringUtils::s2ws(filePathName), file);
@@ -0,0 +1,139 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Future.h"
+#include "GAF/TaskManager.h"
+
+using namespace gaf;
+using namespace gaf::Impl;
+
+FutureStateBase::Continuation* const FutureStateBase::ClosedList = reinterpret_cast<FutureStateBase::Continuation*>(1);
+
+FutureStateBase::FutureStateBase(TaskManager* manager)
+	:m_RefCount(0)
+	,m_Ready(false)
+	,m_Continuations(nullptr)
+	,m_HasException(false)
+	,m_Manager(manager)
+	,PendingInputs(0)
+{
+	Assertion::WhenNullptr(manager, "Trying to create a Future with a nullptr manager.");
+}
+
+void FutureStateBase::AddRef()
+{
+	m_RefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FutureStateBase::Release()
+{
+	if (m_RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Destroy();
+}
+
+bool FutureStateBase::IsReady() const
+{
+	return m_Ready.load(std::memory_order_acquire);
+}
+
+void FutureStateBase::MarkReady()
+{
+	m_Ready.store(true, std::memory_order_release);
+	m_ReadyEvent.NotifyAll();
+	auto list = m_Continuations.exchange(ClosedList, std::memory_order_acq_rel);
+	/* Already marked ready, its continuations were run back then */
+	if (list == ClosedList)
+		return;
+	/* The list is LIFO, reverse it so continuations run in the order they were added */
+	Continuation* ordered = nullptr;
+	while (list)
+	{
+		const auto next = list->Next;
+		list->Next = ordered;
+		ordered = list;
+		list = next;
+	}
+	while (ordered)
+	{
+		const auto next = ordered->Next;
+		if (ordered->RunInline)
+			ordered->Task();
+		else
+			m_Manager->SendTask(std::move(ordered->Task));
+		TaskPool::Delete(ordered);
+		ordered = next;
+	}
+}
+
+void FutureStateBase::StoreException(std::exception_ptr exception)
+{
+	if (!m_HasException.exchange(true, std::memory_order_acq_rel))
+		m_Exception = std::move(exception);
+}
+
+void FutureStateBase::SetException(std::exception_ptr exception)
+{
+	StoreException(std::move(exception));
+	MarkReady();
+}
+
+bool FutureStateBase::HasException() const
+{
+	return m_HasException.load(std::memory_order_acquire);
+}
+
+const std::exception_ptr& FutureStateBase::GetException() const
+{
+	return m_Exception;
+}
+
+void FutureStateBase::RethrowException() const
+{
+	if (HasException())
+		std::rethrow_exception(m_Exception);
+}
+
+void FutureStateBase::AddContinuation(Task_t task, const bool runInline)
+{
+	auto head = m_Continuations.load(std::memory_order_acquire);
+	if (head != ClosedList)
+	{
+		auto node = TaskPool::New<Continuation>(Continuation{ std::move(task), head, runInline });
+		while (head != ClosedList)
+		{
+			node->Next = head;
+			if (m_Continuations.compare_exchange_weak(head, node, std::memory_order_acq_rel, std::memory_order_acquire))
+				return;
+		}
+		task = std::move(node->Task);
+		TaskPool::Delete(node);
+	}
+	/* Already ready */
+	if (runInline)
+		task();
+	else
+		m_Manager->SendTask(std::move(task));
+}
+
+void FutureStateBase::Wait()
+{
+	m_Manager->HelpUntil(m_ReadyEvent, [this]() { return IsReady(); });
+}
+
+TaskManager* FutureStateBase::GetManager() const
+{
+	return m_Manager;
+}
@@ -0,0 +1,678 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#include "GAF/GAFBenchmark.h"
+#include "GAF/Application.h"
+#include "GAF/EventManager.h"
+#include "GAF/HWDetector.h"
+#include "GAF/MPMCQueue.h"
+
+CreateTaskName(BenchmarkTask);
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	/* Exposes the sending functions, which are only available to the dispatcher subclasses */
+	class BenchmarkDispatcher : public gaf::TaskDispatcher
+	{
+	public:
+		explicit BenchmarkDispatcher(gaf::TaskManager* manager)
+			:TaskDispatcher("BenchmarkDispatcher", manager)
+		{
+
+		}
+		using TaskDispatcher::SendTask;
+		using TaskDispatcher::SendKeyedTask;
+	};
+
+	double ToSeconds(const Clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	void BusyWait(const std::chrono::microseconds duration)
+	{
+		const auto end = Clock::now() + duration;
+		while (Clock::now() < end);
+	}
+
+	/* The calling thread doesn't help, so only the TaskHandlers are measured */
+	void WaitForCount(const std::atomic<SIZET>& count, const SIZET target)
+	{
+		while (count.load(std::memory_order_acquire) < target)
+			std::this_thread::yield();
+	}
+
+	/* In microseconds, samples must be sorted */
+	double Percentile(const std::vector<Clock::duration>& samples, const double percentile)
+	{
+		const auto index = gaf::Min(static_cast<SIZET>(percentile * samples.size() / 100.0), samples.size() - 1);
+		return std::chrono::duration<double, std::micro>(samples[index]).count();
+	}
+
+	/*
+		Items moved through the queue per second, every producer pushes its
+		share and every consumer pops a fixed quota, so nobody has to tell
+		the consumers when to stop.
+	*/
+	template<typename Queue>
+	double MeasureQueue(const uint32 producers, const uint32 consumers, const SIZET numItems)
+	{
+		Queue queue;
+		const SIZET perProducer = numItems / producers;
+		const SIZET total = perProducer * producers;
+		std::atomic<uint32> ready(0);
+		std::atomic_bool go(false);
+		std::vector<std::thread> threads;
+		threads.reserve(producers + consumers);
+		for (uint32 i = 0; i < producers; ++i)
+		{
+			threads.emplace_back([&queue, &ready, &go, perProducer]()
+			{
+				ready.fetch_add(1);
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				for (SIZET j = 0; j < perProducer; ++j)
+					queue.PushBack(static_cast<uint64>(j));
+			});
+		}
+		for (uint32 i = 0; i < consumers; ++i)
+		{
+			const SIZET quota = total / consumers + (i < total % consumers ? 1 : 0);
+			threads.emplace_back([&queue, &ready, &go, quota]()
+			{
+				ready.fetch_add(1);
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				uint64 val;
+				for (SIZET popped = 0; popped < quota;)
+				{
+					if (queue.PopFront(val))
+						++popped;
+					else
+						std::this_thread::yield();
+				}
+			});
+		}
+		while (ready.load() != producers + consumers)
+			std::this_thread::yield();
+		const auto begin = Clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& thread : threads)
+			thread.join();
+		return static_cast<double>(total) / ToSeconds(Clock::now() - begin);
+	}
+}
+
+GAFBenchmark::GAFBenchmark()
+	:Test("GAFBenchmark")
+{
+	using namespace std::placeholders;
+	m_Tests = { { "MPMCQueue Benchmark", std::bind(&GAFBenchmark::QueueBenchmark, this, _1) }
+		,{ "TaskThroughput Benchmark", std::bind(&GAFBenchmark::TaskThroughputBenchmark, this, _1) }
+		,{ "TaskLatency Benchmark", std::bind(&GAFBenchmark::TaskLatencyBenchmark, this, _1) }
+		,{ "DispatcherFairness Benchmark", std::bind(&GAFBenchmark::DispatcherFairnessBenchmark, this, _1) }
+		,{ "Scaling Benchmark", std::bind(&GAFBenchmark::ScalingBenchmark, this, _1) }
+		,{ "EventRouting Benchmark", std::bind(&GAFBenchmark::EventRoutingBenchmark, this, _1) }
+		,{ "EventDispatch Benchmark", std::bind(&GAFBenchmark::EventDispatchBenchmark, this, _1) }
+		,{ "EventName Benchmark", std::bind(&GAFBenchmark::EventNameBenchmark, this, _1) } };
+}
+
+void GAFBenchmark::AddMetric(std::string benchmark, std::string caseName, const uint32 threads, const double value, std::string unit)
+{
+	m_Metrics.push_back({ std::move(benchmark), std::move(caseName), threads, value, std::move(unit) });
+}
+
+std::vector<uint32> GAFBenchmark::GetThreadCounts()
+{
+	const auto cores = gaf::Max(gaf::InstanceHW()->GetNumberLogicalCores(), 1U);
+	std::vector<uint32> counts;
+	for (uint32 count = 1; count < cores; count *= 2)
+		counts.push_back(count);
+	counts.push_back(cores);
+	return counts;
+}
+
+void GAFBenchmark::QueueBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numItems = 1000000;
+	using BoundedQueue = gaf::MPMCQueue<uint64, 4096>;
+	using UnboundedQueue = gaf::MPMCQueue<uint64>;
+	/* Producers and consumers of every case: balanced, fan-out and fan-in */
+	std::vector<std::pair<uint32, uint32>> cases;
+	for (const auto count : GetThreadCounts())
+	{
+		cases.emplace_back(count, count);
+		if (count > 1)
+		{
+			cases.emplace_back(1, count);
+			cases.emplace_back(count, 1);
+		}
+	}
+	PRETEST_END();
+
+	for (const auto& threads : cases)
+	{
+		const auto caseName = "P" + std::to_string(threads.first) + "C" + std::to_string(threads.second);
+		DOTEST_BEGIN("MPMCQueueBounded" + caseName);
+		AddMetric("MPMCQueueBounded", caseName, threads.first + threads.second, MeasureQueue<BoundedQueue>(threads.first, threads.second, numItems), "items/s");
+		DOTEST_END();
+		DOTEST_BEGIN("MPMCQueueUnbounded" + caseName);
+		AddMetric("MPMCQueueUnbounded", caseName, threads.first + threads.second, MeasureQueue<UnboundedQueue>(threads.first, threads.second, numItems), "items/s");
+		DOTEST_END();
+	}
+}
+
+void GAFBenchmark::TaskThroughputBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 1000000;
+	constexpr SIZET batchSize = 256;
+	const auto app = gaf::InstanceApp();
+	const auto handlers = static_cast<uint32>(app->GetNumberTaskHandlers());
+	std::atomic<SIZET> done(0);
+	/* Tasks that didn't fit in a full queue and were executed by the sender */
+	std::atomic<SIZET> executedBySender(0);
+	const auto emptyFn = [&done, &executedBySender]()
+	{
+		if (!gaf::TaskHandler::GetCurrent())
+			executedBySender.fetch_add(1, std::memory_order_relaxed);
+		done.fetch_add(1, std::memory_order_relaxed);
+	};
+	std::vector<gaf::Task_t> batch;
+	batch.reserve(batchSize);
+	PRETEST_END();
+
+	/* Single sends from outside the pool, every task goes through the global queue */
+	DOTEST_BEGIN("TaskThroughputSendTask");
+	done.store(0);
+	executedBySender.store(0);
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numTasks; ++i)
+		app->SendTask(CreateTask(BenchmarkTask, emptyFn));
+	WaitForCount(done, numTasks);
+	AddMetric("TaskThroughput", "SendTask", handlers, numTasks / ToSeconds(Clock::now() - begin), "tasks/s");
+	AddMetric("TaskThroughput", "SendTaskBySender", handlers, static_cast<double>(executedBySender.load()) / numTasks, "ratio");
+	DOTEST_END();
+
+	DOTEST_BEGIN("TaskThroughputSendTasks");
+	done.store(0);
+	executedBySender.store(0);
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numTasks; i += batchSize)
+	{
+		for (SIZET j = i; j < gaf::Min(i + batchSize, numTasks); ++j)
+			batch.push_back(CreateTask(BenchmarkTask, emptyFn));
+		app->SendTasks(batch);
+	}
+	WaitForCount(done, numTasks);
+	AddMetric("TaskThroughput", "SendTasks" + std::to_string(batchSize), handlers, numTasks / ToSeconds(Clock::now() - begin), "tasks/s");
+	AddMetric("TaskThroughput", "SendTasks" + std::to_string(batchSize) + "BySender", handlers, static_cast<double>(executedBySender.load()) / numTasks, "ratio");
+	DOTEST_END();
+
+	/* Every TaskHandler spawns its share, so the tasks go to the local queues and get stolen */
+	DOTEST_BEGIN("TaskThroughputSpawned");
+	done.store(0);
+	const SIZET perRoot = numTasks / handlers;
+	const auto spawnFn = [app, &emptyFn, perRoot]()
+	{
+		for (SIZET i = 0; i < perRoot; ++i)
+			app->SendTask(CreateTask(BenchmarkTask, emptyFn));
+	};
+	const auto begin = Clock::now();
+	for (uint32 i = 0; i < handlers; ++i)
+		app->SendTask(CreateTask(BenchmarkTask, spawnFn));
+	WaitForCount(done, perRoot * handlers);
+	AddMetric("TaskThroughput", "Spawned", handlers, (perRoot * handlers) / ToSeconds(Clock::now() - begin), "tasks/s");
+	DOTEST_END();
+}
+
+void GAFBenchmark::TaskLatencyBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numSamples = 1000;
+	constexpr SIZET busyTasksPerHandler = 2;
+	const auto app = gaf::InstanceApp();
+	const auto handlers = static_cast<uint32>(app->GetNumberTaskHandlers());
+	std::vector<Clock::duration> latencies(numSamples);
+	std::atomic<SIZET> done(0);
+	const auto busyFn = []() { BusyWait(std::chrono::microseconds(20)); };
+	const auto addPercentiles = [this, &latencies, handlers](const std::string& caseName)
+	{
+		std::sort(latencies.begin(), latencies.end());
+		AddMetric("TaskLatency", caseName + "P50", handlers, Percentile(latencies, 50.0), "us");
+		AddMetric("TaskLatency", caseName + "P90", handlers, Percentile(latencies, 90.0), "us");
+		AddMetric("TaskLatency", caseName + "P99", handlers, Percentile(latencies, 99.0), "us");
+		AddMetric("TaskLatency", caseName + "P999", handlers, Percentile(latencies, 99.9), "us");
+		AddMetric("TaskLatency", caseName + "Max", handlers, Percentile(latencies, 100.0), "us");
+	};
+	PRETEST_END();
+
+	/* The TaskHandlers have parked by the time every sample is sent */
+	DOTEST_BEGIN("TaskLatencyIdle");
+	done.store(0);
+	for (SIZET i = 0; i < numSamples; ++i)
+	{
+		const auto sent = Clock::now();
+		const auto latencyFn = [&latencies, &done, sent, i]()
+		{
+			latencies[i] = Clock::now() - sent;
+			done.fetch_add(1, std::memory_order_release);
+		};
+		app->SendTask(CreateTask(BenchmarkTask, latencyFn));
+		WaitForCount(done, i + 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	addPercentiles("Idle");
+	DOTEST_END();
+
+	/* Every TaskHandler has busy work queued ahead of the sample */
+	DOTEST_BEGIN("TaskLatencySaturated");
+	done.store(0);
+	for (SIZET i = 0; i < numSamples; ++i)
+	{
+		for (SIZET j = 0; j < handlers * busyTasksPerHandler; ++j)
+			app->SendTask(CreateTask(BenchmarkTask, busyFn));
+		const auto sent = Clock::now();
+		const auto latencyFn = [&latencies, &done, sent, i]()
+		{
+			latencies[i] = Clock::now() - sent;
+			done.fetch_add(1, std::memory_order_release);
+		};
+		app->SendTask(CreateTask(BenchmarkTask, latencyFn));
+		WaitForCount(done, i + 1);
+	}
+	addPercentiles("Saturated");
+	DOTEST_END();
+
+	/* Like the saturated case, but the busy work is BACKGROUND and the sample is HIGH priority */
+	DOTEST_BEGIN("TaskLatencyHighPriority");
+	done.store(0);
+	for (SIZET i = 0; i < numSamples; ++i)
+	{
+		for (SIZET j = 0; j < handlers * busyTasksPerHandler; ++j)
+		{
+			auto busyTask = CreateTask(BenchmarkTask, busyFn);
+			busyTask.SetPriority(gaf::ETaskPriority::BACKGROUND);
+			app->SendTask(std::move(busyTask));
+		}
+		const auto sent = Clock::now();
+		const auto latencyFn = [&latencies, &done, sent, i]()
+		{
+			latencies[i] = Clock::now() - sent;
+			done.fetch_add(1, std::memory_order_release);
+		};
+		auto latencyTask = CreateTask(BenchmarkTask, latencyFn);
+		latencyTask.SetPriority(gaf::ETaskPriority::HIGH);
+		app->SendTask(std::move(latencyTask));
+		WaitForCount(done, i + 1);
+	}
+	/* The background tasks left behind must not skew the next case */
+	while (app->GetNumPendingTasks(gaf::ETaskPriority::BACKGROUND) > 0)
+		std::this_thread::yield();
+	addPercentiles("HighPriority");
+	DOTEST_END();
+
+	/* Every sample is sent at once, so the distribution shows how fast the pool drains a burst */
+	DOTEST_BEGIN("TaskLatencyBurst");
+	done.store(0);
+	std::vector<gaf::Task_t> burst;
+	burst.reserve(numSamples);
+	const auto sent = Clock::now();
+	for (SIZET i = 0; i < numSamples; ++i)
+	{
+		const auto latencyFn = [&latencies, &done, sent, i]()
+		{
+			latencies[i] = Clock::now() - sent;
+			done.fetch_add(1, std::memory_order_release);
+		};
+		burst.push_back(CreateTask(BenchmarkTask, latencyFn));
+	}
+	app->SendTasks(burst);
+	WaitForCount(done, numSamples);
+	addPercentiles("Burst");
+	DOTEST_END();
+}
+
+void GAFBenchmark::DispatcherFairnessBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 100000;
+	constexpr uint32 numHandlers = 4;
+	constexpr SIZET numKeys = 1024;
+	const auto app = gaf::InstanceApp();
+	BenchmarkDispatcher dispatcher(app);
+	app->RegisterTaskDispatcher(&dispatcher, numHandlers, "gaf-bench");
+	std::vector<const gaf::TaskHandler*> executors(numTasks);
+	std::atomic<SIZET> done(0);
+	/* Jain's fairness index of the tasks executed per handler, 1 is a perfect split, and the smallest share against the even one */
+	const auto addFairness = [this, &executors](const std::string& caseName)
+	{
+		std::map<const gaf::TaskHandler*, SIZET> perHandler;
+		for (const auto executor : executors)
+			++perHandler[executor];
+		std::vector<double> counts(numHandlers, 0.0);
+		SIZET index = 0;
+		for (const auto& handler : perHandler)
+			counts[index++ % numHandlers] += static_cast<double>(handler.second);
+		double sum = 0.0, sumSquares = 0.0, minCount = counts[0];
+		for (const auto count : counts)
+		{
+			sum += count;
+			sumSquares += count * count;
+			minCount = gaf::Min(minCount, count);
+		}
+		AddMetric("DispatcherFairness", caseName + "Jain", numHandlers, (sum * sum) / (numHandlers * sumSquares), "index");
+		AddMetric("DispatcherFairness", caseName + "MinShare", numHandlers, minCount / (sum / numHandlers), "ratio");
+	};
+	PRETEST_END();
+
+	/* The dispatcher picks the less loaded of two random handlers */
+	DOTEST_BEGIN("DispatcherFairnessBalanced");
+	done.store(0);
+	for (SIZET i = 0; i < numTasks; ++i)
+	{
+		const auto recordFn = [&executors, &done, i]()
+		{
+			executors[i] = gaf::TaskHandler::GetCurrent();
+			done.fetch_add(1, std::memory_order_release);
+		};
+		dispatcher.SendTask(CreateTask(BenchmarkTask, recordFn));
+	}
+	WaitForCount(done, numTasks);
+	addFairness("Balanced");
+	DOTEST_END();
+
+	/* Keys are hashed to the handlers */
+	DOTEST_BEGIN("DispatcherFairnessKeyed");
+	done.store(0);
+	for (SIZET i = 0; i < numTasks; ++i)
+	{
+		const auto recordFn = [&executors, &done, i]()
+		{
+			executors[i] = gaf::TaskHandler::GetCurrent();
+			done.fetch_add(1, std::memory_order_release);
+		};
+		dispatcher.SendKeyedTask(CreateTask(BenchmarkTask, recordFn), i % numKeys);
+	}
+	WaitForCount(done, numTasks);
+	addFairness("Keyed");
+	DOTEST_END();
+
+	app->UnregisterTaskDispatcher(&dispatcher);
+}
+
+void GAFBenchmark::ScalingBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numEmptyTasks = 200000;
+	constexpr SIZET numBusyTasks = 4096;
+	const auto app = gaf::InstanceApp();
+	const auto prevHandlers = app->GetNumberTaskHandlers();
+	const auto prevMinHandlers = app->GetMinTaskHandlers();
+	const auto prevMaxHandlers = app->GetMaxTaskHandlers();
+	std::atomic<SIZET> done(0);
+	const auto emptyFn = [&done]() { done.fetch_add(1, std::memory_order_relaxed); };
+	const auto busyFn = [&done]()
+	{
+		BusyWait(std::chrono::microseconds(50));
+		done.fetch_add(1, std::memory_order_relaxed);
+	};
+	std::vector<gaf::Task_t> batch;
+	double baseBusyThroughput = 0.0;
+	PRETEST_END();
+
+	for (const auto threads : GetThreadCounts())
+	{
+		app->SetTaskHandlerLimits(threads, threads);
+		app->SetNumberTaskHandlers(threads);
+		DOTEST_BEGIN("Scaling" + std::to_string(threads));
+		/* Scheduling overhead alone */
+		done.store(0);
+		for (SIZET i = 0; i < numEmptyTasks; ++i)
+			batch.push_back(CreateTask(BenchmarkTask, emptyFn));
+		auto begin = Clock::now();
+		app->SendTasks(batch);
+		WaitForCount(done, numEmptyTasks);
+		AddMetric("ScalingEmpty", "Throughput", threads, numEmptyTasks / ToSeconds(Clock::now() - begin), "tasks/s");
+
+		/* Work that should scale with the cores */
+		done.store(0);
+		for (SIZET i = 0; i < numBusyTasks; ++i)
+			batch.push_back(CreateTask(BenchmarkTask, busyFn));
+		begin = Clock::now();
+		app->SendTasks(batch);
+		WaitForCount(done, numBusyTasks);
+		const auto busyThroughput = numBusyTasks / ToSeconds(Clock::now() - begin);
+		if (baseBusyThroughput == 0.0)
+			baseBusyThroughput = busyThroughput;
+		AddMetric("ScalingBusy", "Throughput", threads, busyThroughput, "tasks/s");
+		AddMetric("ScalingBusy", "Speedup", threads, busyThroughput / baseBusyThroughput, "x");
+		AddMetric("ScalingBusy", "Efficiency", threads, busyThroughput / (baseBusyThroughput * threads), "ratio");
+		DOTEST_END();
+	}
+	app->SetTaskHandlerLimits(prevMinHandlers, prevMaxHandlers);
+	app->SetNumberTaskHandlers(prevHandlers);
+}
+
+void GAFBenchmark::EventRoutingBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numEvents = 1000;
+	constexpr SIZET numListeners = 10000;
+	constexpr SIZET eventsPerListener = 4;
+	constexpr SIZET numAllListeners = 16;
+	constexpr SIZET numDispatches = 20000;
+	const auto app = gaf::InstanceApp();
+	const auto evtMgr = gaf::InstanceEvent();
+	const auto handlers = static_cast<uint32>(app->GetNumberTaskHandlers());
+	std::atomic<SIZET> calls(0);
+	const auto listenerFn = [&calls](gaf::EventID, void*) { calls.fetch_add(1, std::memory_order_relaxed); };
+	std::vector<std::string> eventNames;
+	eventNames.reserve(numEvents);
+	for (SIZET i = 0; i < numEvents; ++i)
+		eventNames.push_back("GAFBenchmarkEvent" + std::to_string(i));
+	const auto events = evtMgr->RegisterEvents(eventNames);
+	std::vector<gaf::EventListenerID> listeners;
+	listeners.reserve(numListeners + numAllListeners);
+	/* Listeners of every event, so the calls expected per dispatch can be known beforehand */
+	std::vector<SIZET> subscribers(numEvents, numAllListeners);
+	PRETEST_END();
+
+	/* Each listener subscribes to a few scattered events, plus some listeners of all of them */
+	DOTEST_BEGIN("EventRoutingSubscribe");
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numListeners; ++i)
+	{
+		std::vector<gaf::EventID> listening;
+		for (SIZET j = 0; j < eventsPerListener; ++j)
+		{
+			const auto index = (i * 7919 + j * 104729) % numEvents;
+			listening.push_back(events[index]);
+			++subscribers[index];
+		}
+		listeners.push_back(evtMgr->RegisterEventListener(listenerFn, listening));
+	}
+	for (SIZET i = 0; i < numAllListeners; ++i)
+		listeners.push_back(evtMgr->RegisterEventListener(listenerFn));
+	AddMetric("EventRouting", "Subscribe", 1, listeners.size() / ToSeconds(Clock::now() - begin), "listeners/s");
+	DOTEST_END();
+
+	/* Events are dispatched round robin, only their subscribers should be called */
+	DOTEST_BEGIN("EventRoutingDispatch");
+	calls.store(0);
+	SIZET expectedCalls = 0;
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numDispatches; ++i)
+	{
+		evtMgr->DispatchEvent(events[i % numEvents], nullptr);
+		expectedCalls += subscribers[i % numEvents];
+	}
+	WaitForCount(calls, expectedCalls);
+	const auto elapsed = ToSeconds(Clock::now() - begin);
+	AddMetric("EventRouting", "Dispatch", handlers, numDispatches / elapsed, "events/s");
+	AddMetric("EventRouting", "ListenerCalls", handlers, expectedCalls / elapsed, "calls/s");
+	DOTEST_END();
+
+	DOTEST_BEGIN("EventRoutingUnsubscribe");
+	const auto begin = Clock::now();
+	for (const auto listener : listeners)
+		evtMgr->UnregisterEventListener(listener);
+	AddMetric("EventRouting", "Unsubscribe", 1, listeners.size() / ToSeconds(Clock::now() - begin), "listeners/s");
+	DOTEST_END();
+
+	for (const auto event : events)
+		evtMgr->UnregisterEvent(event);
+}
+
+void GAFBenchmark::EventDispatchBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numDispatches = 200000;
+	/* Dispatches between flushes of the FRAME and COALESCED events */
+	constexpr SIZET frameSize = 1000;
+	const auto app = gaf::InstanceApp();
+	const auto evtMgr = gaf::InstanceEvent();
+	const auto handlers = static_cast<uint32>(app->GetNumberTaskHandlers());
+	std::atomic<SIZET> calls(0);
+	const auto listenerFn = [&calls](gaf::EventID, void*) { calls.fetch_add(1, std::memory_order_relaxed); };
+	const gaf::EEventDispatch::Type modes[] = { gaf::EEventDispatch::ASYNC, gaf::EEventDispatch::IMMEDIATE,
+		gaf::EEventDispatch::FRAME, gaf::EEventDispatch::COALESCED };
+	std::vector<gaf::EventID> events;
+	std::vector<gaf::EventListenerID> listeners;
+	for (const auto mode : modes)
+	{
+		events.push_back(evtMgr->RegisterEvent(std::string("GAFBenchmark") + gaf::GetEventDispatchStr(mode), mode));
+		listeners.push_back(evtMgr->RegisterEventListener(listenerFn, events.back()));
+	}
+	PRETEST_END();
+
+	/* Sender side cost plus the time until every listener call that wasn't coalesced is done */
+	for (SIZET i = 0; i < events.size(); ++i)
+	{
+		const std::string caseName = gaf::GetEventDispatchStr(modes[i]);
+		DOTEST_BEGIN("EventDispatch" + caseName);
+		calls.store(0);
+		const auto begin = Clock::now();
+		for (SIZET j = 0; j < numDispatches; ++j)
+		{
+			evtMgr->DispatchEvent(events[i], nullptr);
+			if ((j + 1) % frameSize == 0)
+				evtMgr->FlushEvents();
+		}
+		evtMgr->FlushEvents();
+		WaitForCount(calls, modes[i] == gaf::EEventDispatch::COALESCED ? numDispatches / frameSize : numDispatches);
+		AddMetric("EventDispatch", caseName, handlers, numDispatches / ToSeconds(Clock::now() - begin), "events/s");
+		DOTEST_END();
+	}
+
+	for (const auto listener : listeners)
+		evtMgr->UnregisterEventListener(listener);
+	for (const auto event : events)
+		evtMgr->UnregisterEvent(event);
+}
+
+void GAFBenchmark::EventNameBenchmark(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numEvents = 10000;
+	constexpr SIZET numLookups = 1000000;
+	const auto evtMgr = gaf::InstanceEvent();
+	std::vector<std::string> eventNames;
+	eventNames.reserve(numEvents);
+	for (SIZET i = 0; i < numEvents; ++i)
+		eventNames.push_back("GAFBenchmarkName" + std::to_string(i));
+	/* Hashed beforehand, as GAF_EVENT does at compile time */
+	std::vector<gaf::EventName> hashedNames;
+	hashedNames.reserve(numEvents);
+	for (const auto& eventName : eventNames)
+		hashedNames.emplace_back(eventName);
+	std::vector<gaf::EventID> events;
+	PRETEST_END();
+
+	DOTEST_BEGIN("EventNameRegisterBulk");
+	const auto begin = Clock::now();
+	events = evtMgr->RegisterEvents(eventNames);
+	AddMetric("EventName", "RegisterBulk", 1, numEvents / ToSeconds(Clock::now() - begin), "events/s");
+	DOTEST_END();
+
+	DOTEST_BEGIN("EventNameLookupString");
+	SIZET found = 0;
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numLookups; ++i)
+		found += evtMgr->GetEventIDFromName(eventNames[i % numEvents]) == events[i % numEvents] ? 1 : 0;
+	AddMetric("EventName", "LookupString", 1, numLookups / ToSeconds(Clock::now() - begin), "lookups/s");
+	AddMetric("EventName", "LookupStringFound", 1, static_cast<double>(found) / numLookups, "ratio");
+	DOTEST_END();
+
+	DOTEST_BEGIN("EventNameLookupHashed");
+	SIZET found = 0;
+	const auto begin = Clock::now();
+	for (SIZET i = 0; i < numLookups; ++i)
+		found += evtMgr->GetEventIDFromName(hashedNames[i % numEvents]) == events[i % numEvents] ? 1 : 0;
+	AddMetric("EventName", "LookupHashed", 1, numLookups / ToSeconds(Clock::now() - begin), "lookups/s");
+	AddMetric("EventName", "LookupHashedFound", 1, static_cast<double>(found) / numLookups, "ratio");
+	DOTEST_END();
+
+	for (const auto event : events)
+		evtMgr->UnregisterEvent(event);
+}
+
+void GAFBenchmark::WriteResults()const
+{
+	const auto cores = gaf::InstanceHW()->GetNumberLogicalCores();
+	/* JSON has no representation for inf or nan */
+	const auto valueStr = [](const double value)
+	{
+		std::stringstream ss;
+		ss << std::fixed << std::setprecision(3) << (std::isfinite(value) ? value : 0.0);
+		return ss.str();
+	};
+
+	std::ofstream json(m_TestName + "_Result.json");
+	json << "{\n\t\"name\": \"" << m_TestName << "\",\n\t\"logicalCores\": " << cores
+		<< ",\n\t\"queueCapacity\": " << GREAPER_TASKMAN_QUEUE_CAPACITY
+		<< ",\n\t\"dispatcherQueueCapacity\": " << GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY
+		<< ",\n\t\"fibers\": " << (GREAPER_TASKMAN_FIBERS ? "true" : "false")
+		<< ",\n\t\"results\": [";
+	for (SIZET i = 0; i < m_Metrics.size(); ++i)
+	{
+		const auto& metric = m_Metrics[i];
+		json << (i == 0 ? "\n" : ",\n") << "\t\t{ \"benchmark\": \"" << metric.Benchmark << "\", \"case\": \"" << metric.Case
+			<< "\", \"threads\": " << metric.Threads << ", \"value\": " << valueStr(metric.Value) << ", \"unit\": \"" << metric.Unit << "\" }";
+	}
+	json << "\n\t]\n}\n";
+
+	std::ofstream csv(m_TestName + "_Result.csv");
+	csv << "benchmark,case,threads,value,unit\n";
+	for (const auto& metric : m_Metrics)
+		csv << metric.Benchmark << ',' << metric.Case << ',' << metric.Threads << ',' << valueStr(metric.Value) << ',' << metric.Unit << '\n';
+}
+
+void GAFBenchmark::Run()
+{
+	m_Metrics.clear();
+	Test::Run();
+	WriteResults();
+}
+
+const std::vector<GAFBenchmark::Metric>& GAFBenchmark::GetMetrics()const
+{
+	return m_Metrics;
+}
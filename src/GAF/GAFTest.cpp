@@ -21,6 +21,20 @@
 #include "GAF/WindowManager.h"
 #include "GAF/CryptoAPI.h"
 #include "GAF/InputManager.h"
+#include "GAF/Application.h"
+#include "GAF/HWDetector.h"
+#include "GAF/Parallel.h"
+#include "GAF/Strand.h"
+#include "GAF/TaskGraph.h"
+#include "GAF/TaskTrace.h"
+#include "GAF/Coroutine.h"
+#include "GAF/WorkStealingQueue.h"
+
+CreateTaskName(ParkTestTask);
+CreateTaskName(OverflowTestTask);
+CreateTaskName(PlacementTestTask);
+CreateTaskName(PoolTestTask);
+CreateTaskName(BatchTestTask);
 
 GAFTest::GAFTest()
 	:Test("GAFTest")
@@ -29,12 +43,27 @@ GAFTest::GAFTest()
 	m_Tests = { {"FileSystem Test", std::bind(&GAFTest::FileSysTest, this, _1)}
 		,{ "LogManager Test", std::bind(&GAFTest::LogTest, this, _1)}
 		,{ "EventManager Test", std::bind(&GAFTest::EventTest, this, _1)}
+		,{ "EventManager Routing Test", std::bind(&GAFTest::EventRoutingTest, this, _1)}
 		,{ "PropertiesManager Test", std::bind(&GAFTest::PropertyTest, this, _1)}
 		,{ "WindowManager Test", std::bind(&GAFTest::WindowTest, this, _1)}
 		,{ "CryptoAPI Test", std::bind(&GAFTest::CryptoTest, this, _1) }
 		,{ "ResourceManager Test", std::bind(&GAFTest::ResourceTest, this, _1)}
 		,{ "CommandSystem Test", std::bind(&GAFTest::CommandTest, this, _1)}
-		,{ "InputManager Test", std::bind(&GAFTest::InputTest, this, _1) } };
+		,{ "InputManager Test", std::bind(&GAFTest::InputTest, this, _1) }
+		,{ "Task Test", std::bind(&GAFTest::TaskObjectTest, this, _1) }
+		,{ "WorkStealingQueue Test", std::bind(&GAFTest::WorkStealingTest, this, _1) }
+		,{ "TaskManager Test", std::bind(&GAFTest::TaskTest, this, _1) }
+		,{ "TaskStats Test", std::bind(&GAFTest::StatsTest, this, _1) }
+		,{ "TaskTrace Test", std::bind(&GAFTest::TraceTest, this, _1) }
+		,{ "TaskGraph Test", std::bind(&GAFTest::TaskGraphTest, this, _1) }
+		,{ "TaskDispatcher Test", std::bind(&GAFTest::DispatcherTest, this, _1) }
+		,{ "Future Test", std::bind(&GAFTest::FutureTest, this, _1) }
+		,{ "Coroutine Test", std::bind(&GAFTest::CoroutineTest, this, _1) }
+		,{ "Strand Test", std::bind(&GAFTest::StrandTest, this, _1) }
+		,{ "TimerWheel Test", std::bind(&GAFTest::TimerTest, this, _1) }
+		,{ "Cancellation Test", std::bind(&GAFTest::CancellationTest, this, _1) }
+		,{ "JobCounter Test", std::bind(&GAFTest::JobCounterTest, this, _1) }
+		,{ "Parallel Test", std::bind(&GAFTest::ParallelTest, this, _1) } };
 }
 
 void GAFTest::FileSysTest(ResultVec& resultVec)
@@ -300,6 +329,10 @@ void GAFTest::EventTest(ResultVec & resultVec)
 	const auto id = eventMgr->GetEventIDFromName("TestEvent");
 	gaf::Assertion::WhenEqual(id, gaf::EventManager::NullEventID, "Trying to get the EventID by its name but something went wrong, while performing a test.");
 	DOTEST_END();
+	DOTEST_BEGIN("GetEventIDFromHashedName");
+	const auto hashedID = eventMgr->GetEventIDFromName(GAF_EVENT("TestEvent"));
+	gaf::Assertion::WhenInequal(hashedID, eventID, "Trying to get the EventID by its hashed name but something went wrong, while performing a test.");
+	DOTEST_END();
 	DOTEST_BEGIN("GetEventName");
 	const auto name = eventMgr->GetEventName(testID);
 	gaf::Assertion::WhenInequal(name, "TestEvent2", "Trying to get the event Name but something went wrong, while performing a test.");
@@ -316,6 +349,287 @@ void GAFTest::EventTest(ResultVec & resultVec)
 	DOTEST_BEGIN("EventUnregister");
 	eventMgr->UnregisterEvent(eventID);
 	DOTEST_END();
+	gaf::Assertion::WhenInequal(eventMgr->GetEventIDFromName("TestEvent"), gaf::EventManager::NullEventID, "An unregistered event can still be found by its name, while performing a test.");
+	DOTEST_BEGIN("EventReregister");
+	const auto reusedID = eventMgr->RegisterEvent("TestEvent");
+	gaf::Assertion::WhenInequal(reusedID, eventID, "A registered again event didn't get back its EventID, while performing a test.");
+	eventMgr->UnregisterEvent(reusedID);
+	DOTEST_END();
+
+	DOTEST_BEGIN("RegisterEvents");
+	const auto bulkIDs = eventMgr->RegisterEvents(std::vector<std::string>{ "TestBulkEvent0", "TestBulkEvent1", "TestBulkEvent2", "TestBulkEvent3" });
+	for (SIZET i = 0; i < bulkIDs.size(); ++i)
+	{
+		gaf::Assertion::WhenEqual(bulkIDs[i], gaf::EventManager::NullEventID, "Trying to register a list of events but something went wrong, while performing a test.");
+		gaf::Assertion::WhenInequal(eventMgr->GetEventName(bulkIDs[i]), "TestBulkEvent" + std::to_string(i), "An event registered in a list got the name of another one, while performing a test.");
+		for (SIZET j = 0; j < i; ++j)
+			gaf::Assertion::WhenEqual(bulkIDs[i], bulkIDs[j], "Two events registered in a list got the same EventID, while performing a test.");
+	}
+	for (const auto bulkID : bulkIDs)
+		eventMgr->UnregisterEvent(bulkID);
+	DOTEST_END();
+
+	/*
+		Both names are given the same hash, so they must be told apart by
+		their name. They're IMMEDIATE, so the listener is done when the
+		dispatch returns.
+	*/
+	const gaf::EventName collisionA("TestCollisionA", 1), collisionB("TestCollisionB", 1);
+	DOTEST_BEGIN("EventHashCollision");
+	const auto collisionIDA = eventMgr->RegisterEvent(collisionA, gaf::EEventDispatch::IMMEDIATE);
+	const auto collisionIDB = eventMgr->RegisterEvent(collisionB, gaf::EEventDispatch::IMMEDIATE);
+	uint32 callsA = 0, callsB = 0;
+	const auto collisionListener = eventMgr->RegisterEventListener([&callsA, &callsB, collisionIDA](const gaf::EventID evt, void*)
+	{
+		++(evt == collisionIDA ? callsA : callsB);
+	}, collisionIDB);
+	gaf::Assertion::WhenEqual(collisionIDA, collisionIDB, "Two events with the same hash got the same EventID, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventIDFromName(collisionA), collisionIDA, "An event with a colliding hash was found as another one, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventIDFromName(collisionB), collisionIDB, "An event with a colliding hash was found as another one, while performing a test.");
+	eventMgr->UnregisterEvent(collisionIDA);
+	gaf::Assertion::WhenInequal(eventMgr->GetEventIDFromName(collisionA), gaf::EventManager::NullEventID, "An unregistered event with a colliding hash can still be found, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventIDFromName(collisionB), collisionIDB, "Unregistering an event hid another one with the same hash, while performing a test.");
+	eventMgr->AddEventToListener(collisionListener, collisionIDA);
+	eventMgr->DispatchEvent(collisionIDA, nullptr);
+	eventMgr->DispatchEvent(collisionIDB, nullptr);
+	gaf::Assertion::WhenInequal(callsA, 0U, "An unregistered event could still be listened to, while performing a test.");
+	gaf::Assertion::WhenInequal(callsB, 1U, "Unregistering an event stopped the dispatches of another one with the same hash, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->RegisterEvent(collisionA, gaf::EEventDispatch::IMMEDIATE), collisionIDA, "A registered again event with a colliding hash didn't get back its EventID, while performing a test.");
+	eventMgr->AddEventToListener(collisionListener, collisionIDA);
+	eventMgr->DispatchEvent(collisionIDA, nullptr);
+	gaf::Assertion::WhenInequal(callsA, 1U, "A registered again event with a colliding hash couldn't be listened to, while performing a test.");
+	eventMgr->UnregisterEventListener(collisionListener);
+	eventMgr->UnregisterEvent(collisionIDA);
+	eventMgr->UnregisterEvent(collisionIDB);
+	DOTEST_END();
+}
+
+/* Typed payloads of the routing test, the big one doesn't fit inside the record */
+struct TestEventPayload
+{
+	std::string Text;
+	uint32 Value;
+	/* Released with the payload, so the test can tell when every record is gone */
+	std::shared_ptr<uint32> Tracker;
+};
+
+struct TestBigEventPayload
+{
+	std::array<uint64, 16> Values;
+};
+
+void GAFTest::EventRoutingTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr uint32 numDispatches = 100;
+	const auto eventMgr = gaf::InstanceEvent();
+	const auto routeA = eventMgr->RegisterEvent("TestRouteA"),
+		routeB = eventMgr->RegisterEvent("TestRouteB");
+	std::atomic<uint32> callsA(0), callsB(0), callsAllA(0), callsAllB(0);
+	const auto countFn = [routeA, routeB](std::atomic<uint32>& countA, std::atomic<uint32>& countB, const gaf::EventID evt)
+	{
+		if (evt == routeA)
+			++countA;
+		else if (evt == routeB)
+			++countB;
+	};
+	/* The listeners run in tasks, so the test waits for the calls it expects */
+	const auto waitCount = [](const std::atomic<uint32>& count, const uint32 expected)
+	{
+		while (count.load() < expected)
+			std::this_thread::yield();
+	};
+	gaf::EventListenerID listener = gaf::EventManager::NullEventListenerID, allListener = gaf::EventManager::NullEventListenerID;
+	PRETEST_END();
+
+	DOTEST_BEGIN("EventRoutingByID");
+	listener = eventMgr->RegisterEventListener([&](const gaf::EventID evt, void*) { countFn(callsA, callsB, evt); }, routeA);
+	/* The engine sends its own events meanwhile, so only the test ones are counted */
+	allListener = eventMgr->RegisterEventListener([&](const gaf::EventID evt, void*) { countFn(callsAllA, callsAllB, evt); });
+	for (uint32 i = 0; i < numDispatches; ++i)
+	{
+		eventMgr->DispatchEvent(routeA, nullptr);
+		eventMgr->DispatchEvent(routeB, nullptr);
+	}
+	waitCount(callsA, numDispatches);
+	waitCount(callsAllA, numDispatches);
+	waitCount(callsAllB, numDispatches);
+	gaf::Assertion::WhenInequal(callsB.load(), 0U, "A listener was called for an event it doesn't listen to, while performing a test.");
+	DOTEST_END();
+
+	/* Moving the listener from one event to the other moves it between their rows */
+	DOTEST_BEGIN("EventRoutingChange");
+	eventMgr->AddEventToListener(listener, routeB);
+	eventMgr->RemoveEventFromListener(listener, routeA);
+	eventMgr->DispatchEvent(routeA, nullptr);
+	eventMgr->DispatchEvent(routeB, nullptr);
+	waitCount(callsB, 1);
+	waitCount(callsAllA, numDispatches + 1);
+	waitCount(callsAllB, numDispatches + 1);
+	gaf::Assertion::WhenInequal(callsA.load(), numDispatches, "A listener was called for an event removed from it, while performing a test.");
+	eventMgr->UnregisterEventListener(listener);
+	eventMgr->UnregisterEventListener(allListener);
+	eventMgr->DispatchEvent(routeB, nullptr);
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	gaf::Assertion::WhenInequal(callsB.load(), 1U, "An unregistered listener was called, while performing a test.");
+	gaf::Assertion::WhenInequal(callsAllB.load(), numDispatches + 1, "An unregistered listener of every event was called, while performing a test.");
+	DOTEST_END();
+
+	/* The dispatch works on a snapshot, listeners added or removed from a listener apply from the next one */
+	callsA.store(0);
+	callsB.store(0);
+	DOTEST_BEGIN("EventListenerChangeInDispatch");
+	std::atomic<uint32> changes(0);
+	gaf::EventListenerID selfListener = gaf::EventManager::NullEventListenerID, addedListener = gaf::EventManager::NullEventListenerID;
+	selfListener = eventMgr->RegisterEventListener([&](const gaf::EventID, void*)
+	{
+		++callsA;
+		eventMgr->UnregisterEventListener(selfListener);
+		addedListener = eventMgr->RegisterEventListener([&callsB](const gaf::EventID, void*) { ++callsB; }, routeA);
+		++changes;
+	}, routeA);
+	eventMgr->DispatchEvent(routeA, nullptr);
+	waitCount(changes, 1);
+	gaf::Assertion::WhenInequal(callsB.load(), 0U, "A listener registered during a dispatch was called by it, while performing a test.");
+	eventMgr->DispatchEvent(routeA, nullptr);
+	waitCount(callsB, 1);
+	gaf::Assertion::WhenInequal(callsA.load(), 1U, "A listener that unregistered itself was called again, while performing a test.");
+	eventMgr->UnregisterEventListener(addedListener);
+	DOTEST_END();
+
+	/* Registrations never block the dispatches, nor make them miss a listener that stays */
+	callsA.store(0);
+	DOTEST_BEGIN("EventListenerChurn");
+	listener = eventMgr->RegisterEventListener([&callsA](const gaf::EventID, void*) { ++callsA; }, routeA);
+	std::thread dispatcher([eventMgr, routeA]()
+	{
+		for (uint32 i = 0; i < numDispatches * 100; ++i)
+			eventMgr->DispatchEvent(routeA, nullptr);
+	});
+	for (uint32 i = 0; i < numDispatches * 10; ++i)
+		eventMgr->UnregisterEventListener(eventMgr->RegisterEventListener([](const gaf::EventID, void*) {}, routeA));
+	dispatcher.join();
+	waitCount(callsA, numDispatches * 100);
+	eventMgr->UnregisterEventListener(listener);
+	DOTEST_END();
+
+	/* The params of the buffered dispatches live in the test until the listeners are done */
+	const auto immediateEvent = eventMgr->RegisterEvent("TestModeImmediate", gaf::EEventDispatch::IMMEDIATE),
+		frameEvent = eventMgr->RegisterEvent("TestModeFrame", gaf::EEventDispatch::FRAME),
+		coalescedEvent = eventMgr->RegisterEvent("TestModeCoalesced", gaf::EEventDispatch::COALESCED);
+	std::vector<uint32> values(numDispatches);
+	std::atomic<uint32> calls(0);
+	std::atomic<void*> lastParams(nullptr);
+	gaf::Assertion::WhenInequal(eventMgr->GetEventDispatch(routeA), gaf::EEventDispatch::ASYNC, "An event didn't get the default dispatch mode, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventDispatch(immediateEvent), gaf::EEventDispatch::IMMEDIATE, "An event didn't keep its dispatch mode, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventDispatch(frameEvent), gaf::EEventDispatch::FRAME, "An event didn't keep its dispatch mode, while performing a test.");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventDispatch(coalescedEvent), gaf::EEventDispatch::COALESCED, "An event didn't keep its dispatch mode, while performing a test.");
+	listener = eventMgr->RegisterEventListener([&calls, &lastParams](const gaf::EventID, void* params)
+	{
+		lastParams = params;
+		++calls;
+	}, { immediateEvent, frameEvent, coalescedEvent });
+
+	/* IMMEDIATE listeners are done once DispatchEvent returns */
+	DOTEST_BEGIN("EventDispatchImmediate");
+	for (uint32 i = 0; i < numDispatches; ++i)
+		eventMgr->DispatchEvent(immediateEvent, &values[i]);
+	gaf::Assertion::WhenInequal(calls.load(), numDispatches, "An IMMEDIATE event returned before its listeners were done, while performing a test.");
+	DOTEST_END();
+
+	calls.store(0);
+	DOTEST_BEGIN("EventDispatchFrame");
+	for (uint32 i = 0; i < numDispatches; ++i)
+		eventMgr->DispatchEvent(frameEvent, &values[i]);
+	gaf::Assertion::WhenInequal(calls.load(), 0U, "A FRAME event was sent before FlushEvents, while performing a test.");
+	eventMgr->FlushEvents();
+	waitCount(calls, numDispatches);
+	DOTEST_END();
+
+	/* Every dispatch between flushes collapses into the last one */
+	calls.store(0);
+	DOTEST_BEGIN("EventDispatchCoalesced");
+	for (uint32 i = 0; i < numDispatches; ++i)
+		eventMgr->DispatchEvent(coalescedEvent, &values[i]);
+	gaf::Assertion::WhenInequal(calls.load(), 0U, "A COALESCED event was sent before FlushEvents, while performing a test.");
+	eventMgr->FlushEvents();
+	waitCount(calls, 1);
+	DOTEST_END();
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	gaf::Assertion::WhenInequal(calls.load(), 1U, "The dispatches of a COALESCED event weren't collapsed, while performing a test.");
+	gaf::Assertion::WhenInequal(lastParams.load(), static_cast<void*>(&values.back()), "A COALESCED event didn't keep the params of the last dispatch, while performing a test.");
+	eventMgr->UnregisterEventListener(listener);
+	eventMgr->UnregisterEvent(immediateEvent);
+	eventMgr->UnregisterEvent(frameEvent);
+	eventMgr->UnregisterEvent(coalescedEvent);
+
+	/* The payloads are sent from a scope that ends before the listeners run, so they must be owned copies */
+	const auto typedEvent = eventMgr->RegisterEvent<TestEventPayload>("TestTypedEvent", gaf::EEventDispatch::FRAME);
+	const auto bigEvent = eventMgr->RegisterEvent<TestBigEventPayload>("TestBigTypedEvent");
+	gaf::Assertion::WhenInequal(eventMgr->GetEventID<TestEventPayload>(), typedEvent, "A payload type didn't map to the EventID it was registered with, while performing a test.");
+	const auto tracker = std::make_shared<uint32>(0);
+	std::atomic<uint64> received(0), receivedAll(0);
+	std::atomic<uint32> callsAll(0);
+	calls.store(0);
+	listener = eventMgr->RegisterEventListener<TestEventPayload>([&calls, &received](const TestEventPayload& payload)
+	{
+		if (payload.Text == "TestPayload" + std::to_string(payload.Value))
+			received += payload.Value;
+		++calls;
+	});
+	allListener = eventMgr->RegisterEventListener<TestBigEventPayload>([&calls, &received](const TestBigEventPayload& payload)
+	{
+		for (const auto val : payload.Values)
+			received += val;
+		++calls;
+	});
+
+	/* Listeners of all events tell the payload type by the EventID */
+	const auto anyListener = eventMgr->RegisterEventListener([&](const gaf::EventID evt, void* params)
+	{
+		if (evt != eventMgr->GetEventID<TestEventPayload>())
+			return;
+		receivedAll += static_cast<const TestEventPayload*>(params)->Value;
+		++callsAll;
+	});
+
+	DOTEST_BEGIN("EventTypedPayload");
+	uint64 expected = 0;
+	for (uint32 i = 0; i < numDispatches; ++i)
+	{
+		eventMgr->Dispatch(TestEventPayload{ "TestPayload" + std::to_string(i), i, tracker });
+		expected += i;
+	}
+	eventMgr->FlushEvents();
+	waitCount(calls, numDispatches);
+	waitCount(callsAll, numDispatches);
+	gaf::Assertion::WhenInequal(received.load(), expected, "A typed payload didn't reach its listener intact, while performing a test.");
+	gaf::Assertion::WhenInequal(receivedAll.load(), expected, "A typed payload didn't reach a listener of all events intact, while performing a test.");
+	DOTEST_END();
+
+	calls.store(0);
+	received.store(0);
+	DOTEST_BEGIN("EventBigTypedPayload");
+	{
+		TestBigEventPayload payload;
+		for (SIZET i = 0; i < payload.Values.size(); ++i)
+			payload.Values[i] = i + 1;
+		eventMgr->Dispatch(payload);
+	}
+	waitCount(calls, 1);
+	gaf::Assertion::WhenInequal(received.load(), (uint64)(16 * 17 / 2), "A typed payload stored out of its record didn't reach its listener intact, while performing a test.");
+	DOTEST_END();
+
+	/* The records are released once every listener call is done */
+	while (tracker.use_count() > 1)
+		std::this_thread::yield();
+	eventMgr->UnregisterEventListener(listener);
+	eventMgr->UnregisterEventListener(allListener);
+	eventMgr->UnregisterEventListener(anyListener);
+	eventMgr->UnregisterEvent(typedEvent);
+	eventMgr->UnregisterEvent(bigEvent);
+	eventMgr->UnregisterEvent(routeA);
+	eventMgr->UnregisterEvent(routeB);
 }
 
 void GAFTest::PropertyTest(ResultVec & resultVec)
@@ -709,3 +1023,1389 @@ void GAFTest::InputTest(ResultVec & resultVec)
 
 	wnd->Close();
 }
+
+CreateTaskName(TaskObjectTestTask);
+
+/* Records where it's stored when called, Size pads it to choose the inline or the pooled storage */
+template<SIZET Size>
+struct TaskStorageProbe
+{
+	const void** Where;
+	std::shared_ptr<uint32> Tracker;
+	std::array<uint8, Size> Padding;
+
+	void operator()()
+	{
+		*Where = this;
+		++*Tracker;
+	}
+};
+
+void GAFTest::TaskObjectTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	const auto tracker = std::make_shared<uint32>(0);
+	const void* where = nullptr;
+	const TaskStorageProbe<8> inlineProbe{ &where, tracker, {} };
+	const TaskStorageProbe<2 * gaf::Task_t::InlineSize> pooledProbe{ &where, tracker, {} };
+	const auto isInside = [&where](const gaf::Task_t& task)
+	{
+		const auto begin = reinterpret_cast<const uint8*>(&task);
+		const auto ptr = static_cast<const uint8*>(where);
+		return ptr >= begin && ptr < begin + sizeof(gaf::Task_t);
+	};
+	PRETEST_END();
+
+	/* Small callables move along with the task */
+	DOTEST_BEGIN("TaskInlineStorage");
+	auto task = CreateTask(TaskObjectTestTask, inlineProbe);
+	gaf::Task_t moved(std::move(task));
+	gaf::Assertion::WhenTrue((bool)task, "A moved from task still holds its callable, while performing a test.");
+	gaf::Assertion::WhenTrue(!moved, "A moved to task doesn't hold the callable, while performing a test.");
+	moved();
+	gaf::Assertion::WhenTrue(!isInside(moved), "A small callable wasn't stored inside its task, while performing a test.");
+	DOTEST_END();
+
+	/* Big callables stay in their TaskPool block */
+	DOTEST_BEGIN("TaskPooledStorage");
+	auto task = CreateTask(TaskObjectTestTask, pooledProbe);
+	gaf::Task_t moved;
+	moved = std::move(task);
+	gaf::Assertion::WhenTrue((bool)task, "A moved from task still holds its callable, while performing a test.");
+	moved();
+	gaf::Assertion::WhenTrue(isInside(moved) || isInside(task), "A big callable was stored inside its task, while performing a test.");
+	DOTEST_END();
+	gaf::Assertion::WhenInequal(*tracker, 2U, "A task didn't run its callable once, while performing a test.");
+
+	/* The captures are destroyed with the task, whether it ran or not, and when it's replaced */
+	DOTEST_BEGIN("TaskCaptureDestruction");
+	/* The probes hold references too */
+	const auto numRefs = tracker.use_count();
+	{
+		auto inlineTask = CreateTask(TaskObjectTestTask, inlineProbe);
+		auto pooledTask = CreateTask(TaskObjectTestTask, pooledProbe);
+		gaf::Task_t moved(std::move(pooledTask));
+		gaf::Assertion::WhenInequal(tracker.use_count(), numRefs + 2, "Moving a task copied its captures, while performing a test.");
+		moved = std::move(inlineTask);
+		gaf::Assertion::WhenInequal(tracker.use_count(), numRefs + 1, "Assigning a task didn't destroy the captures it had, while performing a test.");
+	}
+	gaf::Assertion::WhenInequal(tracker.use_count(), numRefs, "A task didn't destroy its captures, while performing a test.");
+	DOTEST_END();
+	gaf::Assertion::WhenInequal(*tracker, 2U, "A destroyed task ran its callable, while performing a test.");
+}
+
+void GAFTest::WorkStealingTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numValues = 200000;
+	constexpr SIZET numThieves = 3;
+	/* Small enough to grow several times while the thieves are stealing */
+	gaf::WorkStealingQueue<SIZET> queue(64);
+	std::vector<std::atomic<uint32>> taken(numValues);
+	std::atomic<SIZET> numTaken(0);
+	std::atomic_bool pushing(true);
+	const auto takeFn = [&taken, &numTaken](const SIZET value)
+	{
+		++taken[value];
+		++numTaken;
+	};
+	PRETEST_END();
+
+	/* The owner pops every third push while the thieves steal from the other end */
+	DOTEST_BEGIN("WorkStealingConcurrentThieves");
+	std::vector<std::thread> thieves;
+	for (SIZET i = 0; i < numThieves; ++i)
+	{
+		thieves.emplace_back([&queue, &pushing, &takeFn]()
+		{
+			SIZET value;
+			while (pushing.load() || !queue.Empty())
+			{
+				if (queue.Steal(value))
+					takeFn(value);
+			}
+		});
+	}
+	SIZET value;
+	for (SIZET i = 0; i < numValues; ++i)
+	{
+		queue.Push(i);
+		if (i % 3 == 2 && queue.Pop(value))
+			takeFn(value);
+	}
+	while (queue.Pop(value))
+		takeFn(value);
+	pushing = false;
+	for (auto& thief : thieves)
+		thief.join();
+	DOTEST_END();
+	gaf::Assertion::WhenInequal(numTaken.load(), numValues, "A WorkStealingQueue lost or duplicated values, while performing a test.");
+	for (SIZET i = 0; i < numValues; ++i)
+		gaf::Assertion::WhenInequal(taken[i].load(), 1U, "A WorkStealingQueue value wasn't taken exactly once, while performing a test.");
+}
+
+void GAFTest::TaskTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numHandlers = 4;
+	constexpr SIZET numRounds = 50;
+	/* Long enough to find a lost wake-up, a woken TaskHandler takes microseconds */
+	constexpr auto wakeUpTimeout = std::chrono::seconds(1);
+	const auto waitFor = [wakeUpTimeout](const std::atomic<SIZET>& count, const SIZET expected)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + wakeUpTimeout;
+		while (count.load() < expected && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::yield();
+		return count.load() >= expected;
+	};
+	PRETEST_END();
+
+	/* Every task is sent once the TaskHandlers had time to park, so each one needs a wake-up */
+	DOTEST_BEGIN("TaskParkWakeUp");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(numHandlers, numHandlers);
+	manager.SetNumberTaskHandlers(numHandlers);
+	std::atomic<SIZET> done(0);
+	const auto countFn = [&done]() { ++done; };
+	for (SIZET i = 0; i < numRounds; ++i)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		manager.SendTask(CreateTask(ParkTestTask, countFn));
+		gaf::Assertion::WhenTrue(!waitFor(done, i + 1), "A task sent to parked TaskHandlers never ran, while performing a test.");
+	}
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	DOTEST_END();
+
+	/*
+		Every task of the burst holds its TaskHandler until all of them
+		started, so each parked TaskHandler must be woken to run one.
+	*/
+	DOTEST_BEGIN("TaskParkWakeUpAll");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(numHandlers, numHandlers);
+	manager.SetNumberTaskHandlers(numHandlers);
+	std::atomic<SIZET> started(0), done(0);
+	const auto barrierFn = [&started, &done, &waitFor]()
+	{
+		++started;
+		if (waitFor(started, numHandlers))
+			++done;
+	};
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	for (SIZET i = 0; i < numHandlers; ++i)
+		manager.SendTask(CreateTask(ParkTestTask, barrierFn));
+	/* The caller doesn't help, so only the TaskHandlers can run the burst */
+	const auto allStarted = waitFor(started, numHandlers);
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	gaf::Assertion::WhenTrue(!allStarted, "A burst of tasks sent to parked TaskHandlers never ran, while performing a test.");
+	gaf::Assertion::WhenInequal(done.load(), numHandlers, "A parked TaskHandler wasn't woken for a burst of tasks, while performing a test.");
+	DOTEST_END();
+
+	/*
+		A TaskManager of its own whose only TaskHandler is held by a task, so
+		the shared queue fills up with cancelled tasks and the rest overflow
+		into the caller, which must skip the cancelled ones like the pool does.
+	*/
+	DOTEST_BEGIN("TaskQueueOverflow");
+	constexpr SIZET numOverflow = 2 * GREAPER_TASKMAN_QUEUE_CAPACITY + 100;
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(1, 1);
+	manager.SetNumberTaskHandlers(1);
+	std::atomic_bool started(false), release(false);
+	const auto blockerFn = [&started, &release]()
+	{
+		started = true;
+		while (!release.load())
+			std::this_thread::yield();
+	};
+	manager.SendTask(CreateTask(OverflowTestTask, blockerFn));
+	while (!started.load())
+		std::this_thread::yield();
+	auto token = gaf::CancellationToken::Create();
+	token.Cancel();
+	const auto callerID = std::this_thread::get_id();
+	std::atomic<SIZET> executed(0), inlineRuns(0);
+	const auto countFn = [&executed, &inlineRuns, callerID]()
+	{
+		++executed;
+		if (std::this_thread::get_id() == callerID)
+			++inlineRuns;
+	};
+	for (SIZET i = 0; i < numOverflow; ++i)
+	{
+		auto task = CreateTask(OverflowTestTask, countFn);
+		task.SetCancellationToken(token);
+		manager.SendTask(std::move(task));
+	}
+	gaf::Assertion::WhenInequal(executed.load(), (SIZET)0, "A cancelled task that overflowed the queue was executed, while performing a test.");
+	for (SIZET i = 0; i < numOverflow; ++i)
+		manager.SendTask(CreateTask(OverflowTestTask, countFn));
+	release = true;
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	gaf::Assertion::WhenInequal(executed.load(), numOverflow, "A task sent to a full queue was lost, while performing a test.");
+	if (GREAPER_TASKMAN_QUEUE_CAPACITY != 0)
+		gaf::Assertion::WhenInequal(inlineRuns.load(), numOverflow, "A task sent to a full queue wasn't run by the caller, while performing a test.");
+	DOTEST_END();
+
+	/*
+		A batch of mixed priorities sent while the only TaskHandler is held,
+		the queues fill up and the caller runs the rest. Then the same
+		batch is sent by a TaskHandler, which keeps it in its local queues.
+	*/
+	constexpr SIZET numBatch = 2 * GREAPER_TASKMAN_QUEUE_CAPACITY + 100;
+	constexpr SIZET priorityRun = 100;
+	std::vector<std::atomic<uint32>> runs(numBatch);
+	std::atomic<SIZET> callerRuns(0);
+	const auto makeBatch = [&runs, &callerRuns, callerID = std::this_thread::get_id()]()
+	{
+		std::vector<gaf::Task_t> batch;
+		batch.reserve(numBatch);
+		for (SIZET i = 0; i < numBatch; ++i)
+		{
+			const auto runFn = [&runs, &callerRuns, callerID, i]()
+			{
+				++runs[i];
+				if (std::this_thread::get_id() == callerID)
+					++callerRuns;
+			};
+			batch.push_back(CreateTask(BatchTestTask, runFn));
+			batch.back().SetPriority((i / priorityRun) % 2 == 0 ? gaf::ETaskPriority::NORMAL : gaf::ETaskPriority::HIGH);
+		}
+		return batch;
+	};
+	const auto checkRuns = [&runs](const uint32 expected)
+	{
+		for (const auto& count : runs)
+			gaf::Assertion::WhenInequal(count.load(), expected, "A task of a batch didn't run exactly once, while performing a test.");
+	};
+
+	DOTEST_BEGIN("TaskBatchOverflow");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(1, 1);
+	manager.SetNumberTaskHandlers(1);
+	std::atomic_bool started(false), release(false);
+	const auto blockerFn = [&started, &release]()
+	{
+		started = true;
+		while (!release.load())
+			std::this_thread::yield();
+	};
+	manager.SendTask(CreateTask(BatchTestTask, blockerFn));
+	while (!started.load())
+		std::this_thread::yield();
+	auto batch = makeBatch();
+	manager.SendTasks(batch);
+	release = true;
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	checkRuns(1);
+	if (GREAPER_TASKMAN_QUEUE_CAPACITY != 0)
+		gaf::Assertion::WhenEqual(callerRuns.load(), (SIZET)0, "A batch bigger than the queues didn't overflow into the caller, while performing a test.");
+	DOTEST_END();
+
+	DOTEST_BEGIN("TaskBatchLocal");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(2, 2);
+	manager.SetNumberTaskHandlers(2);
+	const auto senderFn = [&manager, &makeBatch]()
+	{
+		auto batch = makeBatch();
+		manager.SendTasks(batch);
+	};
+	manager.SendTask(CreateTask(BatchTestTask, senderFn));
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	checkRuns(2);
+	DOTEST_END();
+
+	/* Every placement pins the running TaskHandlers to cores of the topology, NONE unpins them */
+	DOTEST_BEGIN("TaskPlacement");
+	constexpr SIZET numHandlers = 2;
+	constexpr SIZET numPlaced = 64;
+	const auto& topology = gaf::InstanceHW()->GetCoreTopology();
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(numHandlers, numHandlers);
+	manager.SetNumberTaskHandlers(numHandlers);
+	for (const auto placement : { gaf::ETaskPlacement::LOGICAL_CORES, gaf::ETaskPlacement::PHYSICAL_CORES, gaf::ETaskPlacement::NONE })
+	{
+		manager.SetTaskPlacement(placement);
+		gaf::Assertion::WhenInequal(manager.GetTaskPlacement(), placement, "The TaskManager didn't keep its placement, while performing a test.");
+		std::atomic<SIZET> done(0), misplaced(0);
+		const auto coreFn = [&done, &misplaced, &topology, placement]()
+		{
+			const auto core = gaf::TaskHandler::GetCurrent()->GetCore();
+			const auto inTopology = std::any_of(topology.begin(), topology.end(), [core](const gaf::LogicalCoreInfo& info) { return (int32)info.Index == core; });
+			if ((placement == gaf::ETaskPlacement::NONE || topology.empty()) ? core != -1 : !inTopology)
+				++misplaced;
+			++done;
+		};
+		for (SIZET i = 0; i < numPlaced; ++i)
+			manager.SendTask(CreateTask(PlacementTestTask, coreFn));
+		while (done.load() < numPlaced)
+			std::this_thread::yield();
+		gaf::Assertion::WhenInequal(misplaced.load(), (SIZET)0, "A TaskHandler wasn't pinned as its placement says, while performing a test.");
+	}
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	DOTEST_END();
+
+	/* The controller adds a TaskHandler while the backlog doesn't drain, and retires it once the pool stays idle */
+	DOTEST_BEGIN("TaskPoolGrowShrink");
+	constexpr SIZET numBlocked = 32;
+	/* Retiring takes ShrinkSamples controller intervals, the margin covers loaded machines */
+	constexpr auto resizeTimeout = std::chrono::seconds(10);
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(1, 2);
+	manager.SetNumberTaskHandlers(1);
+	std::atomic_bool release(false);
+	std::atomic<SIZET> done(0);
+	const auto blockedFn = [&release, &done]()
+	{
+		while (!release.load())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++done;
+	};
+	const auto waitHandlers = [&manager, resizeTimeout](const SIZET expected)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + resizeTimeout;
+		while (manager.GetNumberTaskHandlers() != expected && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		return manager.GetNumberTaskHandlers() == expected;
+	};
+	for (SIZET i = 0; i < numBlocked; ++i)
+		manager.SendTask(CreateTask(PoolTestTask, blockedFn));
+	const auto grew = waitHandlers(2);
+	release = true;
+	while (done.load() < numBlocked)
+		std::this_thread::yield();
+	const auto shrank = waitHandlers(1);
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	gaf::Assertion::WhenTrue(!grew, "The pool didn't grow while its backlog wasn't draining, while performing a test.");
+	gaf::Assertion::WhenTrue(!shrank, "The pool didn't shrink while it was idle, while performing a test.");
+	DOTEST_END();
+}
+
+CreateTaskName(StatsTestTask);
+
+void GAFTest::StatsTest(ResultVec& resultVec)
+{
+#if GREAPER_TASKMAN_STATS
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 100;
+	constexpr auto taskLength = std::chrono::microseconds(200);
+	const auto busyFn = [taskLength]()
+	{
+		const auto end = std::chrono::steady_clock::now() + taskLength;
+		while (std::chrono::steady_clock::now() < end);
+	};
+	PRETEST_END();
+
+	/* Every value falls in the bucket that starts at or below it */
+	DOTEST_BEGIN("TaskHistogramBuckets");
+	for (const uint64 ticks : { 0ULL, 1ULL, 7ULL, 8ULL, 9ULL, 1000ULL, 123456789ULL })
+	{
+		const auto bucket = gaf::TaskHistogram::GetBucket(ticks);
+		const auto lowest = gaf::TaskHistogram::GetBucketValue(bucket);
+		gaf::Assertion::WhenTrue(ticks < lowest || ticks >= lowest + gaf::TaskHistogram::GetBucketWidth(bucket),
+			"A TaskHistogram value went into the wrong bucket, while performing a test.");
+	}
+	DOTEST_END();
+
+	/* The shutdown joins the TaskHandlers, so every task was recorded afterwards */
+	DOTEST_BEGIN("TaskStatsCounters");
+	gaf::TaskStats::Reset();
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(2, 2);
+	manager.SetNumberTaskHandlers(2);
+	for (SIZET i = 0; i < numTasks; ++i)
+		manager.SendTask(CreateTask(StatsTestTask, busyFn));
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	const auto stats = gaf::TaskStats::Snapshot();
+	const auto it = std::find_if(stats.begin(), stats.end(), [](const gaf::TaskStatsEntry& entry) { return entry.Name == StatsTestTask_Name; });
+	gaf::Assertion::WhenTrue(it == stats.end(), "The stats of a task name are missing, while performing a test.");
+	gaf::Assertion::WhenInequal(it->ExecutionTime.GetCount(), (uint64)numTasks, "The stats didn't count every executed task, while performing a test.");
+	gaf::Assertion::WhenInequal(it->WaitTime.GetCount(), (uint64)numTasks, "The stats didn't count the wait of every sent task, while performing a test.");
+	/* The histogram precision is 1/SubBuckets, and the clocks may differ a bit */
+	const auto minLength = 0.5 * std::chrono::duration<double, std::nano>(taskLength).count();
+	gaf::Assertion::WhenTrue(it->ExecutionTime.GetMean() < minLength, "The stats measured tasks shorter than they were, while performing a test.");
+	gaf::Assertion::WhenTrue(it->ExecutionTime.GetPercentile(50.0) > it->ExecutionTime.GetMax(), "The stats median is over their maximum, while performing a test.");
+	DOTEST_END();
+#endif
+}
+
+#if GREAPER_TASKMAN_TRACE
+CreateTaskName(TraceTestTask);
+
+/* Minimal JSON syntax check, enough to tell whether a viewer can load the trace */
+static bool ParseJSONValue(const std::string& text, SIZET& pos);
+
+static void SkipJSONSpaces(const std::string& text, SIZET& pos)
+{
+	while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+		++pos;
+}
+
+static bool ParseJSONString(const std::string& text, SIZET& pos)
+{
+	if (pos >= text.size() || text[pos] != '"')
+		return false;
+	for (++pos; pos < text.size(); ++pos)
+	{
+		const auto c = static_cast<uint8>(text[pos]);
+		if (c == '"')
+		{
+			++pos;
+			return true;
+		}
+		if (c < 0x20)
+			return false;
+		if (c != '\\')
+			continue;
+		if (++pos >= text.size())
+			return false;
+		if (text[pos] == 'u')
+		{
+			for (SIZET i = 0; i < 4; ++i)
+			{
+				if (++pos >= text.size() || !isxdigit(static_cast<uint8>(text[pos])))
+					return false;
+			}
+		}
+		else if (strchr("\"\\/bfnrt", text[pos]) == nullptr)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool ParseJSONNumber(const std::string& text, SIZET& pos)
+{
+	const auto digits = [&text, &pos]()
+	{
+		const auto begin = pos;
+		while (pos < text.size() && isdigit(static_cast<uint8>(text[pos])))
+			++pos;
+		return pos > begin;
+	};
+	if (pos < text.size() && text[pos] == '-')
+		++pos;
+	if (!digits())
+		return false;
+	if (pos < text.size() && text[pos] == '.')
+	{
+		++pos;
+		if (!digits())
+			return false;
+	}
+	if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E'))
+	{
+		++pos;
+		if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+			++pos;
+		if (!digits())
+			return false;
+	}
+	return true;
+}
+
+/* Objects and arrays, close is the character that ends them */
+static bool ParseJSONContainer(const std::string& text, SIZET& pos, const ANSICHAR close)
+{
+	++pos;
+	SkipJSONSpaces(text, pos);
+	if (pos < text.size() && text[pos] == close)
+	{
+		++pos;
+		return true;
+	}
+	while (pos < text.size())
+	{
+		if (close == '}')
+		{
+			SkipJSONSpaces(text, pos);
+			if (!ParseJSONString(text, pos))
+				return false;
+			SkipJSONSpaces(text, pos);
+			if (pos >= text.size() || text[pos++] != ':')
+				return false;
+		}
+		if (!ParseJSONValue(text, pos))
+			return false;
+		SkipJSONSpaces(text, pos);
+		if (pos >= text.size())
+			return false;
+		const auto c = text[pos++];
+		if (c == close)
+			return true;
+		if (c != ',')
+			return false;
+	}
+	return false;
+}
+
+static bool ParseJSONValue(const std::string& text, SIZET& pos)
+{
+	SkipJSONSpaces(text, pos);
+	if (pos >= text.size())
+		return false;
+	switch (text[pos])
+	{
+	case '{':
+		return ParseJSONContainer(text, pos, '}');
+	case '[':
+		return ParseJSONContainer(text, pos, ']');
+	case '"':
+		return ParseJSONString(text, pos);
+	default:
+		break;
+	}
+	for (const auto literal : { "true", "false", "null" })
+	{
+		if (text.compare(pos, strlen(literal), literal) == 0)
+		{
+			pos += strlen(literal);
+			return true;
+		}
+	}
+	return ParseJSONNumber(text, pos);
+}
+
+static bool IsWellFormedJSON(const std::string& text)
+{
+	SIZET pos = 0;
+	if (!ParseJSONValue(text, pos))
+		return false;
+	SkipJSONSpaces(text, pos);
+	return pos == text.size();
+}
+
+static SIZET CountOccurrences(const std::string& text, const std::string& pattern)
+{
+	SIZET count = 0;
+	for (auto pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + pattern.size()))
+		++count;
+	return count;
+}
+#endif
+
+void GAFTest::TraceTest(ResultVec& resultVec)
+{
+#if GREAPER_TASKMAN_TRACE
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 50;
+	const auto zoneFn = []()
+	{
+		GAF_TRACE_SCOPE("TraceTestZone");
+		/* The name must be escaped on the JSON */
+		GAF_TRACE_SCOPE("TraceTest\"Quoted\\Zone");
+	};
+	PRETEST_END();
+
+	DOTEST_BEGIN("TaskTraceChromeJSON");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(2, 2);
+	manager.SetNumberTaskHandlers(2);
+	gaf::TaskTrace::Start();
+	for (SIZET i = 0; i < numTasks; ++i)
+		manager.SendTask(CreateTask(TraceTestTask, zoneFn));
+	/* The TaskHandlers are joined, so every event was recorded */
+	manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	gaf::TaskTrace::Stop();
+	const auto json = gaf::TaskTrace::ToChromeJSON();
+	gaf::Assertion::WhenTrue(!IsWellFormedJSON(json), "The Chrome trace isn't well-formed JSON, while performing a test.");
+	gaf::Assertion::WhenInequal(CountOccurrences(json, "\"name\":\"TraceTestTask\",\"cat\":\"task\""), numTasks, "The Chrome trace is missing executed tasks, while performing a test.");
+	gaf::Assertion::WhenInequal(CountOccurrences(json, "\"name\":\"TraceTestZone\",\"cat\":\"zone\""), numTasks, "The Chrome trace is missing zones, while performing a test.");
+	gaf::Assertion::WhenInequal(CountOccurrences(json, "\"name\":\"TraceTest\\\"Quoted\\\\Zone\",\"cat\":\"zone\""), numTasks, "The Chrome trace didn't escape a zone name, while performing a test.");
+	DOTEST_END();
+#endif
+}
+
+CreateTaskName(TaskGraphTestTask);
+
+void GAFTest::TaskGraphTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numLayers = 8;
+	constexpr SIZET layerWidth = 16;
+	const auto app = gaf::InstanceApp();
+	std::array<std::atomic<SIZET>, numLayers> layerDone = {};
+	std::atomic_bool outOfOrder(false);
+	std::atomic<SIZET> executed(0);
+	const auto countFn = [&executed]() { ++executed; };
+	const auto throwFn = []() { throw std::runtime_error("TaskGraphTest exception"); };
+	PRETEST_END();
+
+	/* Every node of a layer depends on every node of the previous one */
+	DOTEST_BEGIN("TaskGraphOrder");
+	gaf::TaskGraph graph(app);
+	std::vector<gaf::TaskGraph::NodeID> prevLayer, layer;
+	for (SIZET l = 0; l < numLayers; ++l)
+	{
+		layer.clear();
+		for (SIZET i = 0; i < layerWidth; ++i)
+		{
+			const auto nodeFn = [&layerDone, &outOfOrder, l]()
+			{
+				if (l > 0 && layerDone[l - 1].load() != layerWidth)
+					outOfOrder = true;
+				++layerDone[l];
+			};
+			const auto node = graph.AddTask(CreateTask(TaskGraphTestTask, nodeFn));
+			for (const auto prev : prevLayer)
+				graph.AddDependency(prev, node);
+			layer.push_back(node);
+		}
+		std::swap(prevLayer, layer);
+	}
+	graph.Run();
+	graph.Wait();
+	gaf::Assertion::WhenTrue(outOfOrder.load(), "A TaskGraph node ran before its predecessors, while performing a test.");
+	gaf::Assertion::WhenInequal(layerDone[numLayers - 1].load(), layerWidth, "A TaskGraph didn't run every node, while performing a test.");
+	gaf::Assertion::WhenTrue(graph.WasCancelled(), "A TaskGraph without discarded nodes was cancelled, while performing a test.");
+	DOTEST_END();
+
+	/* The node that throws stops the graph, the exception reaches Wait */
+	DOTEST_BEGIN("TaskGraphException");
+	gaf::TaskGraph graph(app);
+	const auto thrower = graph.AddTask(CreateTask(TaskGraphTestTask, throwFn));
+	graph.AddTask(CreateTask(TaskGraphTestTask, countFn), { thrower });
+	graph.Run();
+	bool caught = false;
+	try
+	{
+		graph.Wait();
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	gaf::Assertion::WhenTrue(!caught, "TaskGraph::Wait didn't rethrow the exception of a node, while performing a test.");
+	gaf::Assertion::WhenInequal(executed.load(), (SIZET)0, "A TaskGraph node ran after its predecessor threw, while performing a test.");
+	gaf::Assertion::WhenTrue(!graph.WasCancelled(), "A TaskGraph whose node threw wasn't cancelled, while performing a test.");
+	DOTEST_END();
+
+	/* A node discarded by its token cancels its successors */
+	DOTEST_BEGIN("TaskGraphDiscarded");
+	gaf::TaskGraph graph(app);
+	auto token = gaf::CancellationToken::Create();
+	token.Cancel();
+	auto discardedTask = CreateTask(TaskGraphTestTask, countFn);
+	discardedTask.SetCancellationToken(token);
+	const auto discarded = graph.AddTask(std::move(discardedTask));
+	graph.AddTask(CreateTask(TaskGraphTestTask, countFn), { discarded });
+	graph.Run();
+	graph.Wait();
+	gaf::Assertion::WhenInequal(executed.load(), (SIZET)0, "A TaskGraph node with a cancelled token was executed, while performing a test.");
+	gaf::Assertion::WhenTrue(!graph.WasCancelled(), "A TaskGraph with a discarded node wasn't cancelled, while performing a test.");
+	DOTEST_END();
+}
+
+CreateTaskName(DispatcherTestTask);
+
+/* Exposes the sending functions, which are only available to the dispatcher subclasses */
+class TestDispatcher : public gaf::TaskDispatcher
+{
+public:
+	explicit TestDispatcher(gaf::TaskManager* manager)
+		:TaskDispatcher("TestDispatcher", manager)
+	{
+
+	}
+	using TaskDispatcher::SendTask;
+	using TaskDispatcher::SendTasks;
+	using TaskDispatcher::SendKeyedTask;
+};
+
+void GAFTest::DispatcherTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr uint32 numHandlers = 4;
+	constexpr SIZET numKeys = 64;
+	constexpr SIZET tasksPerKey = 200;
+	const auto app = gaf::InstanceApp();
+	TestDispatcher dispatcher(app);
+	app->RegisterTaskDispatcher(&dispatcher, 1, "gaf-test");
+	/* Next sequence number expected by every key, and the handler that ran its last task */
+	std::vector<std::atomic<SIZET>> nextSeq(numKeys);
+	std::vector<std::atomic<const gaf::TaskHandler*>> keyHandler(numKeys);
+	std::atomic_bool outOfOrder(false);
+	std::atomic<SIZET> done(0);
+	const auto sendKeyed = [&](const SIZET key, const SIZET seq)
+	{
+		const auto keyedFn = [&nextSeq, &keyHandler, &outOfOrder, &done, key, seq]()
+		{
+			if (nextSeq[key].load() != seq)
+				outOfOrder = true;
+			nextSeq[key].store(seq + 1);
+			keyHandler[key].store(gaf::TaskHandler::GetCurrent());
+			++done;
+		};
+		dispatcher.SendKeyedTask(CreateTask(DispatcherTestTask, keyedFn), key);
+	};
+	const auto waitDone = [&done](const SIZET count)
+	{
+		while (done.load() < count)
+			std::this_thread::yield();
+	};
+	PRETEST_END();
+
+	/* Every key keeps its order, even when the dispatcher grows while its tasks are queued */
+	DOTEST_BEGIN("DispatcherKeyedOrder");
+	for (SIZET seq = 0; seq < tasksPerKey; ++seq)
+	{
+		if (seq == tasksPerKey / 2)
+			app->ChangeNumberOfHandlers(&dispatcher, numHandlers);
+		for (SIZET key = 0; key < numKeys; ++key)
+			sendKeyed(key, seq);
+	}
+	waitDone(numKeys * tasksPerKey);
+	gaf::Assertion::WhenTrue(outOfOrder.load(), "The keyed tasks of a dispatcher didn't keep their order, while performing a test.");
+	DOTEST_END();
+
+	/* The slots were freed by the tasks, so the keys spread over the handlers added later */
+	done.store(0);
+	DOTEST_BEGIN("DispatcherKeyRelease");
+	for (SIZET key = 0; key < numKeys; ++key)
+		sendKeyed(key, tasksPerKey);
+	waitDone(numKeys);
+	std::unordered_map<const gaf::TaskHandler*, SIZET> perHandler;
+	for (const auto& handler : keyHandler)
+		++perHandler[handler.load()];
+	gaf::Assertion::WhenTrue(perHandler.size() < 2, "The key slots weren't freed after their tasks finished, while performing a test.");
+	DOTEST_END();
+
+	/* A handler with a long queue is never picked, as the other choice is always less loaded */
+	done.store(0);
+	DOTEST_BEGIN("DispatcherLeastLoaded");
+	std::atomic_bool release(false);
+	std::atomic<const gaf::TaskHandler*> blocked(nullptr), picked(nullptr);
+	const auto blockerFn = [&blocked, &release]()
+	{
+		blocked = gaf::TaskHandler::GetCurrent();
+		while (!release.load())
+			std::this_thread::yield();
+	};
+	dispatcher.SendTask(CreateTask(DispatcherTestTask, blockerFn), 0);
+	while (blocked.load() == nullptr)
+		std::this_thread::yield();
+	for (SIZET i = 0; i < numKeys; ++i)
+		dispatcher.SendTask(CreateTask(DispatcherTestTask, [&done]() { ++done; }), 0);
+	for (SIZET i = 0; i < numKeys; ++i)
+	{
+		const auto pickFn = [&blocked, &picked, &done]()
+		{
+			if (gaf::TaskHandler::GetCurrent() == blocked.load())
+				picked = blocked.load();
+			++done;
+		};
+		dispatcher.SendTask(CreateTask(DispatcherTestTask, pickFn));
+	}
+	release = true;
+	waitDone(2 * numKeys);
+	gaf::Assertion::WhenInequal(picked.load(), (const gaf::TaskHandler*)nullptr, "The dispatcher sent a task to its most loaded handler, while performing a test.");
+	DOTEST_END();
+
+	/* A batch bigger than the handler queues, which are filled as the handlers drain them */
+	DOTEST_BEGIN("DispatcherBatch");
+	constexpr SIZET numBatch = 4 * GREAPER_TASKMAN_DISPATCHER_QUEUE_CAPACITY + 100;
+	std::vector<std::atomic<uint32>> runs(numBatch);
+	std::vector<gaf::Task_t> batch;
+	batch.reserve(numBatch);
+	for (SIZET i = 0; i < numBatch; ++i)
+	{
+		const auto runFn = [&runs, i]() { ++runs[i]; };
+		batch.push_back(CreateTask(DispatcherTestTask, runFn));
+	}
+	dispatcher.SendTasks(batch);
+	for (SIZET i = 0; i < numBatch; ++i)
+	{
+		while (runs[i].load() == 0)
+			std::this_thread::yield();
+	}
+	/* Late duplicates would show up meanwhile */
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	for (SIZET i = 0; i < numBatch; ++i)
+		gaf::Assertion::WhenInequal(runs[i].load(), 1U, "A task of a dispatcher batch didn't run exactly once, while performing a test.");
+	DOTEST_END();
+	app->UnregisterTaskDispatcher(&dispatcher);
+}
+
+CreateTaskName(FutureTestTask);
+
+void GAFTest::FutureTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr uint32 numFutures = 32;
+	const auto app = gaf::InstanceApp();
+	/* Its only handler is held by the tasks that must not be helped by the waiting thread */
+	TestDispatcher dispatcher(app);
+	app->RegisterTaskDispatcher(&dispatcher, 1, "gaf-test");
+	std::atomic_bool started(false), release(false);
+	const auto blockerFn = [&started, &release]()
+	{
+		started = true;
+		while (!release.load())
+			std::this_thread::yield();
+		return 0U;
+	};
+	const auto valueFn = []() { return 21U; };
+	const auto throwFn = []() -> uint32 { throw std::runtime_error("FutureTest exception"); };
+	const auto caughtFn = [](const auto& future)
+	{
+		try
+		{
+			future.Get();
+		}
+		catch (const std::runtime_error&)
+		{
+			return true;
+		}
+		return false;
+	};
+	PRETEST_END();
+
+	DOTEST_BEGIN("FutureGet");
+	const auto future = app->SendTask(FutureTestTask_Name, valueFn);
+	gaf::Assertion::WhenInequal(future.Get(), 21U, "A Future didn't get the value returned by its task, while performing a test.");
+	gaf::Assertion::WhenTrue(future.HasException(), "A Future without exception says it has one, while performing a test.");
+	DOTEST_END();
+
+	DOTEST_BEGIN("FutureException");
+	const auto future = app->SendTask(FutureTestTask_Name, throwFn);
+	gaf::Assertion::WhenTrue(!caughtFn(future), "A Future didn't rethrow the exception of its task, while performing a test.");
+	gaf::Assertion::WhenTrue(!future.HasException(), "A Future with an exception says it hasn't one, while performing a test.");
+	DOTEST_END();
+
+	/* An exception skips the continuations and reaches the end of the chain */
+	DOTEST_BEGIN("FutureThen");
+	const auto chained = app->SendTask(FutureTestTask_Name, valueFn)
+		.Then([](const uint32 value) { return value * 2; })
+		.Then([](const uint32 value) { return value + 1; });
+	gaf::Assertion::WhenInequal(chained.Get(), 43U, "A chain of continuations didn't get the right value, while performing a test.");
+	std::atomic_bool called(false);
+	const auto failed = app->SendTask(FutureTestTask_Name, throwFn)
+		.Then([&called](const uint32 value) { called = true; return value; });
+	gaf::Assertion::WhenTrue(!caughtFn(failed), "A continuation didn't carry the exception of its Future, while performing a test.");
+	gaf::Assertion::WhenTrue(called.load(), "A continuation was called on a Future with an exception, while performing a test.");
+	DOTEST_END();
+
+	DOTEST_BEGIN("FutureWhenAll");
+	std::atomic<uint32> done(0);
+	std::vector<gaf::Future<void>> futures;
+	for (uint32 i = 0; i < numFutures; ++i)
+		futures.push_back(app->SendTask(FutureTestTask_Name, [&done]() { ++done; }));
+	gaf::WhenAll(futures).Get();
+	gaf::Assertion::WhenInequal(done.load(), numFutures, "WhenAll got ready before every Future, while performing a test.");
+	std::vector<gaf::Future<uint32>> values{ app->SendTask(FutureTestTask_Name, valueFn), app->SendTask(FutureTestTask_Name, throwFn) };
+	gaf::Assertion::WhenTrue(!caughtFn(gaf::WhenAll(values)), "WhenAll didn't carry the exception of a Future, while performing a test.");
+	DOTEST_END();
+
+	/* The first Future is held until the second one is ready */
+	DOTEST_BEGIN("FutureWhenAny");
+	std::vector<gaf::Future<uint32>> futures{ dispatcher.SendTask(FutureTestTask_Name, blockerFn) };
+	while (!started.load())
+		std::this_thread::yield();
+	futures.push_back(app->SendTask(FutureTestTask_Name, valueFn));
+	const auto any = gaf::WhenAny(futures);
+	gaf::Assertion::WhenInequal(any.Get(), (SIZET)1, "WhenAny didn't get the index of the first Future ready, while performing a test.");
+	release = true;
+	futures[0].Wait();
+	gaf::Assertion::WhenInequal(any.Get(), (SIZET)1, "WhenAny changed its index after another Future got ready, while performing a test.");
+	DOTEST_END();
+
+	/* A task cancelled before running leaves its Future with a TaskDiscardedException */
+	DOTEST_BEGIN("FutureDiscarded");
+	started = false;
+	release = false;
+	std::atomic_bool called(false);
+	dispatcher.SendTask(CreateTask(FutureTestTask, blockerFn));
+	while (!started.load())
+		std::this_thread::yield();
+	const auto future = dispatcher.SendTask(FutureTestTask_Name, [&called]() { called = true; return 0U; });
+	dispatcher.CancelPendingTasks();
+	release = true;
+	bool discarded = false;
+	try
+	{
+		future.Get();
+	}
+	catch (const gaf::TaskDiscardedException&)
+	{
+		discarded = true;
+	}
+	gaf::Assertion::WhenTrue(!discarded, "The Future of a discarded task didn't get a TaskDiscardedException, while performing a test.");
+	gaf::Assertion::WhenTrue(called.load(), "A discarded task was executed, while performing a test.");
+	DOTEST_END();
+	app->UnregisterTaskDispatcher(&dispatcher);
+}
+
+#if GREAPER_COROUTINES
+CreateTaskName(CoroutineTestTask);
+
+/* Coroutines of the Coroutine test, they take their arguments by value as they outlive the frame of the caller */
+static gaf::Task<uint32> DoubleCoroutine(gaf::Future<uint32> value)
+{
+	co_return 2 * co_await value;
+}
+
+static gaf::Task<uint32> ForwardCoroutine(gaf::Future<uint32> value)
+{
+	co_return co_await DoubleCoroutine(std::move(value));
+}
+
+static gaf::Task<> SwitchCoroutine(TestDispatcher* dispatcher, std::shared_ptr<uint32> tracker)
+{
+	co_await gaf::SwitchToDispatcher(dispatcher);
+	++*tracker;
+}
+#endif
+
+void GAFTest::CoroutineTest(ResultVec& resultVec)
+{
+#if GREAPER_COROUTINES
+	PRETEST_BEGIN();
+	const auto app = gaf::InstanceApp();
+	const auto valueFn = []() { return 21U; };
+	const auto throwFn = []() -> uint32 { throw std::runtime_error("CoroutineTest exception"); };
+	PRETEST_END();
+
+	/* The value goes through two nested coroutines */
+	DOTEST_BEGIN("CoroutineAwaitFuture");
+	const auto task = ForwardCoroutine(app->SendTask(CoroutineTestTask_Name, valueFn));
+	gaf::Assertion::WhenInequal(task.Get(), 42U, "A coroutine didn't get the value of the awaited Future, while performing a test.");
+	DOTEST_END();
+
+	/* The exception of the awaited task reaches the caller through both coroutines */
+	DOTEST_BEGIN("CoroutineException");
+	const auto task = ForwardCoroutine(app->SendTask(CoroutineTestTask_Name, throwFn));
+	bool caught = false;
+	try
+	{
+		task.Get();
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	gaf::Assertion::WhenTrue(!caught, "A coroutine didn't carry the exception of the awaited Future, while performing a test.");
+	DOTEST_END();
+
+	/* The resume task is discarded, which must destroy the suspended frame and its arguments */
+	DOTEST_BEGIN("CoroutineDiscarded");
+	TestDispatcher dispatcher(app);
+	app->RegisterTaskDispatcher(&dispatcher, 1, "gaf-test");
+	std::atomic_bool started(false), release(false);
+	const auto blockerFn = [&started, &release]()
+	{
+		started = true;
+		while (!release.load())
+			std::this_thread::yield();
+	};
+	dispatcher.SendTask(CreateTask(CoroutineTestTask, blockerFn));
+	while (!started.load())
+		std::this_thread::yield();
+	const auto tracker = std::make_shared<uint32>(0);
+	const auto task = SwitchCoroutine(&dispatcher, tracker);
+	dispatcher.CancelPendingTasks();
+	release = true;
+	bool discarded = false;
+	try
+	{
+		task.Get();
+	}
+	catch (const gaf::TaskDiscardedException&)
+	{
+		discarded = true;
+	}
+	gaf::Assertion::WhenTrue(!discarded, "A coroutine whose resume task was discarded didn't get a TaskDiscardedException, while performing a test.");
+	gaf::Assertion::WhenInequal(*tracker, 0U, "A coroutine whose resume task was discarded was resumed, while performing a test.");
+	/* The promise makes the Future ready before the arguments are destroyed */
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	while (tracker.use_count() > 1 && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::yield();
+	gaf::Assertion::WhenInequal(tracker.use_count(), 1L, "The frame of a coroutine whose resume task was discarded wasn't destroyed, while performing a test.");
+	app->UnregisterTaskDispatcher(&dispatcher);
+	DOTEST_END();
+#endif
+}
+
+CreateTaskName(StrandTestTask);
+
+void GAFTest::StrandTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 10000;
+	constexpr SIZET numProducers = 4;
+	const auto app = gaf::InstanceApp();
+	gaf::Strand strand(app);
+	/* Only touched by the tasks of the Strand, so it needs no lock if they never overlap */
+	std::vector<SIZET> order;
+	order.reserve(numTasks);
+	std::atomic<uint32> running(0);
+	std::atomic_bool overlapped(false), outside(false);
+	const auto waitStrand = [&strand]()
+	{
+		while (strand.GetPendingTasks() > 0)
+			std::this_thread::yield();
+	};
+	PRETEST_END();
+
+	DOTEST_BEGIN("StrandPostOrder");
+	for (SIZET i = 0; i < numTasks; ++i)
+	{
+		const auto orderFn = [&order, &running, &overlapped, &outside, &strand, i]()
+		{
+			if (running.fetch_add(1) != 0)
+				overlapped = true;
+			if (!strand.IsRunningInThisThread())
+				outside = true;
+			order.push_back(i);
+			running.fetch_sub(1);
+		};
+		strand.Post(CreateTask(StrandTestTask, orderFn));
+	}
+	waitStrand();
+	DOTEST_END();
+	gaf::Assertion::WhenTrue(overlapped.load(), "Two tasks of a Strand ran at the same time, while performing a test.");
+	gaf::Assertion::WhenTrue(outside.load(), "A task of a Strand didn't see itself running in it, while performing a test.");
+	gaf::Assertion::WhenInequal(order.size(), numTasks, "A Strand didn't run every task posted to it, while performing a test.");
+	for (SIZET i = 0; i < order.size(); ++i)
+		gaf::Assertion::WhenInequal(order[i], i, "A Strand didn't run its tasks in the order they were posted, while performing a test.");
+
+	/* Several pool tasks post at once, the tasks of each one must keep their order */
+	order.clear();
+	DOTEST_BEGIN("StrandPostConcurrent");
+	std::atomic<SIZET> producersDone(0);
+	for (SIZET p = 0; p < numProducers; ++p)
+	{
+		const auto producerFn = [&, p]()
+		{
+			for (SIZET i = 0; i < numTasks / numProducers; ++i)
+			{
+				const auto val = p * numTasks + i;
+				const auto orderFn = [&order, &running, &overlapped, val]()
+				{
+					if (running.fetch_add(1) != 0)
+						overlapped = true;
+					order.push_back(val);
+					running.fetch_sub(1);
+				};
+				strand.Post(CreateTask(StrandTestTask, orderFn));
+			}
+			++producersDone;
+		};
+		app->SendTask(CreateTask(StrandTestTask, producerFn));
+	}
+	while (producersDone.load() < numProducers)
+		std::this_thread::yield();
+	waitStrand();
+	DOTEST_END();
+	gaf::Assertion::WhenTrue(overlapped.load(), "Two tasks of a Strand ran at the same time, while performing a test.");
+	gaf::Assertion::WhenInequal(order.size(), numTasks, "A Strand didn't run every task posted to it, while performing a test.");
+	std::vector<SIZET> nextOfProducer(numProducers, 0);
+	for (const auto val : order)
+	{
+		auto& next = nextOfProducer[val / numTasks];
+		gaf::Assertion::WhenInequal(val % numTasks, next, "A Strand reordered the tasks posted by the same thread, while performing a test.");
+		++next;
+	}
+
+	/* Dispatch from a task of the Strand runs inline, from anywhere else it's posted */
+	order.clear();
+	DOTEST_BEGIN("StrandDispatch");
+	const auto outerFn = [&order, &strand]()
+	{
+		order.push_back(0);
+		strand.Dispatch(CreateTask(StrandTestTask, [&order]() { order.push_back(1); }));
+		order.push_back(2);
+	};
+	strand.Dispatch(CreateTask(StrandTestTask, outerFn));
+	waitStrand();
+	DOTEST_END();
+	gaf::Assertion::WhenTrue(order != std::vector<SIZET>{ 0, 1, 2 }, "Strand::Dispatch didn't run inline from a task of the Strand, while performing a test.");
+}
+
+CreateTaskName(TimerTestTask);
+
+void GAFTest::TimerTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	using Clock = std::chrono::steady_clock;
+	const auto app = gaf::InstanceApp();
+	/* Shared with the tasks, a periodic run already sent may still be executing after its timer is cancelled */
+	const auto fired = std::make_shared<std::atomic<uint32>>(0);
+	const auto firedAt = std::make_shared<std::atomic<Clock::rep>>(0);
+	const auto fireFn = [fired, firedAt]()
+	{
+		firedAt->store(Clock::now().time_since_epoch().count());
+		fired->fetch_add(1);
+	};
+	const auto waitFired = [&fired](const uint32 count)
+	{
+		while (fired->load() < count)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	};
+	const auto delayOf = [&firedAt](const Clock::time_point sent)
+	{
+		return Clock::time_point(Clock::duration(firedAt->load())) - sent;
+	};
+	PRETEST_END();
+
+	DOTEST_BEGIN("TimerOneShot");
+	const auto sent = Clock::now();
+	const auto handle = app->SendTaskAfter(std::chrono::milliseconds(20), CreateTask(TimerTestTask, fireFn));
+	waitFired(1);
+	gaf::Assertion::WhenTrue(delayOf(sent) < std::chrono::milliseconds(20), "A delayed task ran before its delay, while performing a test.");
+	gaf::Assertion::WhenTrue(handle.IsActive(), "A one-shot timer is still active after firing, while performing a test.");
+	DOTEST_END();
+
+	/* Further than a turn of the first level, so the timer is cascaded down before firing */
+	fired->store(0);
+	DOTEST_BEGIN("TimerCascade");
+	const auto delay = gaf::TimerWheel::TickDuration * (gaf::TimerWheel::NumSlots * 2 + 10);
+	const auto sent = Clock::now();
+	app->SendTaskAfter(delay, CreateTask(TimerTestTask, fireFn));
+	waitFired(1);
+	gaf::Assertion::WhenTrue(delayOf(sent) < delay, "A cascaded timer ran before its delay, while performing a test.");
+	DOTEST_END();
+
+	fired->store(0);
+	DOTEST_BEGIN("TimerPeriodic");
+	auto handle = app->SendPeriodic(std::chrono::milliseconds(2), CreateTask(TimerTestTask, fireFn));
+	waitFired(10);
+	gaf::Assertion::WhenTrue(!handle.IsActive(), "A periodic timer stopped by itself, while performing a test.");
+	gaf::Assertion::WhenTrue(!handle.Cancel(), "Couldn't cancel a periodic timer, while performing a test.");
+	const auto firedAtCancel = fired->load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	/* A run that was already sent can still happen */
+	gaf::Assertion::WhenTrue(fired->load() > firedAtCancel + 1, "A periodic timer kept firing after being cancelled, while performing a test.");
+	DOTEST_END();
+
+	fired->store(0);
+	DOTEST_BEGIN("TimerCancel");
+	auto handle = app->SendTaskAfter(std::chrono::milliseconds(20), CreateTask(TimerTestTask, fireFn));
+	gaf::Assertion::WhenTrue(!handle.Cancel(), "Couldn't cancel a waiting timer, while performing a test.");
+	gaf::Assertion::WhenTrue(handle.Cancel(), "A timer was cancelled twice, while performing a test.");
+	std::this_thread::sleep_for(std::chrono::milliseconds(40));
+	gaf::Assertion::WhenInequal(fired->load(), 0U, "A cancelled timer fired, while performing a test.");
+	DOTEST_END();
+}
+
+CreateTaskName(CancellationTestTask);
+
+void GAFTest::CancellationTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr SIZET numTasks = 1000;
+	const auto app = gaf::InstanceApp();
+	std::atomic<SIZET> executed(0);
+	const auto countFn = [&executed]() { ++executed; };
+	PRETEST_END();
+
+	DOTEST_BEGIN("CancellationTokenTree");
+	auto parent = gaf::CancellationToken::Create();
+	const auto child = gaf::CancellationToken::Create(parent);
+	gaf::Assertion::WhenTrue(static_cast<bool>(gaf::CancellationToken()), "A default constructed CancellationToken has a state, while performing a test.");
+	gaf::Assertion::WhenTrue(child.IsCancelled(), "A new CancellationToken is already cancelled, while performing a test.");
+	parent.Cancel();
+	gaf::Assertion::WhenTrue(!child.IsCancelled(), "Cancelling a CancellationToken didn't cancel its children, while performing a test.");
+	DOTEST_END();
+
+	/* The tasks are destroyed without running, which releases their captures */
+	DOTEST_BEGIN("CancelledTasks");
+	auto token = gaf::CancellationToken::Create();
+	token.Cancel();
+	std::weak_ptr<SIZET> tracker;
+	{
+		const auto tracked = std::make_shared<SIZET>(0);
+		const auto trackedFn = [&executed, tracked]() { ++executed; };
+		tracker = tracked;
+		for (SIZET i = 0; i < numTasks; ++i)
+		{
+			auto task = CreateTask(CancellationTestTask, trackedFn);
+			task.SetCancellationToken(token);
+			app->SendTask(std::move(task));
+		}
+	}
+	while (!tracker.expired())
+		std::this_thread::yield();
+	gaf::Assertion::WhenInequal(executed.load(), (SIZET)0, "A task with a cancelled token was executed, while performing a test.");
+	DOTEST_END();
+
+	/* A TaskManager of its own, as the one of the Application can't be shut down */
+	executed.store(0);
+	DOTEST_BEGIN("ShutdownDrain");
+	gaf::TaskManager manager;
+	for (SIZET i = 0; i < numTasks; ++i)
+		manager.SendTask(CreateTask(CancellationTestTask, countFn));
+	const auto report = manager.Shutdown(gaf::ETaskShutdown::DRAIN);
+	gaf::Assertion::WhenTrue(report.TimedOut, "Draining the TaskManager timed out, while performing a test.");
+	gaf::Assertion::WhenInequal(executed.load(), numTasks, "Draining the TaskManager didn't execute every pending task, while performing a test.");
+	gaf::Assertion::WhenInequal(report.CancelledTasks, (SIZET)0, "Draining the TaskManager cancelled tasks, while performing a test.");
+	manager.SendTask(CreateTask(CancellationTestTask, countFn));
+	gaf::Assertion::WhenInequal(executed.load(), numTasks, "A TaskManager which was shut down executed a task, while performing a test.");
+	DOTEST_END();
+
+	/* A single TaskHandler, held by a task while the rest are queued behind it */
+	executed.store(0);
+	DOTEST_BEGIN("ShutdownCancel");
+	gaf::TaskManager manager;
+	manager.SetTaskHandlerLimits(1, 1);
+	manager.SetNumberTaskHandlers(1);
+	std::atomic_bool started(false);
+	const auto blockerFn = [&started]()
+	{
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	};
+	manager.SendTask(CreateTask(CancellationTestTask, blockerFn));
+	while (!started.load())
+		std::this_thread::yield();
+	for (SIZET i = 0; i < numTasks; ++i)
+		manager.SendTask(CreateTask(CancellationTestTask, countFn));
+	const auto report = manager.Shutdown(gaf::ETaskShutdown::CANCEL);
+	gaf::Assertion::WhenTrue(report.CancelledTasks == 0, "Cancelling the TaskManager didn't cancel the pending tasks, while performing a test.");
+	gaf::Assertion::WhenInequal(executed.load() + report.CancelledTasks, numTasks, "Cancelling the TaskManager lost tasks, while performing a test.");
+	DOTEST_END();
+}
+
+CreateTaskName(JobCounterTestTask);
+
+void GAFTest::JobCounterTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	constexpr uint32 fanOut = 4;
+	constexpr uint32 depth = 6;
+	constexpr SIZET numTasks = 1000;
+	const auto app = gaf::InstanceApp();
+	/* The same waits are run with and without GREAPER_TASKMAN_FIBERS, the results tell them apart */
+	const std::string mode = GREAPER_TASKMAN_FIBERS ? "Fibers" : "Threads";
+	std::atomic<SIZET> leaves(0), executed(0);
+	/* Every level waits for the next one from inside a pool task */
+	std::function<void(uint32)> fanOutFn;
+	fanOutFn = [&](const uint32 level)
+	{
+		if (level == 0)
+		{
+			++leaves;
+			return;
+		}
+		gaf::JobCounter counter;
+		const auto nextFn = [&fanOutFn, level]() { fanOutFn(level - 1); };
+		for (uint32 i = 0; i < fanOut; ++i)
+			app->SendTask(CreateTask(JobCounterTestTask, nextFn), counter);
+		app->WaitForCounter(counter);
+		gaf::Assertion::WhenInequal(counter.GetValue(), 0U, "WaitForCounter returned before the counter was done, while performing a test.");
+	};
+	SIZET expectedLeaves = 1;
+	for (uint32 i = 0; i < depth; ++i)
+		expectedLeaves *= fanOut;
+	PRETEST_END();
+
+	DOTEST_BEGIN("JobCounterNestedWait" + mode);
+	gaf::JobCounter root;
+	app->SendTask(CreateTask(JobCounterTestTask, [&fanOutFn]() { fanOutFn(depth); }), root);
+	app->WaitForCounter(root);
+	DOTEST_END();
+	gaf::Assertion::WhenInequal(leaves.load(), expectedLeaves, "Not every task waited for was executed, while performing a test.");
+
+	/* Two jobs are added by hand, so the wait for 2 returns once every task has run */
+	DOTEST_BEGIN("JobCounterWaitTarget" + mode);
+	gaf::JobCounter counter(2);
+	for (SIZET i = 0; i < numTasks; ++i)
+		app->SendTask(CreateTask(JobCounterTestTask, [&executed]() { ++executed; }), counter);
+	app->WaitForCounter(counter, 2);
+	gaf::Assertion::WhenInequal(executed.load(), numTasks, "WaitForCounter returned before reaching its target, while performing a test.");
+	counter.Decrement(2);
+	app->WaitForCounter(counter);
+	DOTEST_END();
+}
+
+void GAFTest::ParallelTest(ResultVec& resultVec)
+{
+	PRETEST_BEGIN();
+	const auto app = gaf::InstanceApp();
+	/* Grain sizes compared against the serial loop, 0 is the automatic one */
+	const SIZET grainSizes[] = { 0, 1024, 16384, 131072 };
+	/* Every partial sum is a multiple of 0.5 far below 2^52, so any grouping gives the exact same sum */
+	const auto mapFn = [](const SIZET i) { return static_cast<double>(i) * 0.5 + 1.0; };
+	const auto reduceFn = [](const double a, const double b) { return a + b; };
+	volatile double sink = 0.0;
+	double serialSum = 0.0, parallelSum = 0.0;
+	std::vector<uint32> sortData(1000000);
+	std::mt19937 rng(1234);
+	const auto throwFn = [](const SIZET i)
+	{
+		if (i == 50000)
+			throw std::runtime_error("ParallelTest exception");
+		return static_cast<double>(i);
+	};
+	PRETEST_END();
+
+	SIZET count = 1000;
+	for (SIZET exponent = 3; exponent <= 8; ++exponent, count *= 10)
+	{
+		const auto countStr = "1e" + std::to_string(exponent);
+		DOTEST_BEGIN("ReduceSerial" + countStr);
+		double sum = 0.0;
+		for (SIZET i = 0; i < count; ++i)
+			sum = reduceFn(sum, mapFn(i));
+		sink = serialSum = sum;
+		DOTEST_END();
+		for (const auto grain : grainSizes)
+		{
+			DOTEST_BEGIN("ReduceParallel" + countStr + "Grain" + (grain == 0 ? std::string("Auto") : std::to_string(grain)));
+			sink = parallelSum = gaf::ParallelReduce(app, static_cast<SIZET>(0), count, grain, 0.0, mapFn, reduceFn);
+			DOTEST_END();
+			gaf::Assertion::WhenInequal(parallelSum, serialSum, "ParallelReduce didn't match the serial result, while performing a test.");
+		}
+	}
+
+	for (auto& val : sortData)
+		val = rng();
+	auto sortCopy = sortData;
+	DOTEST_BEGIN("SortSerial1e6");
+	std::sort(sortCopy.begin(), sortCopy.end());
+	DOTEST_END();
+	for (const auto grain : grainSizes)
+	{
+		sortCopy = sortData;
+		DOTEST_BEGIN("SortParallel1e6Grain" + (grain == 0 ? std::string("Auto") : std::to_string(grain)));
+		gaf::ParallelSort(app, sortCopy.begin(), sortCopy.end(), std::less<uint32>(), grain);
+		DOTEST_END();
+		gaf::Assertion::WhenTrue(!std::is_sorted(sortCopy.begin(), sortCopy.end()), "ParallelSort didn't sort the data, while performing a test.");
+	}
+
+	/* The exception reaches the caller only once every half is done, so nothing calls the callbacks after it */
+	DOTEST_BEGIN("ParallelForException");
+	std::atomic<SIZET> calls(0);
+	bool caught = false;
+	try
+	{
+		gaf::ParallelFor(app, static_cast<SIZET>(0), static_cast<SIZET>(100000), 1024, [&calls, &throwFn](const SIZET i)
+		{
+			++calls;
+			throwFn(i);
+		});
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	const auto callsAfter = calls.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	gaf::Assertion::WhenTrue(!caught, "ParallelFor didn't rethrow the exception of its callback, while performing a test.");
+	gaf::Assertion::WhenInequal(calls.load(), callsAfter, "ParallelFor returned before every half was done, while performing a test.");
+	DOTEST_END();
+
+	DOTEST_BEGIN("ParallelReduceException");
+	bool caught = false;
+	try
+	{
+		sink = gaf::ParallelReduce(app, static_cast<SIZET>(0), static_cast<SIZET>(100000), 1024, 0.0, throwFn, reduceFn);
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	gaf::Assertion::WhenTrue(!caught, "ParallelReduce didn't rethrow the exception of its callback, while performing a test.");
+	DOTEST_END();
+}
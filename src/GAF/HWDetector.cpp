@@ -119,6 +119,104 @@ static void cpuread(CPUInfo& infoStruct)
 		infoStruct.Vendor = ECPUVendor::UNKNOWN;
 }
 
+#if PLATFORM_LINUX
+/* Parses the cpu lists of sysfs, like "0-3,8,10-11" */
+static std::vector<uint32> ReadCPUList(const std::string& path)
+{
+	std::vector<uint32> cpus;
+	std::ifstream file(path);
+	std::string list;
+	if (!file.is_open() || !std::getline(file, list))
+		return cpus;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ','))
+	{
+		if (range.empty())
+			continue;
+		const auto dash = range.find('-');
+		const auto first = (uint32)std::stoul(range.substr(0, dash));
+		const auto last = dash == std::string::npos ? first : (uint32)std::stoul(range.substr(dash + 1));
+		for (auto cpu = first; cpu <= last; ++cpu)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+static uint32 ReadSysValue(const std::string& path, const uint32 defaultValue)
+{
+	std::ifstream file(path);
+	uint32 value;
+	if (file.is_open() && (file >> value))
+		return value;
+	return defaultValue;
+}
+#endif
+
+static std::vector<LogicalCoreInfo> ReadCoreTopology()
+{
+	std::vector<LogicalCoreInfo> topology;
+#if PLATFORM_WINDOWS
+	DWORD length = 0;
+	GetLogicalProcessorInformation(nullptr, &length);
+	std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+	if (infos.empty() || !GetLogicalProcessorInformation(infos.data(), &length))
+		return topology;
+	uint32 numCores = 0;
+	for (const auto& info : infos)
+	{
+		if (info.Relationship != RelationProcessorCore)
+			continue;
+		uint32 sibling = 0;
+		for (uint32 i = 0; i < sizeof(ULONG_PTR) * 8; ++i)
+		{
+			if (info.ProcessorMask & ((ULONG_PTR)1 << i))
+				topology.push_back(LogicalCoreInfo{ i, numCores, sibling++, 0 });
+		}
+		++numCores;
+	}
+	for (const auto& info : infos)
+	{
+		if (info.Relationship != RelationNumaNode)
+			continue;
+		for (auto& core : topology)
+		{
+			if (info.ProcessorMask & ((ULONG_PTR)1 << core.Index))
+				core.NUMANode = (uint32)info.NumaNode.NodeNumber;
+		}
+	}
+#elif PLATFORM_LINUX
+	const std::string cpuPath = "/sys/devices/system/cpu/";
+	const auto online = ReadCPUList(cpuPath + "online");
+	/* Core ids are only unique inside a package */
+	std::map<std::pair<uint32, uint32>, std::pair<uint32, uint32>> cores;
+	for (const auto cpu : online)
+	{
+		const auto topologyPath = cpuPath + "cpu" + std::to_string(cpu) + "/topology/";
+		const auto package = ReadSysValue(topologyPath + "physical_package_id", 0);
+		const auto coreID = ReadSysValue(topologyPath + "core_id", cpu);
+		auto it = cores.find(std::make_pair(package, coreID));
+		if (it == cores.end())
+			it = cores.emplace(std::make_pair(package, coreID), std::make_pair((uint32)cores.size(), 0U)).first;
+		topology.push_back(LogicalCoreInfo{ cpu, it->second.first, it->second.second++, 0 });
+	}
+	const std::string nodePath = "/sys/devices/system/node/";
+	for (const auto node : ReadCPUList(nodePath + "online"))
+	{
+		for (const auto cpu : ReadCPUList(nodePath + "node" + std::to_string(node) + "/cpulist"))
+		{
+			for (auto& core : topology)
+			{
+				if (core.Index == cpu)
+					core.NUMANode = node;
+			}
+		}
+	}
+#endif
+	std::sort(topology.begin(), topology.end(), [](const LogicalCoreInfo& a, const LogicalCoreInfo& b) { return a.Index < b.Index; });
+	return topology;
+}
+
 static const ANSICHAR* FeatureCheck(const int feature)
 {
 	static const auto yes = "True";
@@ -127,17 +225,22 @@ static const ANSICHAR* FeatureCheck(const int feature)
 }
 
 HWDetector::HWDetector()
+	:m_NumNUMANodes(1)
 {
 	LogManager::LogMessage(LL_INFO, "Starting System features detection...");
 	cpuread(m_Info);
+	m_Topology = ReadCoreTopology();
+	for (const auto& core : m_Topology)
+		m_NumNUMANodes = Max(m_NumNUMANodes, core.NUMANode + 1);
 	const auto logical = GetNumberLogicalCores();
-	const auto physical = m_Info.Features.htt != 0 ? logical / 2 : logical;
+	const auto physical = GetNumberPhysicalCores();
 	LogManager::LogMessage(LL_INFO,
 		"System information:\n"
 		"\tOS: %s\n"
 		"\tCPU Vendor: %s\n"
 		"\tCPU Logical core count: %d\n"
 		"\tCPU Physical core count: %d\n"
+		"\tNUMA node count: %d\n"
 		"\tRAM installed: %fGB\n"
 		"\tAES instruction set supported: %s\n"
 		"\tEnhanced REP MOVSB/STOSB supported: %s\n"
@@ -176,7 +279,7 @@ HWDetector::HWDetector()
 		GetOSNameAndVer().c_str(),
 		m_Info.Vendor == ECPUVendor::INTEL ? "INTEL" :
 		m_Info.Vendor == ECPUVendor::AMD ? "AMD" : "UNKNOWN",
-		logical, physical, (float)(((double)GetRAMAmount()) / (1024.0 * 1024.0)),
+		logical, physical, m_NumNUMANodes, (float)(((double)GetRAMAmount()) / (1024.0 * 1024.0)),
 		FeatureCheck(m_Info.Features.AES),
 		FeatureCheck(m_Info.Features.erms),
 		FeatureCheck(m_Info.Features.f16c),
@@ -235,9 +338,24 @@ uint32 HWDetector::GetNumberLogicalCores()const
 
 uint32 HWDetector::GetNumberPhysicalCores()const
 {
+	if (!m_Topology.empty())
+	{
+		const auto physical = std::count_if(m_Topology.begin(), m_Topology.end(), [](const LogicalCoreInfo& core) { return core.Sibling == 0; });
+		return (uint32)physical;
+	}
 	return m_Info.Features.htt ? GetNumberLogicalCores() / 2 : GetNumberLogicalCores();
 }
 
+uint32 HWDetector::GetNumberNUMANodes()const
+{
+	return m_NumNUMANodes;
+}
+
+const std::vector<LogicalCoreInfo>& HWDetector::GetCoreTopology()const
+{
+	return m_Topology;
+}
+
 CPUInfo HWDetector::GetCPUInfo()const
 {
 	return m_Info;
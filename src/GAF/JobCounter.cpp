@@ -0,0 +1,96 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+
+#include "GAF/JobCounter.h"
+#include "GAF/TaskManager.h"
+
+using namespace gaf;
+
+JobCounter::JobCounter(const uint32 value)
+#if GREAPER_TASKMAN_FIBERS
+	:m_NumWaiters(0)
+	,m_Value(value)
+#else
+	:m_Value(value)
+#endif
+	,m_Notifying(0)
+{
+
+}
+
+#if GREAPER_TASKMAN_FIBERS
+bool JobCounter::AddWaiter(Fiber* fiber, TaskManager* manager, const uint32 target)
+{
+	std::lock_guard<std::mutex> lock(m_WaitersMutex);
+	m_Waiters.push_back({ fiber, manager, target });
+	/* Pairs with Decrement, either it sees the waiter or we see its value */
+	m_NumWaiters.fetch_add(1, std::memory_order_seq_cst);
+	if (m_Value.load(std::memory_order_seq_cst) > target)
+		return true;
+	m_Waiters.pop_back();
+	m_NumWaiters.fetch_sub(1, std::memory_order_relaxed);
+	return false;
+}
+
+void JobCounter::ResumeWaiters()
+{
+	std::lock_guard<std::mutex> lock(m_WaitersMutex);
+	const auto value = m_Value.load(std::memory_order_seq_cst);
+	for (SIZET i = 0; i < m_Waiters.size(); )
+	{
+		if (value > m_Waiters[i].Target)
+		{
+			++i;
+			continue;
+		}
+		m_Waiters[i].Manager->ResumeFiber(m_Waiters[i].WaitingFiber);
+		m_Waiters[i] = m_Waiters.back();
+		m_Waiters.pop_back();
+		m_NumWaiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+#endif
+
+void JobCounter::WaitForNotifiers()const
+{
+	while (m_Notifying.load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+}
+
+void JobCounter::Add(const uint32 count)
+{
+	m_Value.fetch_add(count, std::memory_order_relaxed);
+}
+
+void JobCounter::Decrement(const uint32 count)
+{
+	m_Notifying.fetch_add(1, std::memory_order_seq_cst);
+	const auto prev = m_Value.fetch_sub(count, std::memory_order_seq_cst);
+	Assertion::WhenTrue(prev < count, "Decrementing a JobCounter below 0.");
+#if GREAPER_TASKMAN_FIBERS
+	if (m_NumWaiters.load(std::memory_order_seq_cst) != 0)
+		ResumeWaiters();
+#endif
+	m_Event.NotifyAll();
+	/* Last access, the waiters may destroy the counter right after this */
+	m_Notifying.fetch_sub(1, std::memory_order_release);
+}
+
+uint32 JobCounter::GetValue()const
+{
+	return m_Value.load(std::memory_order_seq_cst);
+}
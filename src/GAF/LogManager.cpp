@@ -20,6 +20,7 @@
 #include "GAF/Version.h"
 #include "GAF/Util/StringUtils.h"
 #include "GAF/PropertiesManager.h"
+#include "GAF/Strand.h"
 
 using namespace gaf;
 
@@ -65,22 +66,14 @@ void LogManager::DefaultLoggingFn(const std::string& msg, const DayTime& time, c
 	}
 }
 
-void LogManager::LogTask(const MessageInfo & msg)
+void LogManager::LogTask(const MessageInfo & msg, const LogHandlerID handler)
 {
 	if (!InstanceLog())
 		return;
 	m_HandlersMutex.lock_shared();
-	if (m_LogHandlers.empty())
-	{
-		m_HandlersMutex.unlock_shared();
-		return;
-	}
-	for (auto it = m_LogHandlers.begin(); it != m_LogHandlers.end(); ++it)
-	{
-		if (!it->first || !it->second)
-			continue;
-		it->second(msg.Message, msg.Time, msg.Level);
-	}
+	/* It may have been removed after the task was sent */
+	if (handler < m_LogHandlers.size() && m_LogHandlers[handler].first && m_LogHandlers[handler].second)
+		m_LogHandlers[handler].second(msg.Message, msg.Time, msg.Level);
 	m_HandlersMutex.unlock_shared();
 }
 
@@ -101,6 +94,18 @@ LogManager::LogManager()
 LogManager::~LogManager()
 {
 	LogMessage(LL_INFO, "Stopping LogManager...");
+	/* The messages still queued on the Strands use this LogManager, so they are delivered before it's gone */
+	const auto app = InstanceApp();
+	for (auto it = m_HandlerStrands.begin(); it != m_HandlerStrands.end(); ++it)
+	{
+		if (!*it)
+			continue;
+		while ((*it)->GetPendingTasks() != 0)
+		{
+			if (!app->TryRunPendingTask())
+				std::this_thread::yield();
+		}
+	}
 }
 
 LogManager& LogManager::Instance()
@@ -230,6 +235,8 @@ LogManager::LogHandlerID LogManager::AddLogHandler(const LogHandler & handler, c
 	{
 		m_HandlersMutex.lock();
 		m_LogHandlers.emplace_back(std::make_pair(true, handler));
+		const auto app = InstanceApp();
+		m_HandlerStrands.emplace_back(app ? std::make_unique<Strand>(app, ETaskPriority::BACKGROUND) : nullptr);
 		id = (LogHandlerID)(m_LogHandlers.size() - 1);
 		m_HandlersMutex.unlock();
 	}
@@ -304,13 +311,21 @@ void LogManager::LogMessage(const LogLevel ll, PRINTF_FORMAT_STRING const ANSICH
 			logMgr->m_HandlersMutex.lock_shared();
 			if (!logMgr->m_LogHandlers.empty())
 			{
-				logMgr->m_HandlersMutex.unlock_shared();
-				app->SendTask(CreateTask(LogDispatchTask, std::bind(&LogTask, logMgr, info)));
-			}
-			else
-			{
-				logMgr->m_HandlersMutex.unlock_shared();
+				/* The message was already stored, so the tasks can take it */
+				const auto msg = std::make_shared<const MessageInfo>(std::move(info));
+				for (LogHandlerID id = 0; id < (LogHandlerID)logMgr->m_LogHandlers.size(); ++id)
+				{
+					if (!logMgr->m_LogHandlers[id].first || !logMgr->m_HandlerStrands[id])
+						continue;
+					/*
+						Every handler has its own Strand, so a slow one doesn't hold back the
+						others and a burst of messages is executed by a single BACKGROUND task
+					*/
+					auto logFn = [logMgr, msg, id]() { logMgr->LogTask(*msg, id); };
+					logMgr->m_HandlerStrands[id]->Post(CreateTask(LogDispatchTask, std::move(logFn)));
+				}
 			}
+			logMgr->m_HandlersMutex.unlock_shared();
 		}
 	}
 }
@@ -90,7 +90,8 @@ PropertiesManager::PropertiesManager()
 {
 	LogManager::LogMessage(LL_INFO, "Starting PropertiesManager...");
 	const auto eventMgr = InstanceEvent();
-	EventIDOnModification = eventMgr->RegisterEvent(OnModificationEventName);
+	/* The listeners see the new value before the setter returns */
+	EventIDOnModification = eventMgr->RegisterEvent(OnModificationEventName, EEventDispatch::IMMEDIATE);
 	m_Mutex.lock();
 	auto cur = gPropHead;
 	while (cur)
@@ -82,7 +82,7 @@ ResourceManager::ResourceManager()
 	LogManager::LogMessage(LL_INFO, "Starting ResourceManager...");
 	const auto eventMgr = InstanceEvent();
 	ResourceData::EventIDOnDataChange = eventMgr->RegisterEvent(ResourceData::OnDataChangeEvent);
-	ResourceData::EventIDOnDataDestroying = eventMgr->RegisterEvent(ResourceData::OnDataDestroying);
+	ResourceData::EventIDOnDataDestroying = eventMgr->RegisterEvent<ResourceDataDestroyingEvent>(ResourceData::OnDataDestroying);
 	ResourceData::EventIDOnDataFinishedLoading = eventMgr->RegisterEvent(ResourceData::OnDataFinishedLoading);
 }
 
@@ -666,7 +666,7 @@ ResourceData & ResourceData::operator=(const ResourceData & other)
 
 ResourceData::~ResourceData()
 {
-	InstanceEvent()->DispatchEvent(EventIDOnDataDestroying, (void*)(PTRUINT)GetID());
+	InstanceEvent()->Dispatch(ResourceDataDestroyingEvent{ GetID(), m_Name });
 }
 
 void ResourceData::ChangeSourceData(ResourceLocation * location)
@@ -708,13 +708,14 @@ void ResourceData::Load()
 
 CreateTaskName(ResourceDataLoadAsyncTask);
 
-void ResourceData::LoadAsync()
+Future<void> ResourceData::LoadAsync()
 {
-	InstanceApp()->SendTask(CreateTask(ResourceDataLoadAsyncTask, [this]()
+	const auto loadFn = [this]()
 	{
 		this->Load();
 		InstanceEvent()->DispatchEvent(EventIDOnDataFinishedLoading, this);
-	}));
+	};
+	return InstanceApp()->SendTask(ResourceDataLoadAsyncTask_Name, loadFn);
 }
 
 void ResourceData::Unload()
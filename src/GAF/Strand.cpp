@@ -0,0 +1,153 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/Strand.h"
+#include "GAF/TaskStats.h"
+
+using namespace gaf;
+
+CreateTaskName(StrandDrainTask);
+
+/* State of the Strand whose task is being executed by this thread */
+static GREAPER_THLOCAL const void* gCurrentStrand = nullptr;
+
+class Strand::DrainTask
+{
+	std::shared_ptr<State> m_State;
+
+public:
+	explicit DrainTask(const std::shared_ptr<State>& state)
+		:m_State(state)
+	{
+
+	}
+	DrainTask(DrainTask&& other)noexcept = default;
+	DrainTask(const DrainTask&) = delete;
+	DrainTask& operator=(const DrainTask&) = delete;
+	DrainTask& operator=(DrainTask&&) = delete;
+	~DrainTask()
+	{
+		if (m_State)
+			Discard(m_State);
+	}
+	void operator()()
+	{
+		const auto state = std::move(m_State);
+		Drain(state);
+	}
+};
+
+void Strand::Drain(const std::shared_ptr<State>& state)
+{
+	const auto prevStrand = gCurrentStrand;
+	gCurrentStrand = state.get();
+	for (uint32 executed = 1; ; ++executed)
+	{
+		/* Tasks are queued before being counted, so there's always one when Pending isn't 0 */
+		Task_t task;
+		const auto popped = state->Tasks.PopFront(task);
+		Assertion::WhenTrue(!popped, "Strand was drained with an empty queue.");
+		try
+		{
+			TaskHandler::Execute(task);
+		}
+		catch (...)
+		{
+			/* The exception goes on to the caller, but the Strand can't be left owned by this drain */
+			gCurrentStrand = prevStrand;
+			if (state->Pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				Schedule(state);
+			throw;
+		}
+		if (state->Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			break;
+		if (executed == MaxTasksPerRun)
+		{
+			/* Still owns the Strand, the next drain task continues where this one stops */
+			Schedule(state);
+			break;
+		}
+	}
+	gCurrentStrand = prevStrand;
+}
+
+void Strand::Discard(const std::shared_ptr<State>& state)
+{
+	/* The discarded drain task owned the Strand, so nobody else is popping */
+	Task_t task;
+	do
+	{
+		const auto popped = state->Tasks.PopFront(task);
+		Assertion::WhenTrue(!popped, "Strand was discarded with an empty queue.");
+		task = Task_t();
+	} while (state->Pending.fetch_sub(1, std::memory_order_acq_rel) != 1);
+}
+
+void Strand::Schedule(const std::shared_ptr<State>& state)
+{
+	Task_t task(StrandDrainTask_Name, DrainTask(state));
+	task.SetPriority(state->Priority);
+	/* Once the TaskManager is shut down nobody else would drain the Strand, so this thread does it */
+	if (!state->Manager->TrySendTask(task))
+		task();
+}
+
+Strand::Strand(TaskManager* manager, const ETaskPriority::Type priority)
+	:m_State(std::make_shared<State>())
+{
+	Assertion::WhenNullptr(manager, "Trying to create a Strand with a nullptr manager.");
+	m_State->Manager = manager;
+	m_State->Priority = priority;
+	m_State->Pending.store(0, std::memory_order_relaxed);
+}
+
+void Strand::Post(Task_t task)
+{
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	task.m_SendTime = TaskStats::Now();
+#endif
+	m_State->Tasks.PushBack(std::move(task));
+	if (m_State->Pending.fetch_add(1, std::memory_order_acq_rel) == 0)
+		Schedule(m_State);
+}
+
+void Strand::Dispatch(Task_t task)
+{
+	if (IsRunningInThisThread())
+	{
+		TaskHandler::Execute(task);
+		return;
+	}
+	Post(std::move(task));
+}
+
+const void* Strand::ExchangeCurrent(const void* state)
+{
+	const auto prevStrand = gCurrentStrand;
+	gCurrentStrand = state;
+	return prevStrand;
+}
+
+bool Strand::IsRunningInThisThread()const
+{
+	return gCurrentStrand == m_State.get();
+}
+
+uint32 Strand::GetPendingTasks()const
+{
+	/* Pairs with the decrement of Drain, so seeing 0 also means seeing what the tasks did */
+	return m_State->Pending.load(std::memory_order_acquire);
+}
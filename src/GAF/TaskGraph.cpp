@@ -0,0 +1,240 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/TaskGraph.h"
+#include "GAF/TaskStats.h"
+
+using namespace gaf;
+
+CreateTaskName(TaskGraphNodeTask);
+
+class TaskGraph::NodeTask
+{
+	TaskGraph* m_Graph;
+	NodeID m_Node;
+
+public:
+	NodeTask(TaskGraph* graph, const NodeID node)
+		:m_Graph(graph)
+		,m_Node(node)
+	{
+
+	}
+	NodeTask(NodeTask&& other)noexcept
+		:m_Graph(other.m_Graph)
+		,m_Node(other.m_Node)
+	{
+		other.m_Graph = nullptr;
+	}
+	NodeTask(const NodeTask&) = delete;
+	NodeTask& operator=(const NodeTask&) = delete;
+	NodeTask& operator=(NodeTask&&) = delete;
+	~NodeTask()
+	{
+		if (m_Graph)
+			m_Graph->ExecuteNode(m_Node, true);
+	}
+	void operator()()
+	{
+		const auto graph = m_Graph;
+		m_Graph = nullptr;
+		graph->ExecuteNode(m_Node);
+	}
+};
+
+void TaskGraph::ScheduleNode(const NodeID node)
+{
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	m_Nodes[node]->Task.m_SendTime = TaskStats::Now();
+#endif
+	m_Manager->SendTask(Task_t(TaskGraphNodeTask_Name, NodeTask(this, node)));
+}
+
+void TaskGraph::ExecuteNode(NodeID node, bool cancelled)
+{
+	m_Executing.fetch_add(1, std::memory_order_acq_rel);
+	while (node != NullNodeID)
+	{
+		auto& current = *m_Nodes[node];
+		if (!cancelled && !m_Failed.load(std::memory_order_acquire))
+		{
+			try
+			{
+				cancelled = !TaskHandler::Execute(current.Task);
+			}
+			catch (...)
+			{
+				/* The graph still finishes, its nodes that didn't start are discarded */
+				if (!m_Failed.exchange(true, std::memory_order_acq_rel))
+					m_Exception = std::current_exception();
+			}
+		}
+		if (cancelled || m_Failed.load(std::memory_order_acquire))
+			m_Cancelled.store(true, std::memory_order_relaxed);
+		current.Finished.store(true, std::memory_order_release);
+		/* The first successor that becomes ready continues on this thread, the rest go to the pool */
+		NodeID next = NullNodeID;
+		for (auto it = current.Successors.begin(); it != current.Successors.end(); ++it)
+		{
+			if (m_Nodes[*it]->PendingPredecessors.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				continue;
+			if (next == NullNodeID)
+			{
+				next = *it;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+				m_Nodes[next]->Task.m_SendTime = TaskStats::Now();
+#endif
+			}
+			else if (cancelled)
+				ExecuteNode(*it, true);
+			else
+				ScheduleNode(*it);
+		}
+		if (m_PendingNodes.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			m_Running.store(false, std::memory_order_release);
+		m_Finished.NotifyAll();
+		node = next;
+	}
+	m_Executing.fetch_sub(1, std::memory_order_release);
+}
+
+bool TaskGraph::HasCycle() const
+{
+	std::vector<uint32> pending(m_Nodes.size());
+	std::vector<NodeID> ready;
+	ready.reserve(m_Nodes.size());
+	for (NodeID i = 0; i < static_cast<NodeID>(m_Nodes.size()); ++i)
+	{
+		pending[i] = m_Nodes[i]->NumPredecessors;
+		if (pending[i] == 0)
+			ready.push_back(i);
+	}
+	SIZET visited = 0;
+	while (!ready.empty())
+	{
+		const auto node = ready.back();
+		ready.pop_back();
+		++visited;
+		const auto& successors = m_Nodes[node]->Successors;
+		for (auto it = successors.begin(); it != successors.end(); ++it)
+		{
+			if (--pending[*it] == 0)
+				ready.push_back(*it);
+		}
+	}
+	return visited != m_Nodes.size();
+}
+
+TaskGraph::TaskGraph(TaskManager* manager)
+	:m_Manager(manager)
+	,m_PendingNodes(0)
+	,m_Executing(0)
+	,m_Running(false)
+	,m_Cancelled(false)
+	,m_Failed(false)
+{
+	Assertion::WhenNullptr(manager, "Trying to create a TaskGraph with a nullptr manager.");
+}
+
+TaskGraph::~TaskGraph()
+{
+	/* Not Wait, as it would rethrow the exception of a node */
+	m_Manager->HelpUntil(m_Finished, [this]() { return IsFinished(); });
+	/* The last node notifies after finishing, so it may still be using the graph */
+	while (m_Executing.load(std::memory_order_acquire) != 0)
+		std::this_thread::yield();
+}
+
+TaskGraph::NodeID TaskGraph::AddTask(Task_t task)
+{
+	Assertion::WhenTrue(m_Running.load(), "Trying to add a task to a running TaskGraph.");
+	m_Nodes.emplace_back(std::make_unique<Node>(std::move(task)));
+	return static_cast<NodeID>(m_Nodes.size() - 1);
+}
+
+TaskGraph::NodeID TaskGraph::AddTask(Task_t task, std::initializer_list<NodeID> predecessors)
+{
+	const auto node = AddTask(std::move(task));
+	for (auto it = predecessors.begin(); it != predecessors.end(); ++it)
+		AddDependency(*it, node);
+	return node;
+}
+
+void TaskGraph::AddDependency(const NodeID predecessor, const NodeID successor)
+{
+	Assertion::WhenTrue(m_Running.load(), "Trying to add a dependency to a running TaskGraph.");
+	Assertion::WhenGreaterEqual(predecessor, m_Nodes.size(), "Trying to add a dependency from a non-existant TaskGraph node.");
+	Assertion::WhenGreaterEqual(successor, m_Nodes.size(), "Trying to add a dependency to a non-existant TaskGraph node.");
+	Assertion::WhenEqual(predecessor, successor, "Trying to make a TaskGraph node depend on itself.");
+	m_Nodes[predecessor]->Successors.push_back(successor);
+	++m_Nodes[successor]->NumPredecessors;
+}
+
+void TaskGraph::Run()
+{
+	Assertion::WhenTrue(m_Running.load(), "Trying to run a TaskGraph which is already running.");
+	if (m_Nodes.empty())
+		return;
+	Assertion::WhenTrue(HasCycle(), "Trying to run a TaskGraph with a cycle, some of its nodes would never run.");
+	for (auto it = m_Nodes.begin(); it != m_Nodes.end(); ++it)
+	{
+		(*it)->PendingPredecessors.store((*it)->NumPredecessors, std::memory_order_relaxed);
+		(*it)->Finished.store(false, std::memory_order_relaxed);
+	}
+	m_PendingNodes.store(static_cast<uint32>(m_Nodes.size()), std::memory_order_relaxed);
+	m_Cancelled.store(false, std::memory_order_relaxed);
+	m_Failed.store(false, std::memory_order_relaxed);
+	m_Exception = nullptr;
+	m_Running.store(true, std::memory_order_release);
+	for (NodeID i = 0; i < static_cast<NodeID>(m_Nodes.size()); ++i)
+	{
+		if (m_Nodes[i]->NumPredecessors == 0)
+			ScheduleNode(i);
+	}
+}
+
+void TaskGraph::Wait()
+{
+	m_Manager->HelpUntil(m_Finished, [this]() { return IsFinished(); });
+	if (m_Failed.load(std::memory_order_acquire))
+		std::rethrow_exception(m_Exception);
+}
+
+void TaskGraph::Wait(const NodeID node)
+{
+	Assertion::WhenGreaterEqual(node, m_Nodes.size(), "Trying to wait for a non-existant TaskGraph node.");
+	m_Manager->HelpUntil(m_Finished, [this, node]() { return IsFinished(node); });
+}
+
+bool TaskGraph::IsFinished() const
+{
+	return m_PendingNodes.load(std::memory_order_acquire) == 0;
+}
+
+bool TaskGraph::IsFinished(const NodeID node) const
+{
+	return m_Nodes[node]->Finished.load(std::memory_order_acquire);
+}
+
+bool TaskGraph::WasCancelled() const
+{
+	return m_Cancelled.load(std::memory_order_relaxed);
+}
+
+SIZET TaskGraph::GetNumTasks() const
+{
+	return m_Nodes.size();
+}
@@ -14,176 +14,791 @@
 * limitations under the License.                                                   *
 ***********************************************************************************/
 
-#include "GAF/TaskManager.h"
+#include "GAF/Application.h"
+#include "GAF/LogManager.h"
+#include "GAF/PropertiesManager.h"
 #include "GAF/HWDetector.h"
+#include "GAF/CommandSystem.h"
+#include "GAF/TaskStats.h"
+#include "GAF/TaskTrace.h"
+#include "GAF/Strand.h"
 
 using namespace gaf;
 
-TaskManager::Dispatcher::DHandler::DHandler()
-	:Handler(&Tasks)
+/* Threads outside the pool don't have a random generator, so they just rotate their first victim */
+static GREAPER_THLOCAL uint32 gExternalStealStart = 0;
+/* xorshift state of SelectHandler, 0 until the thread uses it the first time */
+static GREAPER_THLOCAL uint32 gSelectHandlerSeed = 0;
+
+/* Order in which the queues are looked at, the aged one is used every TaskManager::StarvationPeriod tasks */
+static constexpr ETaskPriority::Type gPriorityOrder[ETaskPriority::COUNT] =
+{
+	ETaskPriority::REALTIME, ETaskPriority::HIGH, ETaskPriority::NORMAL, ETaskPriority::BACKGROUND
+};
+static constexpr ETaskPriority::Type gAgedPriorityOrder[ETaskPriority::COUNT] =
+{
+	ETaskPriority::REALTIME, ETaskPriority::BACKGROUND, ETaskPriority::NORMAL, ETaskPriority::HIGH
+};
+
+namespace
 {
+	/* Keeps a task sent with a JobCounter, the counter is decremented when it's destroyed, whether it ran or not */
+	class CountedTask
+	{
+		Task_t m_Task;
+		JobCounter* m_Counter;
+	public:
+		CountedTask(Task_t&& task, JobCounter* counter)
+			:m_Task(std::move(task))
+			,m_Counter(counter)
+		{
+
+		}
+		CountedTask(CountedTask&& other)noexcept
+			:m_Task(std::move(other.m_Task))
+			,m_Counter(other.m_Counter)
+		{
+			other.m_Counter = nullptr;
+		}
+		CountedTask(const CountedTask&) = delete;
+		CountedTask& operator=(const CountedTask&) = delete;
+		CountedTask& operator=(CountedTask&&) = delete;
+		~CountedTask()
+		{
+			if (m_Counter)
+				m_Counter->Decrement();
+		}
+		void operator()()
+		{
+			m_Task();
+		}
+	};
+
+	/*
+		Drops a task from its key slot, the last one frees the slot, so the
+		next task of any of its keys may go to another handler. Keys need no
+		release of their own, their slot is freed once their tasks are gone.
+	*/
+	void ReleaseKeySlot(std::atomic<uint64>* slot)
+	{
+		auto value = slot->fetch_sub(1, std::memory_order_acq_rel) - 1;
+		/* Fails if a new task attached meanwhile, which keeps the slot */
+		if ((value & 0xFFFFFFFFULL) == 0)
+			slot->compare_exchange_strong(value, 0, std::memory_order_release, std::memory_order_relaxed);
+	}
 
+	/* Keeps a task sent with a key, it releases its key slot once it has run or it's destroyed */
+	class KeyedTask
+	{
+		Task_t m_Task;
+		std::atomic<uint64>* m_Slot;
+	public:
+		KeyedTask(Task_t&& task, std::atomic<uint64>* slot)
+			:m_Task(std::move(task))
+			,m_Slot(slot)
+		{
+
+		}
+		KeyedTask(KeyedTask&& other)noexcept
+			:m_Task(std::move(other.m_Task))
+			,m_Slot(other.m_Slot)
+		{
+			other.m_Slot = nullptr;
+		}
+		KeyedTask(const KeyedTask&) = delete;
+		KeyedTask& operator=(const KeyedTask&) = delete;
+		KeyedTask& operator=(KeyedTask&&) = delete;
+		~KeyedTask()
+		{
+			if (m_Slot)
+				ReleaseKeySlot(m_Slot);
+		}
+		void operator()()
+		{
+			m_Task();
+			/* Released right away, the handler may keep the finished task until it takes the next one */
+			ReleaseKeySlot(m_Slot);
+			m_Slot = nullptr;
+		}
+	};
 }
 
-TaskManager::Dispatcher::DHandler::DHandler(const DHandler& other)
-	:Tasks(other.Tasks)
-	,Handler(other.Handler)
+static void OnTaskPlacementChange(IProperty* prop)
 {
-	
+	const auto& value = prop->GetStringValue();
+	for (const auto placement : { ETaskPlacement::NONE, ETaskPlacement::PHYSICAL_CORES, ETaskPlacement::LOGICAL_CORES })
+	{
+		if (value == GetTaskPlacementStr(placement))
+			InstanceApp()->SetTaskPlacement(placement);
+	}
 }
 
-TaskManager::Dispatcher::DHandler::DHandler(DHandler&& other)noexcept
-	:Tasks(std::move(other.Tasks))
-	,Handler(std::move(other.Handler))
+static void OnTaskHandlerLimitsChange(IProperty*)
 {
-
+	const auto propMgr = InstanceProp();
+	const auto minProp = propMgr->GetProperty("TaskManagerMinHandlers");
+	const auto maxProp = propMgr->GetProperty("TaskManagerMaxHandlers");
+	if (!minProp || !maxProp)
+		return;
+	InstanceApp()->SetTaskHandlerLimits((SIZET)minProp->GetNumberValue(), (SIZET)maxProp->GetNumberValue());
 }
 
-TaskManager::Dispatcher::DHandler& TaskManager::Dispatcher::DHandler::operator=(const DHandler& other)
+/* 0 means the default limit, see TaskManager::SetTaskHandlerLimits */
+static StaticProperty gTaskManagerMinHandlers("TaskManagerMinHandlers", false, 0.f, 0.f, 1024.f, OnTaskHandlerLimitsChange);
+static StaticProperty gTaskManagerMaxHandlers("TaskManagerMaxHandlers", false, 0.f, 0.f, 1024.f, OnTaskHandlerLimitsChange);
+static StaticProperty gTaskManagerPlacement("TaskManagerPlacement", false, "NONE", { "NONE", "PHYSICAL_CORES", "LOGICAL_CORES" }, OnTaskPlacementChange);
+
+/* Write the per task timings to the log and clear them */
+#if GREAPER_TASKMAN_STATS
+static const Command::CommandFunc gNoUndo = [](const std::vector<std::string>&) {};
+static StaticCommand gTaskStatsCmd("TaskStats", 0, [](const std::vector<std::string>&) { TaskStats::Dump(); }, gNoUndo);
+static StaticCommand gTaskStatsResetCmd("TaskStatsReset", 0, [](const std::vector<std::string>&) { TaskStats::Reset(); }, gNoUndo);
+#endif
+
+/* Record the timeline and write it as Chrome trace JSON, TaskTraceWrite takes the file path */
+#if GREAPER_TASKMAN_TRACE
+static StaticCommand gTaskTraceStartCmd("TaskTraceStart", 0, [](const std::vector<std::string>&) { TaskTrace::Start(); }, [](const std::vector<std::string>&) { TaskTrace::Stop(); });
+static StaticCommand gTaskTraceStopCmd("TaskTraceStop", 0, [](const std::vector<std::string>&) { TaskTrace::Stop(); }, [](const std::vector<std::string>&) {});
+static StaticCommand gTaskTraceWriteCmd("TaskTraceWrite", 1, [](const std::vector<std::string>& args)
+{
+	if (args.empty())
+	{
+		LogManager::LogMessage(LL_WARN, "TaskTraceWrite needs the path of the file to write.");
+		return;
+	}
+	TaskTrace::Write(args[0]);
+}, [](const std::vector<std::string>&) {});
+#endif
+
+/* Returns the NUMA node of a logical core, 0 if unknown */
+static uint32 GetCoreNUMANode(const uint32 logicalCore)
 {
-	if (this != &other)
+	for (const auto& core : InstanceHW()->GetCoreTopology())
 	{
-		Tasks = other.Tasks;
-		Handler = other.Handler;
+		if (core.Index == logicalCore)
+			return core.NUMANode;
 	}
-	return *this;
+	return 0;
+}
+
+const ANSICHAR* gaf::GetTaskPlacementStr(const ETaskPlacement::Type placement)
+{
+	static const ANSICHAR* PlacementStr[] =
+	{
+		"NONE",
+		"PHYSICAL_CORES",
+		"LOGICAL_CORES"
+	};
+	return PlacementStr[static_cast<SIZET>(placement)];
 }
 
+const ANSICHAR* gaf::GetTaskShutdownStr(const ETaskShutdown::Type mode)
+{
+	static const ANSICHAR* ShutdownStr[] =
+	{
+		"DRAIN",
+		"CANCEL"
+	};
+	return ShutdownStr[static_cast<SIZET>(mode)];
+}
 
-TaskManager::Dispatcher::DHandler& TaskManager::Dispatcher::DHandler::operator=(DHandler&& other)noexcept
+/****************************************************************
+*						TASKMANAGER								*
+****************************************************************/
+
+bool TaskManager::AcquireTask(TaskHandler* handler, Task_t& task)
 {
-	if (this != &other)
+	const auto order = (handler->m_NumAcquired % StarvationPeriod) == StarvationPeriod - 1 ? gAgedPriorityOrder : gPriorityOrder;
+	Task_t* local = nullptr;
+	bool hasValue = false;
+	for (SIZET i = 0; i < ETaskPriority::COUNT && !hasValue; ++i)
 	{
-		Tasks = std::move(other.Tasks);
-		Handler = other.Handler;
+		const auto priority = order[i];
+		if (handler->m_LocalTasks[priority].Pop(local))
+		{
+			task = std::move(*local);
+			TaskPool::Delete(local);
+			hasValue = true;
+		}
+		else
+		{
+			hasValue = m_Tasks[priority].PopFront(task);
+		}
 	}
-	return *this;
+	if (!hasValue)
+		hasValue = StealTask(handler, handler->NextRandom(), task);
+	if (hasValue)
+		++handler->m_NumAcquired;
+	return hasValue;
 }
 
-TaskManager::Dispatcher::Dispatcher(const Dispatcher& other)
+bool TaskManager::StealTask(TaskHandler* thief, const uint32 start, Task_t& task)
 {
-	HandlerMutex.lock();
-	Handlers = other.Handlers;
-	HandlerMutex.unlock();
+	Task_t* local = nullptr;
+	const auto num = m_NumTaskHandlers.load(std::memory_order_acquire);
+	if (num == 0)
+		return false;
+	/* The first pass only robs the TaskHandlers of the thief NUMA node, the second one the rest */
+	const bool byNode = thief && m_StealByNode.load(std::memory_order_relaxed);
+	const auto node = byNode ? thief->m_NUMANode.load(std::memory_order_relaxed) : 0;
+	const uint32 numPasses = byNode ? 2 : 1;
+	for (const auto priority : gPriorityOrder)
+	{
+		for (uint32 pass = 0; pass < numPasses; ++pass)
+		{
+			for (uint32 i = 0; i < num; ++i)
+			{
+				const auto victim = m_TaskHandlers[(start + i) % num].get();
+				if (victim == thief)
+					continue;
+				if (byNode && (victim->m_NUMANode.load(std::memory_order_relaxed) == node) != (pass == 0))
+					continue;
+				if (victim->m_LocalTasks[priority].Steal(local))
+				{
+					task = std::move(*local);
+					TaskPool::Delete(local);
+					return true;
+				}
+			}
+		}
+	}
+	return false;
 }
 
-TaskManager::Dispatcher::Dispatcher(Dispatcher&& other)noexcept
+void TaskManager::PlaceTaskHandler(const SIZET index)
 {
-	other.HandlerMutex.lock_shared();
-	HandlerMutex.lock();
-	Handlers = std::move(other.Handlers);
-	HandlerMutex.unlock();
-	other.HandlerMutex.unlock_shared();
+	if (m_PlacementCores.empty())
+	{
+		m_TaskHandlers[index]->SetPlacement(-1, 0);
+		return;
+	}
+	const auto& core = m_PlacementCores[index % m_PlacementCores.size()];
+	m_TaskHandlers[index]->SetPlacement((int32)core.Index, core.NUMANode);
 }
 
-TaskManager::Dispatcher& TaskManager::Dispatcher::operator=(const Dispatcher& other)
+void TaskManager::RunController()
 {
-	if (this != &other)
+	std::unique_lock<std::mutex> lock(m_ControllerMutex);
+	while (!m_ControllerCondition.wait_for(lock, ControllerInterval, [this]() { return m_ControllerStop; }))
 	{
-		HandlerMutex.lock();
-		Handlers = other.Handlers;
-		HandlerMutex.unlock();
+		lock.unlock();
+		UpdatePoolSize();
+		lock.lock();
 	}
-	return *this;
 }
 
-TaskManager::Dispatcher& TaskManager::Dispatcher::operator=(Dispatcher&& other)noexcept
+void TaskManager::UpdatePoolSize()
 {
-	if (this != &other)
+	const SIZET minHandlers = m_MinTaskHandlers.load(std::memory_order_relaxed);
+	const SIZET maxHandlers = m_MaxTaskHandlers.load(std::memory_order_relaxed);
+	const SIZET num = m_NumTaskHandlers.load(std::memory_order_acquire);
+	if (num < minHandlers || num > maxHandlers)
 	{
-		other.HandlerMutex.lock_shared();
-		HandlerMutex.lock();
-		Handlers = std::move(other.Handlers);
-		HandlerMutex.unlock();
-		other.HandlerMutex.unlock_shared();
+		/* The limits have changed */
+		m_GrowSamples = 0;
+		m_ShrinkSamples = 0;
+		SetNumberTaskHandlers(num);
+		return;
+	}
+
+	SIZET pending = 0;
+	for (const auto priority : gPriorityOrder)
+		pending += GetNumPendingTasks(priority);
+	const SIZET idle = m_WakeUp.GetNumWaiters();
+	const SIZET drained = m_LastPending > pending ? m_LastPending - pending : 0;
+	m_LastPending = pending;
+
+	if (pending > num && pending > drained * GrowSamples && idle == 0)
+	{
+		/* Every TaskHandler is busy and at this rate the backlog won't be done soon */
+		m_ShrinkSamples = 0;
+		if (++m_GrowSamples >= GrowSamples && num < maxHandlers)
+		{
+			m_GrowSamples = 0;
+			SetNumberTaskHandlers(num + 1);
+		}
+	}
+	else if (pending == 0 && idle > 0)
+	{
+		m_GrowSamples = 0;
+		if (++m_ShrinkSamples >= ShrinkSamples && num > minHandlers)
+		{
+			m_ShrinkSamples = 0;
+			SetNumberTaskHandlers(num - 1);
+		}
+	}
+	else
+	{
+		m_GrowSamples = 0;
+		m_ShrinkSamples = 0;
 	}
-	return *this;
 }
 
-/****************************************************************
-*						TASKMANAGER								*
-****************************************************************/
+void TaskManager::DrainTaskHandler(TaskHandler* handler)
+{
+	Task_t* local = nullptr;
+	for (const auto priority : gPriorityOrder)
+	{
+		while (handler->m_LocalTasks[priority].Pop(local))
+		{
+			if (!m_Tasks[priority].TryPush(std::move(*local)))
+				TaskHandler::Execute(*local);
+			TaskPool::Delete(local);
+		}
+	}
+	m_WakeUp.NotifyAll();
+}
 
-void TaskManager::SendTask(TaskDispatcher * dispatcher, const Task_t & task, const uint32 handler)
+uint32 TaskManager::SelectHandler(TaskHandlerGroup& group)
+{
+	const auto sz = (uint32)group.Handlers.size();
+	if (sz == 1)
+		return 0;
+	/* Power of two choices, nearly as good as looking at every handler but it only reads two counters */
+	auto seed = gSelectHandlerSeed;
+	/* xorshift never leaves 0, so every thread is seeded from the address of its own state */
+	if (seed == 0)
+		seed = (uint32)((uint64)(PTRUINT)&gSelectHandlerSeed * 0x9E3779B97F4A7C15ULL >> 32) | 1;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	gSelectHandlerSeed = seed;
+	const auto first = seed % sz;
+	auto second = (seed >> 16) % (sz - 1);
+	if (second >= first)
+		++second;
+	const auto firstDepth = group.Handlers[first]->Depth.load(std::memory_order_relaxed);
+	const auto secondDepth = group.Handlers[second]->Depth.load(std::memory_order_relaxed);
+	return secondDepth < firstDepth ? second : first;
+}
+
+uint32 TaskManager::AttachKeySlot(TaskHandlerGroup& group, const SIZET key, Task_t& task)
+{
+	/* Keys are usually pointers, so the low bits are mixed in before taking the modulo */
+	const auto hash = (uint64)key * 0x9E3779B97F4A7C15ULL;
+	const auto index = (uint32)((hash >> 32) % TaskHandlerGroup::NumKeySlots);
+	auto& slot = group.KeySlots[index];
+	/* A slot without tasks goes to the handler its index maps to now, so keys spread over the handlers added later */
+	const auto idleHandler = (uint64)(index % group.Handlers.size());
+	auto value = slot.load(std::memory_order_acquire);
+	uint64 next;
+	do
+	{
+		next = (value & 0xFFFFFFFFULL) == 0 ? (idleHandler << 32) | 1 : value + 1;
+	} while (!slot.compare_exchange_weak(value, next, std::memory_order_acq_rel, std::memory_order_acquire));
+
+	Task_t keyed;
+	CopyTaskInfo(keyed, task);
+	keyed.Store(KeyedTask(std::move(task), &slot));
+	task = std::move(keyed);
+	return (uint32)(next >> 32);
+}
+
+void TaskManager::PushToHandler(TaskHandlerGroup& group, const uint32 handler, Task_t&& task)
+{
+	auto& dhandler = *group.Handlers[handler];
+	dhandler.Depth.fetch_add(1, std::memory_order_relaxed);
+	dhandler.Tasks.PushBack(std::move(task));
+	dhandler.WakeUp.NotifyOne();
+}
+
+TaskHandlerGroup& TaskManager::GetHandlerGroup(TaskDispatcher* dispatcher)
 {
 	Assertion::WhenNullptr(dispatcher, "Trying to send a Task from a nullptr dispatcher.");
-	m_DispatchersLock.lock_shared();
-	const auto it = m_Dispatchers.find(std::hash<TaskDispatcher*>{}(dispatcher));
-	Assertion::WhenEqual(it, m_Dispatchers.end(), "Trying to send a task from non registered dispatcher.");
-	const auto sz = it->second.Handlers.size();
-	m_DispatchersLock.unlock_shared();
+	Assertion::WhenNullptr(dispatcher->m_Group, "Trying to send a task from non registered dispatcher.");
+	return *dispatcher->m_Group;
+}
+
+void TaskManager::SendTask(TaskDispatcher * dispatcher, Task_t task, uint32 handler)
+{
+	if (!AcceptTasks(&task, 1))
+		return;
+	auto& group = GetHandlerGroup(dispatcher);
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	task.m_SendTime = TaskStats::Now();
+#endif
+	group.HandlerMutex.lock_shared();
+	if (handler == static_cast<uint32>(-1))
+		handler = SelectHandler(group);
+	else
+		Assertion::WhenGreaterEqual(handler, (uint32)group.Handlers.size(), "Trying to send a task to a non-existant handler.");
+	PushToHandler(group, handler, std::move(task));
+	group.HandlerMutex.unlock_shared();
+}
+
+void TaskManager::SendKeyedTask(TaskDispatcher* dispatcher, Task_t task, const SIZET key)
+{
+	if (!AcceptTasks(&task, 1))
+		return;
+	auto& group = GetHandlerGroup(dispatcher);
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	task.m_SendTime = TaskStats::Now();
+#endif
+	group.HandlerMutex.lock_shared();
+	const auto handler = AttachKeySlot(group, key, task);
+	PushToHandler(group, handler, std::move(task));
+	group.HandlerMutex.unlock_shared();
+}
+
+void TaskManager::SendTasks(TaskDispatcher* dispatcher, Task_t* tasks, const SIZET count, const uint32 handler)
+{
+	if (count == 0)
+		return;
+	if (!AcceptTasks(tasks, count))
+		return;
+	auto& group = GetHandlerGroup(dispatcher);
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	const auto sendTime = TaskStats::Now();
+	for (SIZET i = 0; i < count; ++i)
+		tasks[i].m_SendTime = sendTime;
+#endif
+	group.HandlerMutex.lock_shared();
+	auto& handlers = group.Handlers;
+	const auto sz = handlers.size();
 	if (handler == static_cast<uint32>(-1))
 	{
-		uint32 less = 500;
-		uint32 lessId = static_cast<uint32>(-1);
-		it->second.HandlerMutex.lock_shared();
-		for (auto itt = it->second.Handlers.begin(); itt != it->second.Handlers.end(); ++itt)
+		/* Every task goes to the handler that would have the fewest pending tasks */
+		std::vector<SIZET> pending(sz);
+		std::vector<SIZET> shares(sz, 0);
+		for (SIZET i = 0; i < sz; ++i)
+			pending[i] = handlers[i]->Depth.load(std::memory_order_relaxed);
+		for (SIZET i = 0; i < count; ++i)
 		{
-			const auto tmp = itt->Tasks.Size();
-			if (tmp == 0)
-			{
-				less = 0;
-				lessId = (uint32)std::distance(it->second.Handlers.begin(), itt);
-				break;
-			}
-			if (tmp < less)
-			{
-				less = (uint32)tmp;
-				lessId = (uint32)std::distance(it->second.Handlers.begin(), itt);
-			}
+			const auto less = std::distance(pending.begin(), std::min_element(pending.begin(), pending.end()));
+			++pending[less];
+			++shares[less];
+		}
+		SIZET offset = 0;
+		for (SIZET i = 0; i < sz; ++i)
+		{
+			if (shares[i] == 0)
+				continue;
+			handlers[i]->Depth.fetch_add((uint32)shares[i], std::memory_order_relaxed);
+			handlers[i]->Tasks.PushBulk(tasks + offset, shares[i]);
+			handlers[i]->WakeUp.NotifyOne();
+			offset += shares[i];
 		}
-		
-		it->second.Handlers[lessId].Tasks.PushBack(task);
-		it->second.HandlerMutex.unlock_shared();
 	}
 	else
 	{
-		Assertion::WhenGreaterEqual(handler, sz, "Trying to send a task to a non-existant handler.");
-		it->second.HandlerMutex.lock_shared();
-		it->second.Handlers[handler].Tasks.PushBack(task);
-		it->second.HandlerMutex.unlock_shared();
+		Assertion::WhenGreaterEqual(handler, (uint32)sz, "Trying to send tasks to a non-existant handler.");
+		handlers[handler]->Depth.fetch_add((uint32)count, std::memory_order_relaxed);
+		handlers[handler]->Tasks.PushBulk(tasks, count);
+		handlers[handler]->WakeUp.NotifyOne();
 	}
+	group.HandlerMutex.unlock_shared();
 }
 
 uint32 TaskManager::GetPendingTask(TaskDispatcher * dispatcher, const uint32 handler)
 {
-	if(!dispatcher)
-		return static_cast<uint32>(-1);
-	const auto hash = std::hash<TaskDispatcher*>{}(dispatcher);
-	m_DispatchersLock.lock_shared();
-	const auto it = m_Dispatchers.find(hash);
-	if (it == m_Dispatchers.end())
-	{
-		m_DispatchersLock.unlock_shared();
+	if (!dispatcher || !dispatcher->m_Group)
 		return static_cast<uint32>(-1);
-	}
-
-	it->second.HandlerMutex.lock_shared();
-	if (it->second.Handlers.size() < handler)
+	auto& group = *dispatcher->m_Group;
+	group.HandlerMutex.lock_shared();
+	if (handler >= group.Handlers.size())
 	{
-		it->second.HandlerMutex.unlock_shared();
+		group.HandlerMutex.unlock_shared();
 		return static_cast<uint32>(-1);
 	}
-	
-	const auto tasks = (uint32)it->second.Handlers[handler].Tasks.Size();
-	it->second.HandlerMutex.unlock_shared();
+	const auto tasks = group.Handlers[handler]->Depth.load(std::memory_order_relaxed);
+	group.HandlerMutex.unlock_shared();
 	return tasks;
 }
 
 TaskManager::TaskManager()
-	:m_StartingNum(InstanceHW()->GetNumberLogicalCores())
+	:m_NumTaskHandlers(0)
+	,m_StartingNum(InstanceHW()->GetNumberLogicalCores())
+	,m_MaxHandlers(m_StartingNum * MaxHandlersPerCore)
+	,m_MinTaskHandlers((uint32)m_StartingNum)
+	,m_MaxTaskHandlers((uint32)m_MaxHandlers)
+	,m_ControllerStop(false)
+	,m_GrowSamples(0)
+	,m_ShrinkSamples(0)
+	,m_LastPending(0)
+	,m_Placement(ETaskPlacement::NONE)
+	,m_StealByNode(false)
+	,m_Timers(this)
+	,m_AcceptingTasks(true)
+	,m_RejectedTasks(0)
+	,m_IsShutDown(false)
+	,m_DiscardTasks(false)
+	,m_NumDiscarded(0)
+#if GREAPER_TASKMAN_FIBERS
+	,m_NumReadyFibers(0)
+#endif
 {
 	m_HandlersLock.lock();
-	m_TaskHandlers.resize(m_StartingNum, TaskHandler{ &m_Tasks });
+	m_TaskHandlers.resize(m_MaxHandlers);
+	for (SIZET i = 0; i < m_StartingNum; ++i)
+		m_TaskHandlers[i] = std::make_unique<TaskHandler>(this, (uint32)i);
+	m_NumTaskHandlers.store((uint32)m_StartingNum, std::memory_order_release);
 	m_HandlersLock.unlock();
+	m_ControllerThread = std::thread(&TaskManager::RunController, this);
 }
 
 TaskManager::~TaskManager()
 {
+	if (!IsShutDown())
+		Shutdown(ETaskShutdown::CANCEL);
+}
+
+#if GREAPER_TASKMAN_FIBERS
+Fiber* TaskManager::AcquireFiber(const bool limited)
+{
+	Fiber* fiber;
+	if (m_FreeFibers.PopFront(fiber))
+		return fiber;
+	m_FibersMutex.lock();
+	if (limited && m_Fibers.size() >= (SIZET)GREAPER_TASKMAN_MAX_FIBERS)
+	{
+		m_FibersMutex.unlock();
+		return nullptr;
+	}
+	m_Fibers.push_back(std::make_unique<Fiber>(&TaskHandler::FiberMain, GREAPER_TASKMAN_FIBER_STACK_SIZE));
+	fiber = m_Fibers.back().get();
+	m_FibersMutex.unlock();
+	return fiber;
+}
+
+void TaskManager::ReleaseFiber(Fiber* fiber)
+{
+	m_FreeFibers.PushBack(fiber);
+}
+
+void TaskManager::ResumeFiber(Fiber* fiber)
+{
+	m_ReadyFibers.PushBack(fiber);
+	m_NumReadyFibers.fetch_add(1, std::memory_order_seq_cst);
+	m_WakeUp.NotifyOne();
+}
+
+bool TaskManager::TryAcquireReadyFiber(Fiber*& fiber)
+{
+	if (m_NumReadyFibers.load(std::memory_order_seq_cst) == 0 || !m_ReadyFibers.PopFront(fiber))
+		return false;
+	m_NumReadyFibers.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+#endif
+
+void TaskManager::CopyTaskInfo(Task_t& wrapper, Task_t& task)
+{
+	wrapper.Name = task.Name;
+#if GREAPER_DEBUG
+	wrapper.CallerFn = task.CallerFn;
+	wrapper.FileName = task.FileName;
+	wrapper.FileLine = task.FileLine;
+#endif
+	wrapper.m_Deadline = task.m_Deadline;
+	wrapper.m_Cancellation = task.m_Cancellation;
+	task.m_Cancellation = nullptr;
+	wrapper.m_CoalesceSeq = task.m_CoalesceSeq;
+	wrapper.m_Priority = task.m_Priority;
+	wrapper.m_DeadlinePolicy = task.m_DeadlinePolicy;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	wrapper.m_SendTime = task.m_SendTime;
+#endif
+}
+
+void TaskManager::AttachCounter(Task_t& task, JobCounter& counter)
+{
+	counter.Add(1);
+	Task_t counted;
+	CopyTaskInfo(counted, task);
+	counted.Store(CountedTask(std::move(task), &counter));
+	task = std::move(counted);
+}
+
+bool TaskManager::AcceptTasks(Task_t* tasks, const SIZET count)
+{
+	if (m_AcceptingTasks.load(std::memory_order_relaxed) || TaskHandler::GetCurrent())
+		return true;
+	m_RejectedTasks.fetch_add(count, std::memory_order_relaxed);
+	for (SIZET i = 0; i < count; ++i)
+		tasks[i] = Task_t();
+	return false;
+}
+
+bool TaskManager::IsIdle(uint64& executed)
+{
+	/* The queues are looked at before the TaskHandlers, a task taken in between leaves its handler busy */
+	bool idle = true;
+	executed = 0;
+	for (const auto priority : gPriorityOrder)
+		idle &= m_Tasks[priority].Size() == 0;
+	m_HandlersLock.lock_shared();
+	for (auto it = m_TaskHandlers.begin(); it != m_TaskHandlers.end(); ++it)
+	{
+		if (!*it)
+			continue;
+		for (auto& localTasks : (*it)->m_LocalTasks)
+			idle &= localTasks.Empty();
+		idle &= !(*it)->m_Busy.load(std::memory_order_seq_cst);
+		executed += (*it)->m_NumExecuted.load(std::memory_order_acquire);
+	}
+	m_HandlersLock.unlock_shared();
+#if GREAPER_TASKMAN_FIBERS
+	idle &= m_NumReadyFibers.load(std::memory_order_seq_cst) == 0;
+#endif
+	m_DispatchersLock.lock_shared();
+	for (auto& dispatcher : m_Dispatchers)
+	{
+		dispatcher.second.HandlerMutex.lock_shared();
+		for (auto& dhandler : dispatcher.second.Handlers)
+		{
+			idle &= dhandler->Depth.load(std::memory_order_relaxed) == 0;
+			idle &= !dhandler->Handler.m_Busy.load(std::memory_order_seq_cst);
+			executed += dhandler->Handler.m_NumExecuted.load(std::memory_order_acquire);
+		}
+		dispatcher.second.HandlerMutex.unlock_shared();
+	}
+	m_DispatchersLock.unlock_shared();
+	return idle;
+}
+
+SIZET TaskManager::DiscardPendingTasks()
+{
+	SIZET discarded = 0;
+	Task_t task;
+	for (const auto priority : gPriorityOrder)
+	{
+		while (m_Tasks[priority].PopFront(task))
+		{
+			task = Task_t();
+			++discarded;
+		}
+	}
+	while (StealTask(nullptr, 0, task))
+	{
+		task = Task_t();
+		++discarded;
+	}
+	m_DispatchersLock.lock_shared();
+	for (auto& dispatcher : m_Dispatchers)
+	{
+		dispatcher.second.HandlerMutex.lock_shared();
+		for (auto& dhandler : dispatcher.second.Handlers)
+		{
+			while (dhandler->Tasks.PopFront(task))
+			{
+				dhandler->Depth.fetch_sub(1, std::memory_order_relaxed);
+				task = Task_t();
+				++discarded;
+			}
+		}
+		dispatcher.second.HandlerMutex.unlock_shared();
+	}
+	m_DispatchersLock.unlock_shared();
+	return discarded;
+}
+
+void TaskManager::JoinTaskHandlers()
+{
+	m_ControllerMutex.lock();
+	m_ControllerStop = true;
+	m_ControllerMutex.unlock();
+	m_ControllerCondition.notify_one();
+	if (m_ControllerThread.joinable())
+		m_ControllerThread.join();
+
+	/* Dispatcher handlers may still send tasks to the pool, so they stop first */
+	m_DispatchersLock.lock();
+	for (auto& dispatcher : m_Dispatchers)
+	{
+		if (dispatcher.second.Dispatcher)
+			dispatcher.second.Dispatcher->m_Group = nullptr;
+	}
+	m_Dispatchers.clear();
+	m_DispatchersLock.unlock();
+
+	m_ResizeMutex.lock();
+	m_HandlersLock.lock();
+	m_NumTaskHandlers.store(0, std::memory_order_release);
+	for (auto it = m_TaskHandlers.begin(); it != m_TaskHandlers.end(); ++it)
+	{
+		if (*it)
+			(*it)->RequestStop();
+	}
+	m_HandlersLock.unlock();
+	/* The slots only change while resizing, so they can be joined without m_HandlersLock */
+	for (auto it = m_TaskHandlers.begin(); it != m_TaskHandlers.end(); ++it)
+	{
+		if (*it)
+			(*it)->Join();
+	}
+	m_ResizeMutex.unlock();
+}
+
+TaskShutdownReport TaskManager::Shutdown(ETaskShutdown::Type mode, const std::chrono::milliseconds timeout)
+{
+	using Clock = std::chrono::steady_clock;
+	using std::chrono::duration_cast;
+	using std::chrono::microseconds;
+	TaskShutdownReport report{ mode, false, 0, 0, microseconds(0), microseconds(0), microseconds(0) };
+	if (m_IsShutDown.exchange(true))
+	{
+		LogManager::LogMessage(LL_WARN, "Trying to shut down a TaskManager which was already shut down.");
+		return report;
+	}
+	Assertion::WhenTrue(TaskHandler::GetCurrent() != nullptr, "Trying to shut down the TaskManager from one of its TaskHandlers.");
+
+	const auto begin = Clock::now();
+	m_AcceptingTasks.store(false, std::memory_order_seq_cst);
+	m_Timers.Stop();
+	const auto drainBegin = Clock::now();
+	report.StopIntakeTime = duration_cast<microseconds>(drainBegin - begin);
+
+	/* Idle twice in a row with no task taken in between means nothing is queued nor running */
+	const auto deadline = drainBegin + timeout;
+	auto lastExecuted = std::numeric_limits<uint64>::max();
+	for (;;)
+	{
+		if (mode == ETaskShutdown::CANCEL)
+		{
+			m_DiscardTasks.store(true, std::memory_order_relaxed);
+			report.CancelledTasks += DiscardPendingTasks();
+		}
+		uint64 executed = 0;
+		if (IsIdle(executed))
+		{
+			if (executed == lastExecuted)
+				break;
+			lastExecuted = executed;
+		}
+		else
+		{
+			lastExecuted = std::numeric_limits<uint64>::max();
+		}
+		if (mode == ETaskShutdown::DRAIN && Clock::now() >= deadline)
+		{
+			report.TimedOut = true;
+			mode = ETaskShutdown::CANCEL;
+			continue;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	const auto joinBegin = Clock::now();
+	report.DrainTime = duration_cast<microseconds>(joinBegin - drainBegin);
 
+	JoinTaskHandlers();
+	/* Stopped pool TaskHandlers move their leftovers to the global queue */
+	report.CancelledTasks += DiscardPendingTasks() + m_NumDiscarded.load(std::memory_order_relaxed);
+	report.JoinTime = duration_cast<microseconds>(Clock::now() - joinBegin);
+	report.RejectedTasks = m_RejectedTasks.load(std::memory_order_relaxed);
+
+	LogManager::LogMessage(LL_INFO, "TaskManager shut down with %s%s, stop intake %lldus, drain %lldus, join %lldus, %llu tasks cancelled and %llu rejected.",
+		GetTaskShutdownStr(report.Mode), report.TimedOut ? " (timed out)" : "",
+		(long long)report.StopIntakeTime.count(), (long long)report.DrainTime.count(), (long long)report.JoinTime.count(),
+		(unsigned long long)report.CancelledTasks, (unsigned long long)report.RejectedTasks);
+	return report;
 }
 
-void TaskManager::RegisterTaskDispatcher(TaskDispatcher * dispatcher, uint32 handlers)
+bool TaskManager::IsShutDown()const
+{
+	return m_IsShutDown.load(std::memory_order_acquire);
+}
+
+void TaskManager::RegisterTaskDispatcher(TaskDispatcher * dispatcher, uint32 handlers, const std::string& threadName)
 {
 	Assertion::WhenNullptr(dispatcher, "Trying to register a nullptr dispatcher.");
 	const auto hash = std::hash<TaskDispatcher*>{}(dispatcher);
@@ -199,28 +814,41 @@ void TaskManager::RegisterTaskDispatcher(TaskDispatcher * dispatcher, uint32 han
 		handlers = 1;
 
 	m_DispatchersLock.lock();
-	m_Dispatchers.emplace(std::make_pair(hash, Dispatcher()));
-	m_Dispatchers[hash].HandlerMutex.lock();
-	m_Dispatchers[hash].Handlers.resize(handlers);
-	m_Dispatchers[hash].HandlerMutex.unlock();
+	auto& newDispatcher = m_Dispatchers[hash];
+	newDispatcher.Dispatcher = dispatcher;
+	dispatcher->m_Group = &newDispatcher;
+	newDispatcher.HandlerMutex.lock();
+	newDispatcher.ThreadName = "gaf-" + (threadName.empty() ? dispatcher->GetName() : threadName);
+	newDispatcher.Handlers.reserve(handlers);
+	for (uint32 i = 0; i < handlers; ++i)
+		newDispatcher.Handlers.emplace_back(std::make_unique<TaskHandlerGroup::DHandler>(this, newDispatcher.ThreadName + "-" + std::to_string(i), dispatcher->GetName()));
+	newDispatcher.HandlerMutex.unlock();
 	m_DispatchersLock.unlock();
 }
 
 void TaskManager::UnregisterTaskDispatcher(TaskDispatcher * dispatcher)
 {
 	Assertion::WhenNullptr(dispatcher, "Trying to unregister a nullptr dispatcher.");
-	m_DispatchersLock.lock_shared();
+	/* Found and removed under the same lock, so two unregisters can't erase the same group */
+	m_DispatchersLock.lock();
 	const auto it = m_Dispatchers.find(std::hash<TaskDispatcher*>{}(dispatcher));
 	if (it == m_Dispatchers.end())
 	{
-		m_DispatchersLock.unlock_shared();
+		m_DispatchersLock.unlock();
 		return;
 	}
-	m_DispatchersLock.unlock_shared();
-
-	m_DispatchersLock.lock();
-	m_Dispatchers.erase(it);
+	dispatcher->m_Group = nullptr;
+	auto node = m_Dispatchers.extract(it);
 	m_DispatchersLock.unlock();
+
+	/* Joined outside the lock, a task of the dispatcher may still be using the TaskManager */
+	auto& group = node.mapped();
+	for (auto& handler : group.Handlers)
+		handler->Handler.RequestStop();
+	for (auto& handler : group.Handlers)
+		handler->Handler.Join();
+	/* The tasks left in the queues are destroyed here, which frees the key slots they held */
+	group.Handlers.clear();
 }
 
 uint32 TaskManager::GetNumberOfHandlers(TaskDispatcher * dispatcher)
@@ -261,51 +889,351 @@ void TaskManager::ChangeNumberOfHandlers(TaskDispatcher* dispatcher, uint32 hand
 
 	for (auto i = oldSize; i < handlers; ++i)
 	{
-		Dispatcher::DHandler hnd;
-		hnd.Handler.Start();
-		it->second.Handlers.emplace_back(hnd);
+		it->second.Handlers.emplace_back(std::make_unique<TaskHandlerGroup::DHandler>(this, it->second.ThreadName + "-" + std::to_string(i), dispatcher->GetName()));
+		if (!it->second.Cores.empty())
+		{
+			const auto core = it->second.Cores[i % it->second.Cores.size()];
+			it->second.Handlers.back()->Handler.SetPlacement((int32)core, GetCoreNUMANode(core));
+		}
 	}
 	it->second.HandlerMutex.unlock();
 }
 
+void TaskManager::SetDispatcherAffinity(TaskDispatcher* dispatcher, const std::vector<uint32>& logicalCores)
+{
+	Assertion::WhenNullptr(dispatcher, "Trying to set the affinity of a nullptr dispatcher.");
+	m_DispatchersLock.lock_shared();
+	const auto it = m_Dispatchers.find(std::hash<TaskDispatcher*>{}(dispatcher));
+	Assertion::WhenEqual(it, m_Dispatchers.end(), "Trying to set the affinity of a non-registered dispatcher.");
+	it->second.HandlerMutex.lock();
+	it->second.Cores = logicalCores;
+	for (SIZET i = 0; i < it->second.Handlers.size(); ++i)
+	{
+		if (logicalCores.empty())
+		{
+			it->second.Handlers[i]->Handler.SetPlacement(-1, 0);
+		}
+		else
+		{
+			const auto core = logicalCores[i % logicalCores.size()];
+			it->second.Handlers[i]->Handler.SetPlacement((int32)core, GetCoreNUMANode(core));
+		}
+	}
+	it->second.HandlerMutex.unlock();
+	m_DispatchersLock.unlock_shared();
+
+	/* The reserved cores changed */
+	SetTaskPlacement(GetTaskPlacement());
+}
+
+void TaskManager::SetTaskPlacement(const ETaskPlacement::Type placement)
+{
+	std::vector<uint32> reserved;
+	m_DispatchersLock.lock_shared();
+	for (auto& dispatcher : m_Dispatchers)
+	{
+		dispatcher.second.HandlerMutex.lock_shared();
+		reserved.insert(reserved.end(), dispatcher.second.Cores.begin(), dispatcher.second.Cores.end());
+		dispatcher.second.HandlerMutex.unlock_shared();
+	}
+	m_DispatchersLock.unlock_shared();
+
+	std::vector<LogicalCoreInfo> cores;
+	if (placement != ETaskPlacement::NONE)
+	{
+		const auto& topology = InstanceHW()->GetCoreTopology();
+		const auto isCandidate = [placement](const LogicalCoreInfo& core)
+		{
+			return placement == ETaskPlacement::LOGICAL_CORES || core.Sibling == 0;
+		};
+		for (const auto& core : topology)
+		{
+			if (isCandidate(core) && std::find(reserved.begin(), reserved.end(), core.Index) == reserved.end())
+				cores.push_back(core);
+		}
+		/* The dispatchers took every core, so the pool shares them */
+		if (cores.empty())
+			std::copy_if(topology.begin(), topology.end(), std::back_inserter(cores), isCandidate);
+		if (cores.empty())
+		{
+			LogManager::LogMessage(LL_WARN, "Couldn't place the TaskHandlers on %s, the core topology is unknown.", GetTaskPlacementStr(placement));
+		}
+		std::sort(cores.begin(), cores.end(), [](const LogicalCoreInfo& a, const LogicalCoreInfo& b)
+		{
+			return std::tie(a.Sibling, a.NUMANode, a.Core) < std::tie(b.Sibling, b.NUMANode, b.Core);
+		});
+	}
+
+	uint32 numNodes = 0;
+	for (const auto& core : cores)
+		numNodes = Max(numNodes, core.NUMANode + 1);
+
+	m_HandlersLock.lock();
+	m_Placement = placement;
+	m_PlacementCores = std::move(cores);
+	m_StealByNode.store(numNodes > 1, std::memory_order_relaxed);
+	for (SIZET i = 0; i < m_TaskHandlers.size(); ++i)
+	{
+		if (m_TaskHandlers[i])
+			PlaceTaskHandler(i);
+	}
+	m_HandlersLock.unlock();
+}
+
+ETaskPlacement::Type TaskManager::GetTaskPlacement()
+{
+	m_HandlersLock.lock_shared();
+	const auto placement = m_Placement;
+	m_HandlersLock.unlock_shared();
+	return placement;
+}
+
 SIZET TaskManager::GetNumberTaskHandlers()
 {
-	std::shared_lock<std::shared_mutex> lock(m_HandlersLock);
-	return m_TaskHandlers.size();
+	return m_NumTaskHandlers.load(std::memory_order_acquire);
 }
 
 void TaskManager::SendTask(Task_t task)
 {
-	m_Tasks.PushBack(std::move(task));
-	const auto queue = m_Tasks.Size();
-	if (queue > 32)
-		SetNumberTaskHandlers(GetNumberTaskHandlers() + 1);
-	else if (queue < m_StartingNum)
-		SetNumberTaskHandlers(GetNumberTaskHandlers() - 1);
+	if (!AcceptTasks(&task, 1))
+		return;
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	task.m_SendTime = TaskStats::Now();
+#endif
+	const auto current = TaskHandler::GetCurrent();
+	if (current && current->m_Manager == this)
+	{
+		/* Sent from a pool TaskHandler, keep it local, idle ones will steal it */
+		current->m_LocalTasks[task.GetPriority()].Push(TaskPool::New<Task_t>(std::move(task)));
+		m_WakeUp.NotifyOne();
+		return;
+	}
+	if (!m_Tasks[task.GetPriority()].TryPush(std::move(task)))
+	{
+		/* Back-pressure, the queue is full so the caller runs the task, as the pool would */
+		TaskHandler::Execute(task);
+		return;
+	}
+	m_WakeUp.NotifyOne();
 }
 
-void gaf::TaskManager::SetNumberTaskHandlers(const SIZET num)
+bool TaskManager::TrySendTask(Task_t& task)
 {
-	if (num < m_StartingNum)
+	if (!m_AcceptingTasks.load(std::memory_order_relaxed) && !TaskHandler::GetCurrent())
+		return false;
+	SendTask(std::move(task));
+	return true;
+}
+
+void TaskManager::SendTasks(Task_t* tasks, const SIZET count)
+{
+	if (count == 0)
+		return;
+	if (!AcceptTasks(tasks, count))
 		return;
-	const auto numTaskHnd = GetNumberTaskHandlers();
-	if (num == numTaskHnd)
+#if GREAPER_TASKMAN_STATS || GREAPER_TASKMAN_TRACE
+	const auto sendTime = TaskStats::Now();
+	for (SIZET i = 0; i < count; ++i)
+		tasks[i].m_SendTime = sendTime;
+#endif
+	const auto numWakeUps = (uint32)Min(count, (SIZET)std::numeric_limits<uint32>::max());
+	const auto current = TaskHandler::GetCurrent();
+	if (current && current->m_Manager == this)
+	{
+		for (SIZET i = 0; i < count; ++i)
+			current->m_LocalTasks[tasks[i].GetPriority()].Push(TaskPool::New<Task_t>(std::move(tasks[i])));
+		m_WakeUp.NotifyMany(numWakeUps);
 		return;
+	}
+	bool overflow = false;
+	for (SIZET begin = 0; begin < count;)
+	{
+		const auto priority = tasks[begin].GetPriority();
+		auto end = begin + 1;
+		while (end < count && tasks[end].GetPriority() == priority)
+			++end;
+		overflow |= m_Tasks[priority].TryPushBulk(tasks + begin, end - begin) != end - begin;
+		begin = end;
+	}
+	m_WakeUp.NotifyMany(numWakeUps);
+	if (!overflow)
+		return;
+	/* Back-pressure, the tasks that didn't fit weren't moved, so the caller runs them */
+	for (SIZET i = 0; i < count; ++i)
+	{
+		if (tasks[i])
+			TaskHandler::Execute(tasks[i]);
+	}
+}
+
+void TaskManager::SendTasks(std::vector<Task_t>& tasks)
+{
+	SendTasks(tasks.data(), tasks.size());
+	tasks.clear();
+}
+
+void TaskManager::SendTask(Task_t task, JobCounter& counter)
+{
+	AttachCounter(task, counter);
+	SendTask(std::move(task));
+}
+
+void TaskManager::SendTasks(Task_t* tasks, const SIZET count, JobCounter& counter)
+{
+	for (SIZET i = 0; i < count; ++i)
+		AttachCounter(tasks[i], counter);
+	SendTasks(tasks, count);
+}
+
+void TaskManager::WaitForCounter(JobCounter& counter, const uint32 target)
+{
+	if (counter.GetValue() > target)
+	{
+#if GREAPER_TASKMAN_FIBERS
+		const auto current = TaskHandler::GetCurrent();
+		/* The fiber that takes over the thread is reserved before suspending, so the number of stacks stays bounded */
+		Fiber* next = nullptr;
+		if (current && current->m_CurrentFiber)
+			next = AcquireFiber(true);
+		if (next)
+		{
+			/* The Strand belongs to the task, not to the thread, so it goes along with the fiber */
+			const auto strand = Strand::ExchangeCurrent(nullptr);
+			current->SwitchToThread(EFiberSwitch::WAIT, next, &counter, target);
+			/* From here on this may be another thread */
+			Strand::ExchangeCurrent(strand);
+		}
+		else
+		{
+			HelpUntil(counter.m_Event, [&counter, target]() { return counter.GetValue() <= target; });
+		}
+#else
+		HelpUntil(counter.m_Event, [&counter, target]() { return counter.GetValue() <= target; });
+#endif
+	}
+	counter.WaitForNotifiers();
+}
+
+TimerHandle TaskManager::SendTaskAfter(const std::chrono::steady_clock::duration delay, Task_t task)
+{
+	if (!AcceptTasks(&task, 1))
+		return TimerHandle();
+	return m_Timers.Add(std::chrono::steady_clock::now() + delay, std::chrono::steady_clock::duration::zero(), std::move(task));
+}
+
+TimerHandle TaskManager::SendTaskAt(const std::chrono::steady_clock::time_point time, Task_t task)
+{
+	if (!AcceptTasks(&task, 1))
+		return TimerHandle();
+	return m_Timers.Add(time, std::chrono::steady_clock::duration::zero(), std::move(task));
+}
+
+TimerHandle TaskManager::SendPeriodic(const std::chrono::steady_clock::duration interval, Task_t task)
+{
+	Assertion::WhenTrue(interval <= std::chrono::steady_clock::duration::zero(), "Trying to send a periodic task without an interval.");
+	if (!AcceptTasks(&task, 1))
+		return TimerHandle();
+	return m_Timers.Add(std::chrono::steady_clock::now() + interval, interval, std::move(task));
+}
+
+bool TaskManager::TryRunPendingTask()
+{
+	Task_t task;
+	bool hasValue = false;
+	const auto current = TaskHandler::GetCurrent();
+	if (current && current->m_Manager == this)
+		hasValue = AcquireTask(current, task);
+	else
+	{
+		for (SIZET i = 0; i < ETaskPriority::COUNT && !hasValue; ++i)
+			hasValue = m_Tasks[gPriorityOrder[i]].PopFront(task);
+		if (!hasValue)
+			hasValue = StealTask(nullptr, gExternalStealStart++, task);
+	}
+	if (hasValue)
+		TaskHandler::Execute(task);
+	return hasValue;
+}
+
+bool TaskManager::IsTaskHandlerThread() const
+{
+	const auto current = TaskHandler::GetCurrent();
+	return current && current->m_Manager == this;
+}
+
+SIZET TaskManager::GetNumPendingTasks(const ETaskPriority::Type priority)
+{
+	SIZET pending = m_Tasks[priority].Size();
+	m_HandlersLock.lock_shared();
+	const SIZET num = m_NumTaskHandlers.load(std::memory_order_acquire);
+	for (SIZET i = 0; i < num; ++i)
+		pending += m_TaskHandlers[i]->m_LocalTasks[priority].Size();
+	m_HandlersLock.unlock_shared();
+	return pending;
+}
+
+void gaf::TaskManager::SetNumberTaskHandlers(SIZET num)
+{
+	num = Clamp(num, (SIZET)m_MinTaskHandlers.load(std::memory_order_relaxed), (SIZET)m_MaxTaskHandlers.load(std::memory_order_relaxed));
+	m_ResizeMutex.lock();
+	const SIZET numTaskHnd = m_NumTaskHandlers.load(std::memory_order_relaxed);
 	if (num > numTaskHnd)
 	{
+		/*
+			A retired thread may still be finishing a long task, it's joined before
+			taking m_HandlersLock so SendTask and the stealers don't wait for it.
+		*/
+		for (SIZET i = numTaskHnd; i < num; ++i)
+		{
+			if (m_TaskHandlers[i])
+				m_TaskHandlers[i]->Join();
+		}
 		m_HandlersLock.lock();
 		for (SIZET i = numTaskHnd; i < num; ++i)
 		{
-			TaskHandler hnd{ &m_Tasks };
-			hnd.Start();
-			m_TaskHandlers.emplace_back(hnd);
+			if (m_TaskHandlers[i])
+				m_TaskHandlers[i]->Start();
+			else
+				m_TaskHandlers[i] = std::make_unique<TaskHandler>(this, (uint32)i);
+			PlaceTaskHandler(i);
 		}
+		m_NumTaskHandlers.store((uint32)num, std::memory_order_release);
 		m_HandlersLock.unlock();
 	}
-	else
+	else if (num < numTaskHnd)
 	{
+		/*
+			Stopped handlers keep their slot, so the stealers never touch freed memory,
+			they finish their current task and drain their queue on their own thread.
+		*/
 		m_HandlersLock.lock();
-		m_TaskHandlers.resize(num);
+		m_NumTaskHandlers.store((uint32)num, std::memory_order_release);
+		for (SIZET i = num; i < numTaskHnd; ++i)
+			m_TaskHandlers[i]->RequestStop();
 		m_HandlersLock.unlock();
 	}
+	m_ResizeMutex.unlock();
+}
+
+void TaskManager::SetTaskHandlerLimits(SIZET minHandlers, SIZET maxHandlers)
+{
+	if (minHandlers == 0)
+		minHandlers = m_StartingNum;
+	if (maxHandlers == 0)
+		maxHandlers = m_MaxHandlers;
+	minHandlers = Clamp(minHandlers, (SIZET)1, m_MaxHandlers);
+	maxHandlers = Clamp(maxHandlers, minHandlers, m_MaxHandlers);
+	m_MinTaskHandlers.store((uint32)minHandlers, std::memory_order_relaxed);
+	m_MaxTaskHandlers.store((uint32)maxHandlers, std::memory_order_relaxed);
+	/* The controller applies them on its next sample */
+}
+
+SIZET TaskManager::GetMinTaskHandlers()const
+{
+	return m_MinTaskHandlers.load(std::memory_order_relaxed);
+}
+
+SIZET TaskManager::GetMaxTaskHandlers()const
+{
+	return m_MaxTaskHandlers.load(std::memory_order_relaxed);
 }
\ No newline at end of file
@@ -0,0 +1,365 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/TaskStats.h"
+#include "GAF/LogManager.h"
+
+using namespace gaf;
+
+namespace
+{
+	/*
+		Histogram written only by its owner thread, so the updates are plain
+		relaxed loads and stores, the atomics are just there so the snapshot
+		can read them at the same time.
+	*/
+	struct LiveHistogram
+	{
+		std::atomic<uint64> Buckets[TaskHistogram::NumBuckets];
+		std::atomic<uint64> Count;
+		std::atomic<uint64> Sum;
+		std::atomic<uint64> Max;
+
+		LiveHistogram()
+		{
+			Clear();
+		}
+
+		void Add(const uint64 ticks)
+		{
+			auto& bucket = Buckets[TaskHistogram::GetBucket(ticks)];
+			bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			Count.store(Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			Sum.store(Sum.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+			if (ticks > Max.load(std::memory_order_relaxed))
+				Max.store(ticks, std::memory_order_relaxed);
+		}
+
+		void Clear()
+		{
+			for (auto& bucket : Buckets)
+				bucket.store(0, std::memory_order_relaxed);
+			Count.store(0, std::memory_order_relaxed);
+			Sum.store(0, std::memory_order_relaxed);
+			Max.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	struct LiveEntry
+	{
+		const ANSICHAR* Name;
+		LiveHistogram WaitTime;
+		LiveHistogram ExecutionTime;
+
+		explicit LiveEntry(const ANSICHAR* name)
+			:Name(name)
+		{
+
+		}
+	};
+
+	/*
+		Open addressed by the address of the task name, the entries are
+		created by the owner and published with a release store. When every
+		slot is taken the tasks go to the Others entry.
+	*/
+	struct ThreadBuffer
+	{
+		static constexpr SIZET NumSlots = 256;
+
+		std::atomic<LiveEntry*> Slots[NumSlots];
+		LiveEntry Others;
+		bool InUse;
+
+		ThreadBuffer()
+			:Others("<others>")
+			,InUse(true)
+		{
+			for (auto& slot : Slots)
+				slot.store(nullptr, std::memory_order_relaxed);
+		}
+		~ThreadBuffer()
+		{
+			for (auto& slot : Slots)
+				delete slot.load(std::memory_order_relaxed);
+		}
+
+		LiveEntry& GetEntry(const ANSICHAR* name)
+		{
+			const auto hash = std::hash<const ANSICHAR*>{}(name);
+			for (SIZET i = 0; i < NumSlots; ++i)
+			{
+				auto& slot = Slots[(hash + i) % NumSlots];
+				auto entry = slot.load(std::memory_order_relaxed);
+				if (!entry)
+				{
+					entry = new LiveEntry(name);
+					slot.store(entry, std::memory_order_release);
+					return *entry;
+				}
+				if (entry->Name == name)
+					return *entry;
+			}
+			return Others;
+		}
+	};
+
+	/* Every buffer ever created, they're kept until exit so their data survives the threads */
+	struct BufferRegistry
+	{
+		std::mutex Mutex;
+		std::vector<ThreadBuffer*> Buffers;
+
+		~BufferRegistry()
+		{
+			for (auto buffer : Buffers)
+				delete buffer;
+		}
+	};
+
+	BufferRegistry gRegistry;
+	GREAPER_THLOCAL ThreadBuffer* gThreadBuffer = nullptr;
+
+	ThreadBuffer* AcquireThreadBuffer()
+	{
+		std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+		for (auto buffer : gRegistry.Buffers)
+		{
+			if (!buffer->InUse)
+			{
+				buffer->InUse = true;
+				return buffer;
+			}
+		}
+		gRegistry.Buffers.push_back(new ThreadBuffer());
+		return gRegistry.Buffers.back();
+	}
+
+	/*
+		Pairs the TSC with the steady clock at start-up and again when asked,
+		which gives the tick rate without depending on the CPU reporting it.
+	*/
+	struct TickCalibration
+	{
+		uint64 Ticks;
+		std::chrono::steady_clock::time_point Time;
+
+		TickCalibration()
+			:Ticks(TaskStats::Now())
+			,Time(std::chrono::steady_clock::now())
+		{
+
+		}
+	};
+	const TickCalibration gStartCalibration;
+}
+
+double TaskStats::GetNanosPerTick()
+{
+	/* Short intervals give a poor estimate, so wait a bit if the app just started */
+	constexpr auto MinInterval = std::chrono::milliseconds(10);
+	auto now = TickCalibration();
+	if (now.Time - gStartCalibration.Time < MinInterval)
+	{
+		std::this_thread::sleep_until(gStartCalibration.Time + MinInterval);
+		now = TickCalibration();
+	}
+	const auto nanos = std::chrono::duration<double, std::nano>(now.Time - gStartCalibration.Time).count();
+	const auto ticks = now.Ticks - gStartCalibration.Ticks;
+	return ticks > 0 ? nanos / (double)ticks : 1.0;
+}
+
+uint32 TaskHistogram::GetBucket(const uint64 ticks)
+{
+	if (ticks < SubBuckets)
+		return (uint32)ticks;
+	const auto exponent = 63 - CountLeadingZeros64(ticks);
+	if (exponent >= MaxBits)
+		return NumBuckets - 1;
+	return (exponent - SubBucketBits + 1) * SubBuckets + (uint32)((ticks >> (exponent - SubBucketBits)) & (SubBuckets - 1));
+}
+
+uint64 TaskHistogram::GetBucketValue(const uint32 bucket)
+{
+	if (bucket < SubBuckets)
+		return bucket;
+	const auto exponent = bucket / SubBuckets + SubBucketBits - 1;
+	return (uint64)(SubBuckets + bucket % SubBuckets) << (exponent - SubBucketBits);
+}
+
+uint64 TaskHistogram::GetBucketWidth(const uint32 bucket)
+{
+	if (bucket < SubBuckets)
+		return 1;
+	const auto exponent = bucket / SubBuckets + SubBucketBits - 1;
+	return 1ULL << (exponent - SubBucketBits);
+}
+
+TaskHistogram::TaskHistogram()
+	:m_Count(0)
+	,m_Sum(0)
+	,m_Max(0)
+	,m_NanosPerTick(1.0)
+{
+	m_Buckets.fill(0);
+}
+
+uint64 TaskHistogram::GetCount()const
+{
+	return m_Count;
+}
+
+double TaskHistogram::GetMean()const
+{
+	return m_Count > 0 ? (double)m_Sum / (double)m_Count * m_NanosPerTick : 0.0;
+}
+
+double TaskHistogram::GetPercentile(const double percentile)const
+{
+	if (m_Count == 0)
+		return 0.0;
+	const auto target = Max((uint64)1, (uint64)(Clamp(percentile, 0.0, 100.0) / 100.0 * (double)m_Count + 0.5));
+	uint64 accum = 0;
+	for (uint32 i = 0; i < NumBuckets; ++i)
+	{
+		accum += m_Buckets[i];
+		if (accum >= target)
+		{
+			/* Middle of the bucket, but never above the highest value seen */
+			const auto value = (double)GetBucketValue(i) + (double)(GetBucketWidth(i) - 1) * 0.5;
+			return Min(value, (double)m_Max) * m_NanosPerTick;
+		}
+	}
+	return GetMax();
+}
+
+double TaskHistogram::GetMax()const
+{
+	return (double)m_Max * m_NanosPerTick;
+}
+
+void TaskStats::Record(const ANSICHAR* name, const uint64 sendTime, const uint64 beginTime, const uint64 endTime)
+{
+	auto buffer = gThreadBuffer;
+	if (!buffer)
+	{
+		buffer = AcquireThreadBuffer();
+		gThreadBuffer = buffer;
+	}
+	auto& entry = buffer->GetEntry(name);
+	/* TSCs of different cores can be slightly off, so a task stolen right away may begin before it was sent */
+	if (sendTime != 0)
+		entry.WaitTime.Add(beginTime > sendTime ? beginTime - sendTime : 0);
+	entry.ExecutionTime.Add(endTime > beginTime ? endTime - beginTime : 0);
+}
+
+void TaskStats::ReleaseThreadBuffer()
+{
+	auto buffer = gThreadBuffer;
+	if (!buffer)
+		return;
+	gThreadBuffer = nullptr;
+	std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+	buffer->InUse = false;
+}
+
+std::vector<TaskStatsEntry> TaskStats::Snapshot()
+{
+	const auto nanosPerTick = GetNanosPerTick();
+	std::vector<TaskStatsEntry> entries;
+	/* Different pointers may carry the same name, so the merge is done by content */
+	std::map<std::string, SIZET> indices;
+	const auto mergeHistogram = [](TaskHistogram& histogram, const LiveHistogram& live)
+	{
+		for (uint32 i = 0; i < TaskHistogram::NumBuckets; ++i)
+			histogram.m_Buckets[i] += live.Buckets[i].load(std::memory_order_relaxed);
+		histogram.m_Count += live.Count.load(std::memory_order_relaxed);
+		histogram.m_Sum += live.Sum.load(std::memory_order_relaxed);
+		histogram.m_Max = Max(histogram.m_Max, live.Max.load(std::memory_order_relaxed));
+	};
+	const auto merge = [&](const LiveEntry& live)
+	{
+		const std::string name = live.Name ? live.Name : "<unnamed>";
+		auto it = indices.find(name);
+		if (it == indices.end())
+		{
+			it = indices.emplace(name, entries.size()).first;
+			entries.emplace_back();
+			entries.back().Name = name;
+			entries.back().WaitTime.m_NanosPerTick = nanosPerTick;
+			entries.back().ExecutionTime.m_NanosPerTick = nanosPerTick;
+		}
+		auto& entry = entries[it->second];
+		mergeHistogram(entry.WaitTime, live.WaitTime);
+		mergeHistogram(entry.ExecutionTime, live.ExecutionTime);
+	};
+
+	gRegistry.Mutex.lock();
+	for (auto buffer : gRegistry.Buffers)
+	{
+		for (auto& slot : buffer->Slots)
+		{
+			if (auto live = slot.load(std::memory_order_acquire))
+				merge(*live);
+		}
+		if (buffer->Others.ExecutionTime.Count.load(std::memory_order_relaxed) > 0)
+			merge(buffer->Others);
+	}
+	gRegistry.Mutex.unlock();
+
+	std::sort(entries.begin(), entries.end(), [](const TaskStatsEntry& a, const TaskStatsEntry& b)
+	{
+		return a.ExecutionTime.m_Sum > b.ExecutionTime.m_Sum;
+	});
+	return entries;
+}
+
+void TaskStats::Reset()
+{
+	std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+	for (auto buffer : gRegistry.Buffers)
+	{
+		for (auto& slot : buffer->Slots)
+		{
+			if (auto live = slot.load(std::memory_order_acquire))
+			{
+				live->WaitTime.Clear();
+				live->ExecutionTime.Clear();
+			}
+		}
+		buffer->Others.WaitTime.Clear();
+		buffer->Others.ExecutionTime.Clear();
+	}
+}
+
+void TaskStats::Dump()
+{
+	const auto entries = Snapshot();
+	if (entries.empty())
+	{
+		LogManager::LogMessage(LL_INFO, "TaskStats: No tasks recorded.");
+		return;
+	}
+	LogManager::LogMessage(LL_INFO, "TaskStats: name count | wait p50 p99 | exec p50 p99 max (us)");
+	for (const auto& entry : entries)
+	{
+		LogManager::LogMessage(LL_INFO, "TaskStats: %s %llu | %.1f %.1f | %.1f %.1f %.1f", entry.Name.c_str(),
+			(unsigned long long)entry.ExecutionTime.GetCount(),
+			entry.WaitTime.GetPercentile(50.0) / 1000.0, entry.WaitTime.GetPercentile(99.0) / 1000.0,
+			entry.ExecutionTime.GetPercentile(50.0) / 1000.0, entry.ExecutionTime.GetPercentile(99.0) / 1000.0,
+			entry.ExecutionTime.GetMax() / 1000.0);
+	}
+}
@@ -0,0 +1,316 @@
+/***********************************************************************************
+* Copyright 2018 Marcos Sánchez Torrent                                            *
+*                                                                                  *
+* Licensed under the Apache License, Version 2.0 (the "License");                  *
+* you may not use this file except in compliance with the License.                 *
+* You may obtain a copy of the License at                                          *
+*                                                                                  *
+* http://www.apache.org/licenses/LICENSE-2.0                                       *
+*                                                                                  *
+* Unless required by applicable law or agreed to in writing, software              *
+* distributed under the License is distributed on an "AS IS" BASIS,                *
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         *
+* See the License for the specific language governing permissions and              *
+* limitations under the License.                                                   *
+***********************************************************************************/
+
+#include "GAF/TaskTrace.h"
+#include "GAF/FileSystem.h"
+#include "GAF/LogManager.h"
+
+using namespace gaf;
+
+std::atomic<bool> TaskTrace::m_Enabled(false);
+
+namespace
+{
+	enum EventType : uint32
+	{
+		EVENT_TASK,
+		EVENT_ZONE
+	};
+
+	/* The fields are atomics so ToChromeJSON can copy them while the owner records */
+	struct Event
+	{
+		std::atomic<const ANSICHAR*> Name;
+		std::atomic<uint64> SendTime;
+		std::atomic<uint64> BeginTime;
+		std::atomic<uint64> EndTime;
+		std::atomic<uint32> Type;
+	};
+
+	/* Plain copy of an Event */
+	struct EventData
+	{
+		const ANSICHAR* Name;
+		uint64 SendTime;
+		uint64 BeginTime;
+		uint64 EndTime;
+		uint32 Type;
+	};
+
+	/*
+		Ring buffer written only by its owner thread, NumWritten works like
+		a seqlock: the owner stores the event and then publishes it, readers
+		copy the events and look at NumWritten again in order to drop the
+		ones that the owner may have been overwriting meanwhile.
+	*/
+	struct ThreadBuffer
+	{
+		static constexpr uint64 Mask = TaskTrace::EventsPerThread - 1;
+
+		std::unique_ptr<Event[]> Events;
+		std::atomic<uint64> NumWritten;
+		/* Thread ID on the timeline */
+		uint32 ID;
+		std::string ThreadName;
+		std::string DispatcherName;
+		bool InUse;
+
+		ThreadBuffer(const uint32 id, const std::string& threadName, const std::string& dispatcherName)
+			:Events(new Event[TaskTrace::EventsPerThread])
+			,NumWritten(0)
+			,ID(id)
+			,ThreadName(threadName)
+			,DispatcherName(dispatcherName)
+			,InUse(true)
+		{
+
+		}
+
+		void Push(const EventType type, const ANSICHAR* name, const uint64 sendTime, const uint64 beginTime, const uint64 endTime)
+		{
+			const auto index = NumWritten.load(std::memory_order_relaxed);
+			/* Keeps the previous publish before these stores, so readers notice the overwrite */
+			std::atomic_thread_fence(std::memory_order_release);
+			auto& event = Events[index & Mask];
+			event.Name.store(name, std::memory_order_relaxed);
+			event.SendTime.store(sendTime, std::memory_order_relaxed);
+			event.BeginTime.store(beginTime, std::memory_order_relaxed);
+			event.EndTime.store(endTime, std::memory_order_relaxed);
+			event.Type.store(type, std::memory_order_relaxed);
+			NumWritten.store(index + 1, std::memory_order_release);
+		}
+
+		/* Copies the events which are still in the ring, any thread */
+		void CopyEvents(std::vector<EventData>& events)const
+		{
+			const auto end = NumWritten.load(std::memory_order_acquire);
+			const auto begin = end > TaskTrace::EventsPerThread ? end - TaskTrace::EventsPerThread : 0;
+			const auto first = events.size();
+			events.resize(first + (SIZET)(end - begin));
+			for (auto i = begin; i < end; ++i)
+			{
+				const auto& event = Events[i & Mask];
+				auto& data = events[first + (SIZET)(i - begin)];
+				data.Name = event.Name.load(std::memory_order_relaxed);
+				data.SendTime = event.SendTime.load(std::memory_order_relaxed);
+				data.BeginTime = event.BeginTime.load(std::memory_order_relaxed);
+				data.EndTime = event.EndTime.load(std::memory_order_relaxed);
+				data.Type = event.Type.load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			/* The slot of event i is reused by event i + EventsPerThread, which may have begun at NumWritten */
+			const auto after = NumWritten.load(std::memory_order_relaxed);
+			if (after >= begin + TaskTrace::EventsPerThread)
+			{
+				const auto overwritten = Min(after - TaskTrace::EventsPerThread + 1, end) - begin;
+				events.erase(events.begin() + first, events.begin() + first + (SIZET)overwritten);
+			}
+		}
+	};
+
+	struct BufferRegistry
+	{
+		std::mutex Mutex;
+		std::vector<ThreadBuffer*> Buffers;
+
+		~BufferRegistry()
+		{
+			for (auto buffer : Buffers)
+				delete buffer;
+		}
+	};
+
+	BufferRegistry gRegistry;
+	std::atomic<uint64> gStartTime(0);
+	std::atomic<uint64> gStopTime(0);
+	GREAPER_THLOCAL ThreadBuffer* gThreadBuffer = nullptr;
+	GREAPER_THLOCAL const ANSICHAR* gThreadName = nullptr;
+	GREAPER_THLOCAL const ANSICHAR* gDispatcherName = nullptr;
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		if (gThreadBuffer)
+			return gThreadBuffer;
+		const std::string threadName = gThreadName ? gThreadName : "";
+		const std::string dispatcherName = gDispatcherName ? gDispatcherName : "";
+		std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+		/* A restarted TaskHandler gets its old lane back */
+		for (auto buffer : gRegistry.Buffers)
+		{
+			if (!buffer->InUse && buffer->ThreadName == threadName && buffer->DispatcherName == dispatcherName)
+			{
+				buffer->InUse = true;
+				gThreadBuffer = buffer;
+				return buffer;
+			}
+		}
+		gRegistry.Buffers.push_back(new ThreadBuffer((uint32)gRegistry.Buffers.size() + 1, threadName, dispatcherName));
+		gThreadBuffer = gRegistry.Buffers.back();
+		return gThreadBuffer;
+	}
+
+	void AppendEscaped(std::string& out, const ANSICHAR* str)
+	{
+		for (; str && *str; ++str)
+		{
+			const auto c = *str;
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if ((uint8)c < 0x20)
+			{
+				ANSICHAR buff[8];
+				snprintf(buff, sizeof(buff), "\\u%04x", (uint32)(uint8)c);
+				out += buff;
+			}
+			else
+			{
+				out += c;
+			}
+		}
+	}
+}
+
+void TaskTrace::Start()
+{
+	gStartTime.store(TaskStats::Now(), std::memory_order_relaxed);
+	gStopTime.store(0, std::memory_order_relaxed);
+	m_Enabled.store(true, std::memory_order_release);
+}
+
+void TaskTrace::Stop()
+{
+	m_Enabled.store(false, std::memory_order_release);
+	gStopTime.store(TaskStats::Now(), std::memory_order_relaxed);
+}
+
+void TaskTrace::SetThreadName(const ANSICHAR* threadName, const ANSICHAR* dispatcherName)
+{
+	gThreadName = threadName;
+	gDispatcherName = dispatcherName;
+}
+
+void TaskTrace::RecordTask(const ANSICHAR* name, const uint64 sendTime, const uint64 beginTime, const uint64 endTime)
+{
+	GetThreadBuffer()->Push(EVENT_TASK, name, sendTime, beginTime, endTime);
+}
+
+void TaskTrace::RecordZone(const ANSICHAR* name, const uint64 beginTime, const uint64 endTime)
+{
+	GetThreadBuffer()->Push(EVENT_ZONE, name, 0, beginTime, endTime);
+}
+
+void TaskTrace::ReleaseThreadBuffer()
+{
+	auto buffer = gThreadBuffer;
+	gThreadBuffer = nullptr;
+	gThreadName = nullptr;
+	gDispatcherName = nullptr;
+	if (!buffer)
+		return;
+	std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+	buffer->InUse = false;
+}
+
+std::string TaskTrace::ToChromeJSON()
+{
+	const auto startTime = gStartTime.load(std::memory_order_relaxed);
+	auto stopTime = gStopTime.load(std::memory_order_relaxed);
+	if (stopTime == 0)
+		stopTime = TaskStats::Now();
+	const auto microsPerTick = TaskStats::GetNanosPerTick() / 1000.0;
+	const auto toMicros = [startTime, microsPerTick](const uint64 ticks)
+	{
+		return ((double)ticks - (double)startTime) * microsPerTick;
+	};
+
+	std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GAF\"}}";
+	ANSICHAR buff[256];
+	std::vector<EventData> events;
+	std::lock_guard<std::mutex> lock(gRegistry.Mutex);
+	for (const auto buffer : gRegistry.Buffers)
+	{
+		events.clear();
+		buffer->CopyEvents(events);
+		if (events.empty())
+			continue;
+		json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->ID) + ",\"args\":{\"name\":\"";
+		if (buffer->ThreadName.empty())
+			json += "thread-" + std::to_string(buffer->ID);
+		else
+			AppendEscaped(json, buffer->ThreadName.c_str());
+		json += "\"}}";
+		for (const auto& event : events)
+		{
+			if (event.BeginTime < startTime || event.BeginTime > stopTime)
+				continue;
+			json += ",\n{\"name\":\"";
+			AppendEscaped(json, event.Name ? event.Name : "<unnamed>");
+			snprintf(buff, sizeof(buff), "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+				event.Type == EVENT_TASK ? "task" : "zone", buffer->ID, toMicros(event.BeginTime),
+				(double)(event.EndTime - event.BeginTime) * microsPerTick);
+			json += buff;
+			if (event.Type == EVENT_TASK)
+			{
+				json += ",\"args\":{\"dispatcher\":\"";
+				AppendEscaped(json, buffer->DispatcherName.c_str());
+				json += '"';
+				if (event.SendTime != 0)
+				{
+					/* TSCs of different cores can be slightly off, see TaskStats::Record */
+					const auto wait = event.BeginTime > event.SendTime ? event.BeginTime - event.SendTime : 0;
+					snprintf(buff, sizeof(buff), ",\"enqueued\":%.3f,\"wait\":%.3f", toMicros(event.SendTime), (double)wait * microsPerTick);
+					json += buff;
+				}
+				json += '}';
+			}
+			json += '}';
+		}
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+bool TaskTrace::Write(const std::string& filePathName)
+{
+	auto json = ToChromeJSON();
+	File* file = nullptr;
+	if (FileSystem::GetExternalFile(filePathName, file) == FileSysError_t::NoError && file)
+		FileSystem::EraseExternalFile(file);
+	auto err = FileSystem::CreateExternalFile(filePathName, file);
+	if (err != FileSysError_t::NoError || !file)
+	{
+		LogManager::LogMessage(LL_ERRO, "Trying to write the task trace into '%s', but the file couldn't be created, error: %s.",
+			filePathName.c_str(), GetFileErrorStr(err).c_str());
+		return false;
+	}
+	file->Open();
+	SIZET writtenBytes = 0;
+	err = file->StoreContents(&json[0], json.size(), writtenBytes);
+	file->Close();
+	FileSystem::DeleteExternalFile(file);
+	if (err != FileSysError_t::NoError || writtenBytes != json.size())
+	{
+		LogManager::LogMessage(LL_ERRO, "Trying to write the task trace into '%s', but only %llu of %llu bytes were written, error: %s.",
+			filePathName.c_str(), (unsigned long long)writtenBytes, (unsigned long long)json.size(), GetFileErrorStr(err).c_str());
+		return false;
+	}
+	LogManager::LogMessage(LL_INFO, "Task trace written into '%s'.", filePathName.c_str());
+	return true;
+}
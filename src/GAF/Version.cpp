@@ -24,7 +24,7 @@ using namespace gaf;
 #elif defined(GREAPER_FRELEASE)
 #define SUFIX0 "Public Relase"
 #else
-#if ((GREAPER_DEBUG_COMMANDS + GREAPER_DEBUG_ALLOCATION + GREAPER_DEBUG_EVENTS + GREAPER_DEBUG_FILESYS + GREAPER_DEBUG_INPUT + GREAPER_DEBUG_PROPERTIES + GREAPER_DEBUG_TASKMAN + GREAPER_DEBUG_WINDOW) > 0)
+#if ((GREAPER_DEBUG_COMMANDS + GREAPER_DEBUG_ALLOCATION + GREAPER_DEBUG_EVENTS + GREAPER_DEBUG_FILESYS + GREAPER_DEBUG_INPUT + GREAPER_DEBUG_PROPERTIES + GREAPER_DEBUG_WINDOW) > 0)
 #define SUFIX0 "Private Relase ("
 #else
 #define SUFIX0 "Private Relase"
@@ -67,30 +67,24 @@ using namespace gaf;
 #define SUFIX6
 #endif
 
-#if GREAPER_DEBUG_TASKMAN
-#define SUFIX7 " TASK_DBG "
-#else
-#define SUFIX7
-#endif
-
 #if GREAPER_DEBUG_WINDOW
-#define SUFIX8 " WND_DBG "
+#define SUFIX7 " WND_DBG "
 #else
-#define SUFIX8
+#define SUFIX7
 #endif
 
 #if GREAPER_DEBUG
-#define SUFIX9 ")"
+#define SUFIX8 ")"
 #else
-#if ((GREAPER_DEBUG_COMMANDS + GREAPER_DEBUG_ALLOCATION + GREAPER_DEBUG_EVENTS + GREAPER_DEBUG_FILESYS + GREAPER_DEBUG_INPUT + GREAPER_DEBUG_PROPERTIES + GREAPER_DEBUG_TASKMAN + GREAPER_DEBUG_WINDOW) > 0)
-#define SUFIX9 ")"
+#if ((GREAPER_DEBUG_COMMANDS + GREAPER_DEBUG_ALLOCATION + GREAPER_DEBUG_EVENTS + GREAPER_DEBUG_FILESYS + GREAPER_DEBUG_INPUT + GREAPER_DEBUG_PROPERTIES + GREAPER_DEBUG_WINDOW) > 0)
+#define SUFIX8 ")"
 #else
-#define SUFIX9
+#define SUFIX8
 #endif
 #endif
 
 #ifndef GREAPER_FRELEASE
-#define SUFIX SUFIX0 SUFIX1 SUFIX2 SUFIX3 SUFIX4 SUFIX5 SUFIX6 SUFIX7 SUFIX8 SUFIX9
+#define SUFIX SUFIX0 SUFIX1 SUFIX2 SUFIX3 SUFIX4 SUFIX5 SUFIX6 SUFIX7 SUFIX8
 #else
 #define SUFIX SUFIX0
 #endif
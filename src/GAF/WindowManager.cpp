@@ -253,7 +253,8 @@ WindowManager::WindowManager()
 	EventIDOnWindowClosing = eventMgr->RegisterEvent(OnWindowClosingEvent);
 	EventIDOnWindowFocusLost = eventMgr->RegisterEvent(OnWindowFocusLostEvent);
 	EventIDOnWindowFocusGain = eventMgr->RegisterEvent(OnWindowFocusGainEvent);
-	EventIDOnWindowMove = eventMgr->RegisterEvent(OnWindowMoveEvent);
+	/* A drag sends many moves per frame, only the last position matters */
+	EventIDOnWindowMove = eventMgr->RegisterEvent(OnWindowMoveEvent, EEventDispatch::COALESCED);
 	EventIDOnWindowMaximize = eventMgr->RegisterEvent(OnWindowMaximizeEvent);
 	EventIDOnWindowResized = eventMgr->RegisterEvent(OnWindowResizedEvent);
 	EventIDOnWindowMinimize = eventMgr->RegisterEvent(OnWindowMinimizeEvent);